@@ -26,6 +26,9 @@
 
 #include <map_common.h>
 
+/* FIXME: make configurable */
+#define TINY_LIMIT 14
+
 typedef struct
 {
     MapKeyEqualFn equal_fn;
@@ -0,0 +1,617 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+#include <platform.h>
+#include <b-tree.h>
+
+#include <alloc.h>
+
+/* Minimum degree: every node but the root has MIN_KEYS..MAX_KEYS keys */
+#define MIN_DEGREE 16
+#define MIN_KEYS (MIN_DEGREE - 1)
+#define MAX_KEYS (2 * MIN_DEGREE - 1)
+#define MAX_CHILDREN (2 * MIN_DEGREE)
+
+/* Way more than enough, a tree this deep would have over 16^15 entries */
+#define MAX_DEPTH 16
+
+typedef struct BTreeNode_ BTreeNode;
+
+struct BTreeNode_
+{
+    unsigned int count;
+    bool leaf;
+    void *keys[MAX_KEYS];
+    void *values[MAX_KEYS];
+    BTreeNode *children[];      /* MAX_CHILDREN, only in internal nodes */
+};
+
+struct BTree_
+{
+    void *(*KeyCopy)(const void *key);
+    int (*KeyCompare)(const void *a, const void *b);
+    void (*KeyDestroy)(void *key);
+
+    void *(*ValueCopy)(const void *key);
+    int (*ValueCompare)(const void *a, const void *b);
+    void (*ValueDestroy)(void *key);
+
+    BTreeNode *root;            /* NULL if empty */
+    size_t size;
+};
+
+typedef struct
+{
+    const BTreeNode *node;
+    unsigned int index;
+} IteratorFrame_;
+
+struct BTreeIterator_
+{
+    IteratorFrame_ stack[MAX_DEPTH];
+    unsigned int depth;
+};
+
+static int PointerCompare_(const void *a, const void *b)
+{
+    return (a < b) ? -1 : (a > b);
+}
+
+static void NoopDestroy_(ARG_UNUSED void *a)
+{
+    return;
+}
+
+static void *NoopCopy_(const void *a)
+{
+    return (void *)a;
+}
+
+static BTreeNode *NodeNew_(bool leaf)
+{
+    size_t size = sizeof(BTreeNode);
+    if (!leaf)
+    {
+        size += MAX_CHILDREN * sizeof(BTreeNode *);
+    }
+
+    BTreeNode *node = xmalloc(size);
+    node->count = 0;
+    node->leaf = leaf;
+    return node;
+}
+
+static void NodeDestroyRecursive_(BTree *tree, BTreeNode *node)
+{
+    for (unsigned int i = 0; i < node->count; i++)
+    {
+        tree->KeyDestroy(node->keys[i]);
+        tree->ValueDestroy(node->values[i]);
+    }
+    if (!node->leaf)
+    {
+        for (unsigned int i = 0; i <= node->count; i++)
+        {
+            NodeDestroyRecursive_(tree, node->children[i]);
+        }
+    }
+    free(node);
+}
+
+BTree *BTreeNew(void *(*KeyCopy)(const void *key),
+                int (*KeyCompare)(const void *a, const void *b),
+                void (*KeyDestroy)(void *key),
+                void *(*ValueCopy)(const void *key),
+                int (*ValueCompare)(const void *a, const void *b),
+                void (*ValueDestroy)(void *key))
+{
+    assert(!(KeyCopy && KeyDestroy) || (KeyCopy && KeyDestroy));
+    assert(!(ValueCopy && ValueDestroy) || (ValueCopy && ValueDestroy));
+
+    BTree *t = xmalloc(sizeof(BTree));
+
+    t->KeyCopy = KeyCopy ? KeyCopy : NoopCopy_;
+    t->KeyCompare = KeyCompare ? KeyCompare : PointerCompare_;
+    t->KeyDestroy = KeyDestroy ? KeyDestroy : NoopDestroy_;
+
+    t->ValueCopy = ValueCopy ? ValueCopy : NoopCopy_;
+    t->ValueCompare = ValueCompare ? ValueCompare : PointerCompare_;
+    t->ValueDestroy = ValueDestroy ? ValueDestroy : NoopDestroy_;
+
+    t->root = NULL;
+    t->size = 0;
+
+    return t;
+}
+
+bool BTreeEqual(const void *_a, const void *_b)
+{
+    const BTree *a = _a, *b = _b;
+
+    if (a == b)
+    {
+        return true;
+    }
+    if (a == NULL || b == NULL)
+    {
+        return false;
+    }
+    if (a->KeyCompare != b->KeyCompare || a->ValueCompare != b->ValueCompare)
+    {
+        return false;
+    }
+    if (BTreeSize(a) != BTreeSize(b))
+    {
+        return false;
+    }
+
+    BTreeIterator *it_a = BTreeIteratorNew(a);
+    BTreeIterator *it_b = BTreeIteratorNew(b);
+
+    bool equal = true;
+    void *a_key, *a_val, *b_key, *b_val;
+    while (equal && BTreeIteratorNext(it_a, &a_key, &a_val)
+           && BTreeIteratorNext(it_b, &b_key, &b_val))
+    {
+        equal = (a->KeyCompare(a_key, b_key) == 0 &&
+                 a->ValueCompare(a_val, b_val) == 0);
+    }
+
+    BTreeIteratorDestroy(it_a);
+    BTreeIteratorDestroy(it_b);
+    return equal;
+}
+
+void BTreeDestroy(void *b_tree)
+{
+    BTree *tree = b_tree;
+    if (tree)
+    {
+        BTreeClear(tree);
+        free(tree);
+    }
+}
+
+/**
+ * @return index of the first key in node not less than key, *found tells
+ *         whether it is equal to key
+ */
+static unsigned int LowerBound_(const BTree *tree, const BTreeNode *node,
+                                const void *key, bool *found)
+{
+    unsigned int low = 0;
+    unsigned int high = node->count;
+    while (low < high)
+    {
+        const unsigned int mid = low + (high - low) / 2;
+        const int cmp = tree->KeyCompare(node->keys[mid], key);
+        if (cmp == 0)
+        {
+            *found = true;
+            return mid;
+        }
+        if (cmp < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    *found = false;
+    return low;
+}
+
+/**
+ * Split the full child at index of parent into two, moving its median key up
+ * into parent (which must not be full).
+ */
+static void SplitChild_(BTreeNode *parent, unsigned int index)
+{
+    BTreeNode *left = parent->children[index];
+    assert(left->count == MAX_KEYS);
+    assert(parent->count < MAX_KEYS);
+
+    BTreeNode *right = NodeNew_(left->leaf);
+    right->count = MIN_KEYS;
+    memcpy(right->keys, left->keys + MIN_DEGREE, MIN_KEYS * sizeof(void *));
+    memcpy(right->values, left->values + MIN_DEGREE, MIN_KEYS * sizeof(void *));
+    if (!left->leaf)
+    {
+        memcpy(right->children, left->children + MIN_DEGREE,
+               MIN_DEGREE * sizeof(BTreeNode *));
+    }
+    left->count = MIN_KEYS;
+
+    const unsigned int n = parent->count;
+    memmove(parent->keys + index + 1, parent->keys + index,
+            (n - index) * sizeof(void *));
+    memmove(parent->values + index + 1, parent->values + index,
+            (n - index) * sizeof(void *));
+    memmove(parent->children + index + 2, parent->children + index + 1,
+            (n - index) * sizeof(BTreeNode *));
+    parent->keys[index] = left->keys[MIN_KEYS];
+    parent->values[index] = left->values[MIN_KEYS];
+    parent->children[index + 1] = right;
+    parent->count++;
+}
+
+static void Replace_(BTree *tree, BTreeNode *node, unsigned int index,
+                     const void *key, const void *value)
+{
+    tree->KeyDestroy(node->keys[index]);
+    node->keys[index] = tree->KeyCopy(key);
+    tree->ValueDestroy(node->values[index]);
+    node->values[index] = tree->ValueCopy(value);
+}
+
+bool BTreePut(BTree *tree, const void *key, const void *value)
+{
+    if (tree->root == NULL)
+    {
+        tree->root = NodeNew_(true);
+    }
+    else if (tree->root->count == MAX_KEYS)
+    {
+        BTreeNode *root = NodeNew_(false);
+        root->children[0] = tree->root;
+        SplitChild_(root, 0);
+        tree->root = root;
+    }
+
+    /* Split full nodes on the way down, so there is always room for a key
+     * coming up from a split below. */
+    BTreeNode *node = tree->root;
+    for (;;)
+    {
+        bool found;
+        unsigned int i = LowerBound_(tree, node, key, &found);
+        if (found)
+        {
+            Replace_(tree, node, i, key, value);
+            return true;
+        }
+
+        if (node->leaf)
+        {
+            const unsigned int n = node->count;
+            memmove(node->keys + i + 1, node->keys + i, (n - i) * sizeof(void *));
+            memmove(node->values + i + 1, node->values + i, (n - i) * sizeof(void *));
+            node->keys[i] = tree->KeyCopy(key);
+            node->values[i] = tree->ValueCopy(value);
+            node->count++;
+            tree->size++;
+            return false;
+        }
+
+        if (node->children[i]->count == MAX_KEYS)
+        {
+            SplitChild_(node, i);
+            const int cmp = tree->KeyCompare(key, node->keys[i]);
+            if (cmp == 0)
+            {
+                Replace_(tree, node, i, key, value);
+                return true;
+            }
+            if (cmp > 0)
+            {
+                i++;
+            }
+        }
+        node = node->children[i];
+    }
+}
+
+void *BTreeGet(const BTree *tree, const void *key)
+{
+    const BTreeNode *node = tree->root;
+    while (node != NULL)
+    {
+        bool found;
+        const unsigned int i = LowerBound_(tree, node, key, &found);
+        if (found)
+        {
+            return node->values[i];
+        }
+        node = node->leaf ? NULL : node->children[i];
+    }
+    return NULL;
+}
+
+/**
+ * Merge the child at index + 1 of parent and the key at index into the child
+ * at index. Both children must have MIN_KEYS keys.
+ */
+static void MergeChildren_(BTreeNode *parent, unsigned int index)
+{
+    BTreeNode *left = parent->children[index];
+    BTreeNode *right = parent->children[index + 1];
+    assert(left->count == MIN_KEYS && right->count == MIN_KEYS);
+
+    left->keys[MIN_KEYS] = parent->keys[index];
+    left->values[MIN_KEYS] = parent->values[index];
+    memcpy(left->keys + MIN_DEGREE, right->keys, MIN_KEYS * sizeof(void *));
+    memcpy(left->values + MIN_DEGREE, right->values, MIN_KEYS * sizeof(void *));
+    if (!left->leaf)
+    {
+        memcpy(left->children + MIN_DEGREE, right->children,
+               MIN_DEGREE * sizeof(BTreeNode *));
+    }
+    left->count = MAX_KEYS;
+    free(right);
+
+    const unsigned int n = parent->count;
+    memmove(parent->keys + index, parent->keys + index + 1,
+            (n - index - 1) * sizeof(void *));
+    memmove(parent->values + index, parent->values + index + 1,
+            (n - index - 1) * sizeof(void *));
+    memmove(parent->children + index + 1, parent->children + index + 2,
+            (n - index - 1) * sizeof(BTreeNode *));
+    parent->count--;
+}
+
+/**
+ * Move a key from the left sibling through parent into the child at index.
+ */
+static void RotateRight_(BTreeNode *parent, unsigned int index)
+{
+    BTreeNode *child = parent->children[index];
+    BTreeNode *sibling = parent->children[index - 1];
+
+    memmove(child->keys + 1, child->keys, child->count * sizeof(void *));
+    memmove(child->values + 1, child->values, child->count * sizeof(void *));
+    if (!child->leaf)
+    {
+        memmove(child->children + 1, child->children,
+                (child->count + 1) * sizeof(BTreeNode *));
+        child->children[0] = sibling->children[sibling->count];
+    }
+    child->keys[0] = parent->keys[index - 1];
+    child->values[0] = parent->values[index - 1];
+    child->count++;
+
+    sibling->count--;
+    parent->keys[index - 1] = sibling->keys[sibling->count];
+    parent->values[index - 1] = sibling->values[sibling->count];
+}
+
+/**
+ * Move a key from the right sibling through parent into the child at index.
+ */
+static void RotateLeft_(BTreeNode *parent, unsigned int index)
+{
+    BTreeNode *child = parent->children[index];
+    BTreeNode *sibling = parent->children[index + 1];
+
+    child->keys[child->count] = parent->keys[index];
+    child->values[child->count] = parent->values[index];
+    if (!child->leaf)
+    {
+        child->children[child->count + 1] = sibling->children[0];
+        memmove(sibling->children, sibling->children + 1,
+                sibling->count * sizeof(BTreeNode *));
+    }
+    child->count++;
+
+    parent->keys[index] = sibling->keys[0];
+    parent->values[index] = sibling->values[0];
+    sibling->count--;
+    memmove(sibling->keys, sibling->keys + 1, sibling->count * sizeof(void *));
+    memmove(sibling->values, sibling->values + 1, sibling->count * sizeof(void *));
+}
+
+/**
+ * Make sure the child at index of node has more than MIN_KEYS keys, so that
+ * one can be removed from it.
+ *
+ * @return the child to descend into (merging may have changed it)
+ */
+static BTreeNode *FillChild_(BTreeNode *node, unsigned int index)
+{
+    if (node->children[index]->count > MIN_KEYS)
+    {
+        return node->children[index];
+    }
+
+    if (index > 0 && node->children[index - 1]->count > MIN_KEYS)
+    {
+        RotateRight_(node, index);
+    }
+    else if (index < node->count && node->children[index + 1]->count > MIN_KEYS)
+    {
+        RotateLeft_(node, index);
+    }
+    else if (index < node->count)
+    {
+        MergeChildren_(node, index);
+    }
+    else
+    {
+        MergeChildren_(node, index - 1);
+        index--;
+    }
+    return node->children[index];
+}
+
+bool BTreeRemove(BTree *tree, const void *key)
+{
+    if (tree->root == NULL)
+    {
+        return false;
+    }
+
+    /* Fill nodes on the way down, so removing a key never leaves a node with
+     * less than MIN_KEYS keys. Keys removed from internal nodes are replaced
+     * by their predecessor or successor, which is then removed from the
+     * subtree without being destroyed. */
+    bool removed = false;
+    bool destroy = true;
+    BTreeNode *node = tree->root;
+    for (;;)
+    {
+        bool found;
+        const unsigned int i = LowerBound_(tree, node, key, &found);
+
+        if (node->leaf)
+        {
+            if (found)
+            {
+                if (destroy)
+                {
+                    tree->KeyDestroy(node->keys[i]);
+                    tree->ValueDestroy(node->values[i]);
+                }
+                const unsigned int n = node->count;
+                memmove(node->keys + i, node->keys + i + 1,
+                        (n - i - 1) * sizeof(void *));
+                memmove(node->values + i, node->values + i + 1,
+                        (n - i - 1) * sizeof(void *));
+                node->count--;
+                removed = true;
+            }
+            break;
+        }
+
+        if (!found)
+        {
+            node = FillChild_(node, i);
+            continue;
+        }
+
+        BTreeNode *left = node->children[i];
+        BTreeNode *right = node->children[i + 1];
+        if (left->count > MIN_KEYS || right->count > MIN_KEYS)
+        {
+            /* Take the nearest key from the fuller subtree */
+            const bool from_left = (left->count > MIN_KEYS);
+            const BTreeNode *leaf = from_left ? left : right;
+            while (!leaf->leaf)
+            {
+                leaf = leaf->children[from_left ? leaf->count : 0];
+            }
+            const unsigned int j = from_left ? leaf->count - 1 : 0;
+
+            if (destroy)
+            {
+                tree->KeyDestroy(node->keys[i]);
+                tree->ValueDestroy(node->values[i]);
+            }
+            node->keys[i] = leaf->keys[j];
+            node->values[i] = leaf->values[j];
+
+            key = node->keys[i];
+            destroy = false;
+            node = from_left ? left : right;
+        }
+        else
+        {
+            MergeChildren_(node, i);
+            node = left;
+        }
+    }
+
+    BTreeNode *root = tree->root;
+    if (root->count == 0)
+    {
+        tree->root = root->leaf ? NULL : root->children[0];
+        free(root);
+    }
+
+    if (removed)
+    {
+        tree->size--;
+    }
+    return removed;
+}
+
+void BTreeClear(BTree *tree)
+{
+    assert(tree);
+
+    if (tree->root != NULL)
+    {
+        NodeDestroyRecursive_(tree, tree->root);
+        tree->root = NULL;
+    }
+    tree->size = 0;
+}
+
+size_t BTreeSize(const BTree *tree)
+{
+    return tree->size;
+}
+
+static void PushLeftmost_(BTreeIterator *iter, const BTreeNode *node)
+{
+    while (node != NULL)
+    {
+        assert(iter->depth < MAX_DEPTH);
+        iter->stack[iter->depth].node = node;
+        iter->stack[iter->depth].index = 0;
+        iter->depth++;
+        node = node->leaf ? NULL : node->children[0];
+    }
+}
+
+BTreeIterator *BTreeIteratorNew(const BTree *tree)
+{
+    BTreeIterator *iter = xmalloc(sizeof(BTreeIterator));
+    iter->depth = 0;
+    PushLeftmost_(iter, tree->root);
+    return iter;
+}
+
+bool BTreeIteratorNext(BTreeIterator *iter, void **key, void **value)
+{
+    while (iter->depth > 0)
+    {
+        IteratorFrame_ *top = &iter->stack[iter->depth - 1];
+        const BTreeNode *node = top->node;
+        if (top->index < node->count)
+        {
+            if (key)
+            {
+                *key = node->keys[top->index];
+            }
+            if (value)
+            {
+                *value = node->values[top->index];
+            }
+
+            top->index++;
+            if (!node->leaf)
+            {
+                PushLeftmost_(iter, node->children[top->index]);
+            }
+            return true;
+        }
+        iter->depth--;
+    }
+    return false;
+}
+
+void BTreeIteratorDestroy(void *_b_iter)
+{
+    free(_b_iter);
+}
@@ -0,0 +1,78 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+#ifndef CFENGINE_B_TREE_H
+#define CFENGINE_B_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>						/* size_t */
+
+/*
+ * Ordered map with the same interface as RBTree, implemented as a B-tree
+ * with up to 32 children per node.
+ *
+ * Keys (and separately values) of a node are stored next to each other, so a
+ * lookup touches a few cache lines in each of ~log32(n) nodes instead of
+ * chasing a pointer to a separately allocated node for every one of the
+ * ~log2(n) levels of a red-black tree. There is also just one allocation per
+ * ~16-31 entries instead of one per entry.
+ *
+ * Like RBTree, keys and values are copied using the copy functions (if given)
+ * and iterators are invalidated by modifications of the tree.
+ */
+typedef struct BTree_ BTree;
+typedef struct BTreeIterator_ BTreeIterator;
+
+typedef void *BTreeKeyCopyFn(const void *key);
+typedef int BTreeKeyCompareFn(const void *a, const void *b);
+typedef void BTreeKeyDestroyFn(void *key);
+typedef void *BTreeValueCopyFn(const void *key);
+typedef int BTreeValueCompareFn(const void *a, const void *b);
+typedef void BTreeValueDestroyFn(void *key);
+
+BTree *BTreeNew(BTreeKeyCopyFn *key_copy,
+                BTreeKeyCompareFn *key_compare,
+                BTreeKeyDestroyFn *key_destroy,
+                BTreeValueCopyFn *value_copy,
+                BTreeValueCompareFn *value_compare,
+                BTreeValueDestroyFn *value_destroy);
+
+bool BTreeEqual(const void *a, const void *b);
+void BTreeDestroy(void *b_tree);
+
+/**
+ * @return true if an existing entry was replaced
+ */
+bool BTreePut(BTree *tree, const void *key, const void *value);
+void *BTreeGet(const BTree *tree, const void *key);
+bool BTreeRemove(BTree *tree, const void *key);
+void BTreeClear(BTree *tree);
+size_t BTreeSize(const BTree *tree);
+
+/**
+ * Iterates in ascending order of keys.
+ */
+BTreeIterator *BTreeIteratorNew(const BTree *tree);
+bool BTreeIteratorNext(BTreeIterator *iter, void **key, void **value);
+void BTreeIteratorDestroy(void *_b_iter);
+
+#endif
@@ -0,0 +1,188 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <bloom_filter.h>
+#include <alloc.h>
+#include <cleanup.h>             // DoCleanupAndExit()
+#include <math.h>
+
+#define BLOCK_BITS_LOG2 9
+#define BLOCK_BITS (1 << BLOCK_BITS_LOG2)
+#define BLOCK_WORDS (BLOCK_BITS / 64)
+#define MAX_HASHES 16
+
+/* Seed for the second, independent hash picking the bits inside a block. */
+#define BIT_HASH_SEED 0x9E3779B9U
+
+struct BloomFilter_
+{
+    MapHashFn hash_fn;
+    uint64_t *bits;
+    size_t n_blocks;
+    unsigned int n_hashes;
+};
+
+/* Blocks are as big as a cache line and must not straddle two of them,
+ * malloc() only guarantees 16 byte alignment */
+static uint64_t *AllocBlocks(size_t n_blocks)
+{
+    const size_t size = n_blocks * BLOCK_WORDS * sizeof(uint64_t);
+    void *blocks;
+#ifdef __MINGW32__
+    blocks = _aligned_malloc(size, BLOCK_BITS / 8);
+#else
+    if (posix_memalign(&blocks, BLOCK_BITS / 8, size) != 0)
+    {
+        blocks = NULL;
+    }
+#endif
+    if (blocks == NULL)
+    {
+        fputs("BloomFilterNew: CRITICAL: Unable to allocate memory\n", stderr);
+        DoCleanupAndExit(255);
+    }
+    memset(blocks, 0, size);
+    return blocks;
+}
+
+static void FreeBlocks(uint64_t *blocks)
+{
+#ifdef __MINGW32__
+    _aligned_free(blocks);
+#else
+    free(blocks);
+#endif
+}
+
+BloomFilter *BloomFilterNew(MapHashFn hash_fn, size_t expected_elements,
+                            double false_positive_rate)
+{
+    assert(hash_fn != NULL);
+    assert(false_positive_rate > 0.0 && false_positive_rate < 1.0);
+
+    /* Optimal number of bits m = -n ln(p) / ln(2)^2 and hashes k = m/n ln(2) */
+    const double ln2 = log(2.0);
+    const double n = MAX(expected_elements, 1);
+    const double m = -n * log(false_positive_rate) / (ln2 * ln2);
+    const double k = round(m / n * ln2);
+
+    /* Elements are not spread evenly over the blocks, the fuller blocks
+     * raise the false positive rate. Compensate with more bits, the more bits
+     * per element are wanted, the bigger the difference. */
+    const double blocked_m = m * (1.0 + m / n / 128.0);
+
+    BloomFilter *filter = xcalloc(1, sizeof(BloomFilter));
+    filter->hash_fn = hash_fn;
+    filter->n_hashes = (unsigned int) MIN(MAX(k, 1), MAX_HASHES);
+    filter->n_blocks = (size_t) ceil(blocked_m / BLOCK_BITS);
+    filter->bits = AllocBlocks(filter->n_blocks);
+    return filter;
+}
+
+static uint64_t *GetBlock(const BloomFilter *filter, const void *element)
+{
+    /* Map the 32-bit hash to [0, n_blocks) without a division. */
+    const uint64_t h = filter->hash_fn(element, 0);
+    return filter->bits + ((h * filter->n_blocks) >> 32) * BLOCK_WORDS;
+}
+
+/* Positions of the bits inside the block, 9 bits at a time from a splitmix64
+ * sequence seeded with the second hash. Every output is mixed from the seed
+ * anew, so later positions are as independent as the first ones. */
+#define POSITIONS_PER_MIX (64 / BLOCK_BITS_LOG2)
+
+typedef struct
+{
+    uint64_t state;
+    uint64_t bits;              /* unused bits of the last output */
+    unsigned int left;          /* positions left in bits */
+} BitPositions;
+
+static BitPositions GetBitPositions(const BloomFilter *filter,
+                                    const void *element)
+{
+    return (BitPositions) { filter->hash_fn(element, BIT_HASH_SEED), 0, 0 };
+}
+
+static inline uint32_t NextBit(BitPositions *positions)
+{
+    if (positions->left == 0)
+    {
+        uint64_t z = (positions->state += UINT64_C(0x9E3779B97F4A7C15));
+        z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+        z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+        positions->bits = z ^ (z >> 31);
+        positions->left = POSITIONS_PER_MIX;
+    }
+
+    const uint32_t bit = positions->bits & (BLOCK_BITS - 1);
+    positions->bits >>= BLOCK_BITS_LOG2;
+    positions->left--;
+    return bit;
+}
+
+void BloomFilterAdd(BloomFilter *filter, const void *element)
+{
+    assert(filter != NULL);
+
+    uint64_t *block = GetBlock(filter, element);
+    BitPositions positions = GetBitPositions(filter, element);
+    for (unsigned int i = 0; i < filter->n_hashes; i++)
+    {
+        const uint32_t bit = NextBit(&positions);
+        block[bit / 64] |= UINT64_C(1) << (bit % 64);
+    }
+}
+
+bool BloomFilterMayContain(const BloomFilter *filter, const void *element)
+{
+    assert(filter != NULL);
+
+    const uint64_t *block = GetBlock(filter, element);
+    BitPositions positions = GetBitPositions(filter, element);
+    for (unsigned int i = 0; i < filter->n_hashes; i++)
+    {
+        const uint32_t bit = NextBit(&positions);
+        if ((block[bit / 64] & (UINT64_C(1) << (bit % 64))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BloomFilterClear(BloomFilter *filter)
+{
+    assert(filter != NULL);
+    memset(filter->bits, 0, filter->n_blocks * BLOCK_WORDS * sizeof(uint64_t));
+}
+
+void BloomFilterDestroy(BloomFilter *filter)
+{
+    if (filter != NULL)
+    {
+        FreeBlocks(filter->bits);
+        free(filter);
+    }
+}
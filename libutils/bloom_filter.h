@@ -0,0 +1,69 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_BLOOM_FILTER_H
+#define CFENGINE_BLOOM_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>     // size_t
+#include <map_common.h> // MapHashFn
+
+/*
+ * Blocked Bloom filter.
+ *
+ * A probabilistic set which never gives false negatives, but gives false
+ * positives with (approximately) the probability requested at creation. Use
+ * it in front of a big Set/StringSet where most lookups miss, to skip the hash
+ * table probe and the equality checks for most of the negative lookups:
+ *
+ *     BloomFilter *filter = BloomFilterNew(StringHash_untyped, size, 0.01);
+ *     // BloomFilterAdd() every element added to the set
+ *     ...
+ *     if (BloomFilterMayContain(filter, str) && StringSetContains(set, str))
+ *
+ * All the bits for one element are set in a single 512-bit (cache line sized)
+ * block, so a lookup costs at most one cache miss. Elements can't be removed.
+ */
+typedef struct BloomFilter_ BloomFilter;
+
+/**
+ * @param hash_fn hash function for the elements, e.g. StringHash_untyped()
+ * @param expected_elements number of elements the filter is sized for
+ * @param false_positive_rate wanted probability of false positives with
+ *                            #expected_elements elements, in (0, 1)
+ */
+BloomFilter *BloomFilterNew(MapHashFn hash_fn, size_t expected_elements,
+                            double false_positive_rate);
+
+void BloomFilterAdd(BloomFilter *filter, const void *element);
+
+/**
+ * @return false if element was definitely not added to the filter, true if it
+ *         probably was
+ */
+bool BloomFilterMayContain(const BloomFilter *filter, const void *element);
+
+void BloomFilterClear(BloomFilter *filter);
+void BloomFilterDestroy(BloomFilter *filter);
+
+#endif
@@ -40,6 +40,12 @@ void CallCleanupFunctions(void)
     pthread_mutex_lock(&cleanup_functions_mutex);
 
     CleanupList *p = cleanup_functions;
+    cleanup_functions = NULL;
+
+    pthread_mutex_unlock(&cleanup_functions_mutex);
+
+    /* Called without the lock, a cleanup function may wait for threads
+     * which call DoCleanupAndExit() or RegisterCleanupFunction() */
     while (p)
     {
         CleanupList *cur = p;
@@ -47,10 +53,6 @@ void CallCleanupFunctions(void)
         p = cur->next;
         free(cur);
     }
-
-    cleanup_functions = NULL;
-
-    pthread_mutex_unlock(&cleanup_functions_mutex);
 }
 
 void DoCleanupAndExit(int ret)
@@ -0,0 +1,113 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <event_count.h>
+#include <mutex.h>              // THREAD_BLOCK_INDEFINITELY
+
+void EventCountInit(EventCount *ec)
+{
+    assert(ec != NULL);
+
+    pthread_mutex_init(&ec->lock, NULL);
+    pthread_cond_init(&ec->cond, NULL);
+    ec->epoch = 0;
+    ec->waiters = 0;
+}
+
+void EventCountDestroy(EventCount *ec)
+{
+    assert(ec != NULL);
+    assert(ec->waiters == 0);
+
+    pthread_cond_destroy(&ec->cond);
+    pthread_mutex_destroy(&ec->lock);
+}
+
+unsigned long EventCountPrepareWait(EventCount *ec)
+{
+    /* Sequentially consistent, so that either the waiter's recheck sees the
+     * notifier's change or the notifier sees the waiter */
+    __atomic_fetch_add(&ec->waiters, 1, __ATOMIC_SEQ_CST);
+    unsigned long key = __atomic_load_n(&ec->epoch, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return key;
+}
+
+void EventCountCancelWait(EventCount *ec)
+{
+    __atomic_fetch_sub(&ec->waiters, 1, __ATOMIC_RELAXED);
+}
+
+bool EventCountWait(EventCount *ec, unsigned long key,
+                    const struct timespec *deadline)
+{
+    bool notified = true;
+
+    pthread_mutex_lock(&ec->lock);
+    while (ec->epoch == key)
+    {
+        if (deadline == NULL)
+        {
+            pthread_cond_wait(&ec->cond, &ec->lock);
+        }
+        else if (pthread_cond_timedwait(&ec->cond, &ec->lock, deadline) == ETIMEDOUT)
+        {
+            notified = (ec->epoch != key);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ec->lock);
+
+    __atomic_fetch_sub(&ec->waiters, 1, __ATOMIC_RELAXED);
+    return notified;
+}
+
+void EventCountNotifyAll(EventCount *ec)
+{
+    /* Pairs with the one in EventCountPrepareWait(), orders the caller's
+     * change before the check for waiters */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ec->waiters, __ATOMIC_RELAXED) == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&ec->lock);
+    __atomic_store_n(&ec->epoch, ec->epoch + 1, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&ec->cond);
+    pthread_mutex_unlock(&ec->lock);
+}
+
+const struct timespec *EventCountDeadline(struct timespec *deadline,
+                                          int timeout)
+{
+    if (timeout == THREAD_BLOCK_INDEFINITELY)
+    {
+        return NULL;
+    }
+
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout;
+    return deadline;
+}
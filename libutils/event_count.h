@@ -0,0 +1,99 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_EVENT_COUNT_H
+#define CFENGINE_EVENT_COUNT_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>       // struct timespec
+
+/*
+ * Event count, lets lock-free data structures block when they have to
+ * (e.g. a queue being empty) without taking a lock on the fast path.
+ *
+ * Waiter:                                  Notifier:
+ *
+ *     while (!TryPop(q, &item))                Push(q, item);
+ *     {                                        EventCountNotifyAll(ec);
+ *         key = EventCountPrepareWait(ec);
+ *         if (TryPop(q, &item))
+ *         {
+ *             EventCountCancelWait(ec);
+ *             break;
+ *         }
+ *         EventCountWait(ec, key, NULL);
+ *     }
+ *
+ * A notification between PrepareWait() and Wait() makes the Wait() return
+ * immediately, so no wakeup is lost. Notifying is just an atomic load while
+ * nobody waits.
+ */
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned long epoch;        /* incremented by every notification */
+    unsigned int waiters;       /* between PrepareWait() and Wait() returning */
+} EventCount;
+
+void EventCountInit(EventCount *ec);
+void EventCountDestroy(EventCount *ec);
+
+/**
+ * @brief Announce the intention to wait, the condition must be rechecked
+ *        after this call and before EventCountWait()
+ * @return Key to pass to EventCountWait()
+ */
+unsigned long EventCountPrepareWait(EventCount *ec);
+
+/**
+ * @brief Don't wait after all, the condition turned out to be satisfied
+ */
+void EventCountCancelWait(EventCount *ec);
+
+/**
+ * @brief Wait for a notification after the EventCountPrepareWait() call
+ *        that returned key
+ * @param deadline Absolute CLOCK_REALTIME time to give up at, NULL to wait
+ *                 indefinitely
+ * @return false if the deadline passed without notification
+ */
+bool EventCountWait(EventCount *ec, unsigned long key,
+                    const struct timespec *deadline);
+
+/**
+ * @brief Wake up all the waiters, call after making the condition true
+ */
+void EventCountNotifyAll(EventCount *ec);
+
+/**
+ * @brief Deadline for EventCountWait() from a timeout in seconds
+ * @param timeout Seconds, or THREAD_BLOCK_INDEFINITELY
+ * @return deadline, or NULL for THREAD_BLOCK_INDEFINITELY
+ */
+const struct timespec *EventCountDeadline(struct timespec *deadline,
+                                          int timeout);
+
+#endif
@@ -0,0 +1,598 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <executor.h>
+#include <alloc.h>
+#include <cleanup.h>
+#include <event_count.h>      // EventCountDeadline()
+#include <logging.h>
+#include <misc_lib.h>         // ProgrammingError(), xclock_gettime(), GetOnlineCPUCount()
+#include <mutex.h>
+
+struct Future_
+{
+    Future *prev;               /* in the executor's queue while pending */
+    Future *next;
+    Executor *executor;
+    ExecutorJobFn *fn;
+    void *data;
+    void *result;
+    FutureState state;
+    int refs;                   /* the caller and the queue/worker */
+    struct timespec submitted;
+};
+
+struct Executor_
+{
+    pthread_mutex_t lock;       /* protects everything below */
+    pthread_cond_t job_queued;
+    pthread_cond_t job_finished;  /* done or cancelled */
+    pthread_cond_t worker_exited;
+    Future *head;               /* queued jobs, oldest first */
+    Future *tail;
+    size_t min_workers;
+    size_t max_workers;
+    int idle_timeout;
+    size_t n_workers;
+    size_t n_idle;
+    size_t n_waiters;           /* threads waiting on job_finished */
+    bool shutdown;
+    pthread_key_t worker_key;   /* set in the executor's worker threads */
+    ExecutorStats stats;
+    double wait_total;
+    double run_total;
+    Executor *next_live;        /* LIVE_EXECUTORS, under LIVE_EXECUTORS_LOCK */
+    bool cleaned_up;            /* under LIVE_EXECUTORS_LOCK */
+    size_t pins;                /* under LIVE_EXECUTORS_LOCK */
+};
+
+/* Executors not yet destroyed, shut down by the cleanup functions */
+static pthread_mutex_t LIVE_EXECUTORS_LOCK = PTHREAD_MUTEX_INITIALIZER; /* GLOBAL_T */
+static Executor *LIVE_EXECUTORS = NULL; /* GLOBAL_T */
+static bool CLEANUP_REGISTERED = false; /* GLOBAL_T */
+/* Signalled when the cleanup lets go of a pinned executor */
+static pthread_cond_t LIVE_EXECUTOR_UNPINNED = PTHREAD_COND_INITIALIZER; /* GLOBAL_T */
+
+static double Elapsed(const struct timespec *from, const struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+/**
+ * @return false on timeout
+ */
+static bool WaitUntil(pthread_cond_t *cond, pthread_mutex_t *lock,
+                      const struct timespec *deadline)
+{
+    if (deadline == NULL)
+    {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+static bool IsWorker(Executor *executor)
+{
+    return pthread_getspecific(executor->worker_key) != NULL;
+}
+
+/* Called with the lock held, frees the future once both sides let go */
+static void FutureRelease(Future *future)
+{
+    assert(future->refs > 0);
+    if (--future->refs == 0)
+    {
+        free(future);
+    }
+}
+
+static void JobFinished(Executor *executor)
+{
+    if (executor->n_waiters > 0)
+    {
+        pthread_cond_broadcast(&executor->job_finished);
+    }
+}
+
+static void QueueUnlink(Executor *executor, Future *future)
+{
+    if (future->prev != NULL)
+    {
+        future->prev->next = future->next;
+    }
+    else
+    {
+        executor->head = future->next;
+    }
+    if (future->next != NULL)
+    {
+        future->next->prev = future->prev;
+    }
+    else
+    {
+        executor->tail = future->prev;
+    }
+    future->prev = future->next = NULL;
+    executor->stats.queued--;
+}
+
+static void CancelQueued(Executor *executor, Future *future)
+{
+    assert(future->state == FUTURE_PENDING);
+
+    QueueUnlink(executor, future);
+    future->state = FUTURE_CANCELLED;
+    executor->stats.cancelled++;
+    FutureRelease(future);
+}
+
+static void *WorkerMain(void *arg)
+{
+    Executor *executor = arg;
+    pthread_setspecific(executor->worker_key, executor);
+
+    ThreadLock(&executor->lock);
+    for (;;)
+    {
+        Future *future = executor->head;
+        if (future == NULL)
+        {
+            if (executor->shutdown)
+            {
+                break;
+            }
+
+            /* Threads above the minimum only wait for so long */
+            struct timespec deadline_buf;
+            const struct timespec *deadline = NULL;
+            if (executor->n_workers > executor->min_workers)
+            {
+                deadline = EventCountDeadline(&deadline_buf,
+                                              executor->idle_timeout);
+            }
+
+            executor->n_idle++;
+            bool timed_out = !WaitUntil(&executor->job_queued,
+                                        &executor->lock, deadline);
+            executor->n_idle--;
+
+            if (timed_out && executor->head == NULL &&
+                executor->n_workers > executor->min_workers)
+            {
+                break;
+            }
+            continue;
+        }
+
+        QueueUnlink(executor, future);
+        future->state = FUTURE_RUNNING;
+        executor->stats.running++;
+
+        struct timespec started;
+        xclock_gettime(CLOCK_MONOTONIC, &started);
+        double wait = Elapsed(&future->submitted, &started);
+        executor->wait_total += wait;
+        executor->stats.wait_max = MAX(executor->stats.wait_max, wait);
+        ThreadUnlock(&executor->lock);
+
+        void *result = future->fn(future->data);
+
+        struct timespec finished;
+        xclock_gettime(CLOCK_MONOTONIC, &finished);
+        double run = Elapsed(&started, &finished);
+
+        ThreadLock(&executor->lock);
+        executor->run_total += run;
+        executor->stats.run_max = MAX(executor->stats.run_max, run);
+        executor->stats.running--;
+        executor->stats.completed++;
+
+        future->result = result;
+        future->state = FUTURE_DONE;
+        FutureRelease(future);
+        JobFinished(executor);
+    }
+
+    executor->n_workers--;
+    pthread_cond_broadcast(&executor->worker_exited);
+    ThreadUnlock(&executor->lock);
+
+    return NULL;
+}
+
+/* Called with the lock held */
+static bool StartWorker(Executor *executor)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    pthread_t thread;
+    int ret = pthread_create(&thread, &attr, WorkerMain, executor);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0)
+    {
+        Log(LOG_LEVEL_ERR,
+            "Failed to start executor thread (pthread_create: %s)",
+            GetErrorStrFromCode(ret));
+        return false;
+    }
+
+    executor->n_workers++;
+    return true;
+}
+
+/* Shuts the executors down one by one, without holding LIVE_EXECUTORS_LOCK
+ * while their running jobs are waited for. Those jobs may create or destroy
+ * executors themselves. The executor being shut down is pinned, so that
+ * ExecutorDestroy() does not free it meanwhile. */
+static void ShutdownLiveExecutors(void)
+{
+    pthread_mutex_lock(&LIVE_EXECUTORS_LOCK);
+    for (;;)
+    {
+        /* Also catches executors created by jobs in the meantime */
+        Executor *executor = LIVE_EXECUTORS;
+        while (executor != NULL && executor->cleaned_up)
+        {
+            executor = executor->next_live;
+        }
+        if (executor == NULL)
+        {
+            break;
+        }
+        executor->cleaned_up = true;
+        executor->pins++;
+        pthread_mutex_unlock(&LIVE_EXECUTORS_LOCK);
+
+        ExecutorShutdown(executor, true);
+
+        pthread_mutex_lock(&LIVE_EXECUTORS_LOCK);
+        if (--executor->pins == 0)
+        {
+            pthread_cond_broadcast(&LIVE_EXECUTOR_UNPINNED);
+        }
+    }
+    /* The cleanup functions are dropped once called, executors created
+     * from now on need a new registration */
+    CLEANUP_REGISTERED = false;
+    pthread_mutex_unlock(&LIVE_EXECUTORS_LOCK);
+}
+
+Executor *ExecutorNew(size_t min_workers, size_t max_workers,
+                      int idle_timeout)
+{
+    if (max_workers == 0)
+    {
+        max_workers = GetOnlineCPUCount();
+    }
+    if (min_workers > max_workers)
+    {
+        ProgrammingError("Executor with more minimum (%zu) than maximum "
+                         "(%zu) workers", min_workers, max_workers);
+    }
+
+    Executor *executor = xcalloc(1, sizeof(Executor));
+    pthread_mutex_init(&executor->lock, NULL);
+    pthread_cond_init(&executor->job_queued, NULL);
+    pthread_cond_init(&executor->job_finished, NULL);
+    pthread_cond_init(&executor->worker_exited, NULL);
+    if (pthread_key_create(&executor->worker_key, NULL) != 0)
+    {
+        ProgrammingError("Failed to create executor's thread key");
+    }
+    executor->min_workers = min_workers;
+    executor->max_workers = max_workers;
+    executor->idle_timeout = idle_timeout;
+
+    ThreadLock(&executor->lock);
+    while (executor->n_workers < min_workers && StartWorker(executor))
+    {
+    }
+    ThreadUnlock(&executor->lock);
+
+    pthread_mutex_lock(&LIVE_EXECUTORS_LOCK);
+    executor->next_live = LIVE_EXECUTORS;
+    LIVE_EXECUTORS = executor;
+    bool register_cleanup = !CLEANUP_REGISTERED;
+    CLEANUP_REGISTERED = true;
+    pthread_mutex_unlock(&LIVE_EXECUTORS_LOCK);
+
+    if (register_cleanup)
+    {
+        RegisterCleanupFunction(ShutdownLiveExecutors);
+    }
+
+    return executor;
+}
+
+void ExecutorShutdown(Executor *executor, bool cancel_pending)
+{
+    assert(executor != NULL);
+
+    /* A job shutting its own executor down can't wait for itself */
+    size_t self = IsWorker(executor) ? 1 : 0;
+
+    ThreadLock(&executor->lock);
+    executor->shutdown = true;
+    if (cancel_pending)
+    {
+        while (executor->head != NULL)
+        {
+            CancelQueued(executor, executor->head);
+        }
+        JobFinished(executor);
+    }
+    pthread_cond_broadcast(&executor->job_queued);
+
+    while (executor->n_workers > self)
+    {
+        pthread_cond_wait(&executor->worker_exited, &executor->lock);
+    }
+
+    /* Nobody is left to run jobs queued while no worker could be started */
+    while (executor->head != NULL && executor->n_workers == 0)
+    {
+        CancelQueued(executor, executor->head);
+        JobFinished(executor);
+    }
+    ThreadUnlock(&executor->lock);
+}
+
+void ExecutorDestroy(Executor *executor)
+{
+    if (executor == NULL)
+    {
+        return;
+    }
+    if (IsWorker(executor))
+    {
+        ProgrammingError("Executor destroyed from within one of its jobs");
+    }
+
+    pthread_mutex_lock(&LIVE_EXECUTORS_LOCK);
+    Executor **p = &LIVE_EXECUTORS;
+    while (*p != executor)
+    {
+        assert(*p != NULL);
+        p = &(*p)->next_live;
+    }
+    *p = executor->next_live;
+    while (executor->pins > 0)
+    {
+        pthread_cond_wait(&LIVE_EXECUTOR_UNPINNED, &LIVE_EXECUTORS_LOCK);
+    }
+    pthread_mutex_unlock(&LIVE_EXECUTORS_LOCK);
+
+    ExecutorShutdown(executor, false);
+
+    pthread_key_delete(executor->worker_key);
+    pthread_cond_destroy(&executor->worker_exited);
+    pthread_cond_destroy(&executor->job_finished);
+    pthread_cond_destroy(&executor->job_queued);
+    pthread_mutex_destroy(&executor->lock);
+    free(executor);
+}
+
+Future *ExecutorSubmit(Executor *executor, ExecutorJobFn *fn, void *data)
+{
+    assert(executor != NULL);
+    assert(fn != NULL);
+
+    Future *future = xcalloc(1, sizeof(Future));
+    future->executor = executor;
+    future->fn = fn;
+    future->data = data;
+    future->state = FUTURE_PENDING;
+    future->refs = 2;
+    xclock_gettime(CLOCK_MONOTONIC, &future->submitted);
+
+    ThreadLock(&executor->lock);
+    if (executor->shutdown)
+    {
+        ThreadUnlock(&executor->lock);
+        free(future);
+        return NULL;
+    }
+
+    future->prev = executor->tail;
+    if (executor->tail != NULL)
+    {
+        executor->tail->next = future;
+    }
+    else
+    {
+        executor->head = future;
+    }
+    executor->tail = future;
+
+    executor->stats.submitted++;
+    executor->stats.queued++;
+    executor->stats.queued_max = MAX(executor->stats.queued_max,
+                                     executor->stats.queued);
+
+    /* Start another thread if the idle ones can't keep up */
+    if (executor->stats.queued > executor->n_idle &&
+        executor->n_workers < executor->max_workers)
+    {
+        StartWorker(executor);
+    }
+    if (executor->n_idle > 0)
+    {
+        pthread_cond_signal(&executor->job_queued);
+    }
+    ThreadUnlock(&executor->lock);
+
+    return future;
+}
+
+bool ExecutorWaitAll(Executor *executor, int timeout)
+{
+    assert(executor != NULL);
+
+    struct timespec deadline_buf;
+    const struct timespec *deadline = EventCountDeadline(&deadline_buf,
+                                                         timeout);
+
+    ThreadLock(&executor->lock);
+    executor->n_waiters++;
+    bool idle = true;
+    while (executor->head != NULL || executor->stats.running > 0)
+    {
+        if (!WaitUntil(&executor->job_finished, &executor->lock, deadline))
+        {
+            idle = (executor->head == NULL && executor->stats.running == 0);
+            break;
+        }
+    }
+    executor->n_waiters--;
+    ThreadUnlock(&executor->lock);
+
+    return idle;
+}
+
+size_t ExecutorCancelAll(Executor *executor)
+{
+    assert(executor != NULL);
+
+    ThreadLock(&executor->lock);
+    size_t n_cancelled = executor->stats.queued;
+    while (executor->head != NULL)
+    {
+        CancelQueued(executor, executor->head);
+    }
+    if (n_cancelled > 0)
+    {
+        JobFinished(executor);
+    }
+    ThreadUnlock(&executor->lock);
+
+    return n_cancelled;
+}
+
+ExecutorStats ExecutorGetStats(Executor *executor)
+{
+    assert(executor != NULL);
+
+    ThreadLock(&executor->lock);
+    ExecutorStats stats = executor->stats;
+    stats.workers = executor->n_workers;
+    stats.idle_workers = executor->n_idle;
+    unsigned long started = stats.submitted - stats.queued - stats.cancelled;
+    if (started > 0)
+    {
+        stats.wait_mean = executor->wait_total / started;
+    }
+    if (stats.completed > 0)
+    {
+        stats.run_mean = executor->run_total / stats.completed;
+    }
+    ThreadUnlock(&executor->lock);
+
+    return stats;
+}
+
+static bool IsFinished(const Future *future)
+{
+    return future->state == FUTURE_DONE || future->state == FUTURE_CANCELLED;
+}
+
+bool FutureWait(Future *future, int timeout)
+{
+    assert(future != NULL);
+    Executor *executor = future->executor;
+
+    struct timespec deadline_buf;
+    const struct timespec *deadline = EventCountDeadline(&deadline_buf,
+                                                         timeout);
+
+    ThreadLock(&executor->lock);
+    executor->n_waiters++;
+    while (!IsFinished(future) &&
+           WaitUntil(&executor->job_finished, &executor->lock, deadline))
+    {
+    }
+    executor->n_waiters--;
+    bool finished = IsFinished(future);
+    ThreadUnlock(&executor->lock);
+
+    return finished;
+}
+
+void *FutureGet(Future *future)
+{
+    assert(future != NULL);
+
+    FutureWait(future, THREAD_BLOCK_INDEFINITELY);
+
+    /* Finished futures don't change anymore */
+    return (future->state == FUTURE_DONE) ? future->result : NULL;
+}
+
+FutureState FutureGetState(Future *future)
+{
+    assert(future != NULL);
+
+    ThreadLock(&future->executor->lock);
+    FutureState state = future->state;
+    ThreadUnlock(&future->executor->lock);
+
+    return state;
+}
+
+bool FutureCancel(Future *future)
+{
+    assert(future != NULL);
+    Executor *executor = future->executor;
+
+    ThreadLock(&executor->lock);
+    bool cancelled = (future->state == FUTURE_PENDING);
+    if (cancelled)
+    {
+        CancelQueued(executor, future);
+        JobFinished(executor);
+    }
+    else
+    {
+        cancelled = (future->state == FUTURE_CANCELLED);
+    }
+    ThreadUnlock(&executor->lock);
+
+    return cancelled;
+}
+
+void FutureDestroy(Future *future)
+{
+    if (future == NULL)
+    {
+        return;
+    }
+
+    Executor *executor = future->executor;
+    ThreadLock(&executor->lock);
+    FutureRelease(future);
+    ThreadUnlock(&executor->lock);
+}
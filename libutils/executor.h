@@ -0,0 +1,158 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_EXECUTOR_H
+#define CFENGINE_EXECUTOR_H
+
+#include <stdbool.h>
+#include <stddef.h>     // size_t
+
+/*
+ * Thread pool running independent jobs, as an alternative to hand written
+ * worker loops around ThreadedQueuePop().
+ *
+ * Unlike the pool in parallel.h, which splits one loop over all CPUs while
+ * the caller waits and takes part, an executor runs jobs asynchronously and
+ * hands their results back through futures. The two pools do not share
+ * threads.
+ *
+ * The pool keeps between min_workers and max_workers threads. Workers above
+ * the minimum are started when jobs queue up and exit after idling for a
+ * while, so min_workers == max_workers gives a fixed size pool.
+ *
+ *     Future *future = ExecutorSubmit(executor, FetchFile, url);
+ *     ...
+ *     Buffer *content = FutureGet(future);
+ *     FutureDestroy(future);
+ *
+ * Jobs are started in submission order. Executors still running at exit are
+ * shut down by the cleanup functions (see cleanup.h): queued jobs are
+ * cancelled and the running ones waited for.
+ */
+
+typedef struct Executor_ Executor;
+typedef struct Future_ Future;
+
+/**
+ * @brief A job, run on some worker thread
+ * @return The result of the job's future
+ */
+typedef void *ExecutorJobFn(void *data);
+
+typedef enum
+{
+    FUTURE_PENDING,             /* queued */
+    FUTURE_RUNNING,
+    FUTURE_DONE,
+    FUTURE_CANCELLED,
+} FutureState;
+
+typedef struct
+{
+    size_t workers;             /* threads running */
+    size_t idle_workers;
+    size_t queued;              /* jobs waiting for a worker */
+    size_t queued_max;          /* highest number of queued jobs so far */
+    size_t running;
+    unsigned long submitted;
+    unsigned long completed;
+    unsigned long cancelled;
+    double wait_mean;           /* seconds from submission to start */
+    double wait_max;
+    double run_mean;            /* seconds from start to completion */
+    double run_max;
+} ExecutorStats;
+
+/**
+  @brief Create an executor and start its minimum number of workers.
+  @param [in] min_workers Threads kept running even when idle.
+  @param [in] max_workers Maximum number of threads, 0 for one per CPU.
+  @param [in] idle_timeout Seconds after which idle threads above
+                           min_workers exit.
+  */
+Executor *ExecutorNew(size_t min_workers, size_t max_workers,
+                      int idle_timeout);
+
+/**
+  @brief Shut the executor down, if not done yet, and free it.
+  @warning All its futures must have been destroyed.
+  */
+void ExecutorDestroy(Executor *executor);
+
+/**
+  @brief Stop accepting jobs and wait for the workers to exit.
+  @param [in] cancel_pending Cancel the queued jobs instead of running them.
+  @note Can be called more than once, also from within a job.
+  */
+void ExecutorShutdown(Executor *executor, bool cancel_pending);
+
+/**
+  @brief Queue fn(data) to run on a worker.
+  @return The job's future to be destroyed by the caller, NULL if the
+          executor is shut down.
+  */
+Future *ExecutorSubmit(Executor *executor, ExecutorJobFn *fn, void *data);
+
+/**
+  @brief Wait until no jobs are queued or running.
+  @param [in] timeout Seconds to wait for, can be THREAD_BLOCK_INDEFINITELY.
+  @return false on timeout.
+  @warning Never returns when called from within a job of the executor.
+  */
+bool ExecutorWaitAll(Executor *executor, int timeout);
+
+/**
+  @brief Cancel all the queued jobs.
+  @return The number of jobs cancelled.
+  */
+size_t ExecutorCancelAll(Executor *executor);
+
+ExecutorStats ExecutorGetStats(Executor *executor);
+
+/**
+  @brief Wait for the job to be done or cancelled.
+  @param [in] timeout Seconds to wait for, can be THREAD_BLOCK_INDEFINITELY.
+  @return false on timeout.
+  */
+bool FutureWait(Future *future, int timeout);
+
+/**
+  @brief Wait for the job and get its result.
+  @return The value returned by the job, NULL if it was cancelled.
+  */
+void *FutureGet(Future *future);
+
+FutureState FutureGetState(Future *future);
+
+/**
+  @brief Cancel the job unless it has already started.
+  @return true if the job is cancelled and will not run.
+  */
+bool FutureCancel(Future *future);
+
+/**
+  @brief Release the future, the job still runs unless cancelled.
+  */
+void FutureDestroy(Future *future);
+
+#endif
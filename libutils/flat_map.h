@@ -0,0 +1,304 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_FLAT_MAP_H
+#define CFENGINE_FLAT_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>    // size_t
+#include <stdint.h>    // int64_t, uint64_t
+#include <alloc.h>     // xcalloc()
+
+/*
+ * Typed flat (open addressing) hash maps.
+ *
+ * Unlike TYPED_MAP_DEFINE(), which wraps the generic #Map and goes through
+ * function pointers and void * for every operation, TYPED_FLAT_MAP_DEFINE()
+ * generates a specialized hash table for the given key and value types:
+ *
+ *  - keys and values are stored by value in one contiguous array, no heap
+ *    node per entry
+ *  - hash_fn and equal_fn are called directly, so the compiler can inline
+ *    them (they can also be macros)
+ *  - linear probing with backward shift deletion, no tombstones
+ *
+ * hash_fn is called as hash_fn(key, seed) and must return unsigned int, just
+ * like #MapHashFn, so StringHash() can be used for char * keys. equal_fn is
+ * called as equal_fn(key1, key2). destroy_key_fn and destroy_value_fn are
+ * called with the key/value (not a pointer to it) when an entry is replaced,
+ * removed or cleared, use FLAT_MAP_NOP_DESTROY for none.
+ *
+ * Put TYPED_FLAT_MAP_DECLARE() in a header and TYPED_FLAT_MAP_DEFINE() in
+ * exactly one .c file, like with TYPED_MAP_DECLARE()/TYPED_MAP_DEFINE().
+ *
+ * Pointers returned by Get and by the iterator are only valid until the next
+ * insertion or removal. Removing entries while iterating is not supported.
+ */
+
+#define FLAT_MAP_NOP_DESTROY(x) ((void) (x))
+
+/* Minimum (and initial) number of slots, must be a power of two. */
+#define FLAT_MAP_MIN_SIZE 16
+
+/* Resize when more than 3/4 of the slots are used. */
+#define FLAT_MAP_OVERLOADED(load, size) ((load) * 4 > (size) * 3)
+
+/**
+ * Hash function for integer keys, usable as hash_fn in typed flat maps.
+ *
+ * Flat maps use the low bits of the hash, so every one of them must depend
+ * on all the bits of the key, or keys differing only in their high bits
+ * (shifted values, ids packed in the high word) end up in one probe chain.
+ * A multiplication only carries towards the high bits, hence the xor-shifts
+ * of the splitmix64 finalizer.
+ */
+static inline unsigned int Int64Hash(int64_t key, unsigned int seed)
+{
+    uint64_t h = ((uint64_t) key ^ seed) + 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned int) (h ^ (h >> 31));
+}
+
+static inline bool Int64Equal(int64_t key1, int64_t key2)
+{
+    return key1 == key2;
+}
+
+#define TYPED_FLAT_MAP_DECLARE(Prefix, KeyType, ValueType)              \
+    typedef struct                                                      \
+    {                                                                   \
+        KeyType key;                                                    \
+        ValueType value;                                                \
+    } Prefix##FlatMapEntry;                                             \
+                                                                        \
+    typedef struct                                                      \
+    {                                                                   \
+        Prefix##FlatMapEntry *entries;                                  \
+        unsigned char *used;                                            \
+        size_t size;                                                    \
+        size_t load;                                                    \
+    } Prefix##FlatMap;                                                  \
+                                                                        \
+    typedef struct                                                      \
+    {                                                                   \
+        Prefix##FlatMap *map;                                           \
+        size_t pos;                                                     \
+    } Prefix##FlatMapIterator;                                          \
+                                                                        \
+    Prefix##FlatMap *Prefix##FlatMapNew(void);                          \
+    Prefix##FlatMap *Prefix##FlatMapNewWithSize(size_t expected);       \
+    bool Prefix##FlatMapInsert(Prefix##FlatMap *map, KeyType key, ValueType value); \
+    bool Prefix##FlatMapHasKey(const Prefix##FlatMap *map, const KeyType key); \
+    ValueType *Prefix##FlatMapGet(const Prefix##FlatMap *map, const KeyType key); \
+    bool Prefix##FlatMapRemove(Prefix##FlatMap *map, const KeyType key); \
+    void Prefix##FlatMapClear(Prefix##FlatMap *map);                    \
+    size_t Prefix##FlatMapSize(const Prefix##FlatMap *map);             \
+    void Prefix##FlatMapDestroy(Prefix##FlatMap *map);                  \
+    Prefix##FlatMapIterator Prefix##FlatMapIteratorInit(Prefix##FlatMap *map); \
+    Prefix##FlatMapEntry *Prefix##FlatMapIteratorNext(Prefix##FlatMapIterator *iter); \
+
+#define TYPED_FLAT_MAP_DEFINE(Prefix, KeyType, ValueType, hash_fn, equal_fn, \
+                              destroy_key_fn, destroy_value_fn)         \
+                                                                        \
+    static inline size_t Prefix##FlatMapHome_(const Prefix##FlatMap *map, \
+                                              const KeyType key)        \
+    {                                                                   \
+        return hash_fn(key, 0) & (map->size - 1);                       \
+    }                                                                   \
+                                                                        \
+    /* Returns the slot holding key, or the empty slot where it belongs. */ \
+    static inline size_t Prefix##FlatMapFind_(const Prefix##FlatMap *map, \
+                                              const KeyType key)        \
+    {                                                                   \
+        const size_t mask = map->size - 1;                              \
+        size_t i = Prefix##FlatMapHome_(map, key);                      \
+        while (map->used[i] && !equal_fn(map->entries[i].key, key))     \
+        {                                                               \
+            i = (i + 1) & mask;                                         \
+        }                                                               \
+        return i;                                                       \
+    }                                                                   \
+                                                                        \
+    static void Prefix##FlatMapResize_(Prefix##FlatMap *map, size_t new_size) \
+    {                                                                   \
+        Prefix##FlatMapEntry *old_entries = map->entries;               \
+        unsigned char *old_used = map->used;                            \
+        const size_t old_size = map->size;                              \
+                                                                        \
+        map->entries = xcalloc(new_size, sizeof(Prefix##FlatMapEntry)); \
+        map->used = xcalloc(new_size, sizeof(unsigned char));           \
+        map->size = new_size;                                           \
+                                                                        \
+        for (size_t i = 0; i < old_size; i++)                           \
+        {                                                               \
+            if (old_used[i])                                            \
+            {                                                           \
+                size_t slot = Prefix##FlatMapFind_(map, old_entries[i].key); \
+                map->entries[slot] = old_entries[i];                    \
+                map->used[slot] = 1;                                    \
+            }                                                           \
+        }                                                               \
+        free(old_entries);                                              \
+        free(old_used);                                                 \
+    }                                                                   \
+                                                                        \
+    Prefix##FlatMap *Prefix##FlatMapNewWithSize(size_t expected)        \
+    {                                                                   \
+        Prefix##FlatMap *map = xcalloc(1, sizeof(Prefix##FlatMap));     \
+        size_t size = FLAT_MAP_MIN_SIZE;                                \
+        while (FLAT_MAP_OVERLOADED(expected, size))                     \
+        {                                                               \
+            size <<= 1;                                                 \
+        }                                                               \
+        map->entries = xcalloc(size, sizeof(Prefix##FlatMapEntry));     \
+        map->used = xcalloc(size, sizeof(unsigned char));               \
+        map->size = size;                                               \
+        return map;                                                     \
+    }                                                                   \
+                                                                        \
+    Prefix##FlatMap *Prefix##FlatMapNew(void)                           \
+    {                                                                   \
+        return Prefix##FlatMapNewWithSize(0);                           \
+    }                                                                   \
+                                                                        \
+    bool Prefix##FlatMapInsert(Prefix##FlatMap *map, KeyType key, ValueType value) \
+    {                                                                   \
+        assert(map != NULL);                                            \
+        size_t i = Prefix##FlatMapFind_(map, key);                      \
+        if (map->used[i])                                               \
+        {                                                               \
+            destroy_key_fn(map->entries[i].key);                        \
+            destroy_value_fn(map->entries[i].value);                    \
+            map->entries[i].key = key;                                  \
+            map->entries[i].value = value;                              \
+            return true;                                                \
+        }                                                               \
+                                                                        \
+        if (FLAT_MAP_OVERLOADED(map->load + 1, map->size))              \
+        {                                                               \
+            Prefix##FlatMapResize_(map, map->size << 1);                \
+            i = Prefix##FlatMapFind_(map, key);                         \
+        }                                                               \
+        map->entries[i].key = key;                                      \
+        map->entries[i].value = value;                                  \
+        map->used[i] = 1;                                               \
+        map->load++;                                                    \
+        return false;                                                   \
+    }                                                                   \
+                                                                        \
+    bool Prefix##FlatMapHasKey(const Prefix##FlatMap *map, const KeyType key) \
+    {                                                                   \
+        assert(map != NULL);                                            \
+        return map->used[Prefix##FlatMapFind_(map, key)];               \
+    }                                                                   \
+                                                                        \
+    ValueType *Prefix##FlatMapGet(const Prefix##FlatMap *map, const KeyType key) \
+    {                                                                   \
+        assert(map != NULL);                                            \
+        size_t i = Prefix##FlatMapFind_(map, key);                      \
+        return map->used[i] ? &map->entries[i].value : NULL;            \
+    }                                                                   \
+                                                                        \
+    bool Prefix##FlatMapRemove(Prefix##FlatMap *map, const KeyType key) \
+    {                                                                   \
+        assert(map != NULL);                                            \
+        size_t i = Prefix##FlatMapFind_(map, key);                      \
+        if (!map->used[i])                                              \
+        {                                                               \
+            return false;                                               \
+        }                                                               \
+        destroy_key_fn(map->entries[i].key);                            \
+        destroy_value_fn(map->entries[i].value);                        \
+                                                                        \
+        /* Backward shift: move following entries of the probe sequence \
+         * into the hole unless their home slot is in (hole, j]. */     \
+        const size_t mask = map->size - 1;                              \
+        for (size_t j = (i + 1) & mask; map->used[j]; j = (j + 1) & mask) \
+        {                                                               \
+            size_t home = Prefix##FlatMapHome_(map, map->entries[j].key); \
+            bool stays = (i <= j) ? (i < home && home <= j)             \
+                                  : (i < home || home <= j);            \
+            if (!stays)                                                 \
+            {                                                           \
+                map->entries[i] = map->entries[j];                      \
+                i = j;                                                  \
+            }                                                           \
+        }                                                               \
+        map->used[i] = 0;                                               \
+        map->load--;                                                    \
+        return true;                                                    \
+    }                                                                   \
+                                                                        \
+    void Prefix##FlatMapClear(Prefix##FlatMap *map)                     \
+    {                                                                   \
+        assert(map != NULL);                                            \
+        for (size_t i = 0; i < map->size; i++)                          \
+        {                                                               \
+            if (map->used[i])                                           \
+            {                                                           \
+                destroy_key_fn(map->entries[i].key);                    \
+                destroy_value_fn(map->entries[i].value);                \
+                map->used[i] = 0;                                       \
+            }                                                           \
+        }                                                               \
+        map->load = 0;                                                  \
+    }                                                                   \
+                                                                        \
+    size_t Prefix##FlatMapSize(const Prefix##FlatMap *map)              \
+    {                                                                   \
+        assert(map != NULL);                                            \
+        return map->load;                                               \
+    }                                                                   \
+                                                                        \
+    void Prefix##FlatMapDestroy(Prefix##FlatMap *map)                   \
+    {                                                                   \
+        if (map != NULL)                                                \
+        {                                                               \
+            Prefix##FlatMapClear(map);                                  \
+            free(map->entries);                                         \
+            free(map->used);                                            \
+            free(map);                                                  \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    Prefix##FlatMapIterator Prefix##FlatMapIteratorInit(Prefix##FlatMap *map) \
+    {                                                                   \
+        assert(map != NULL);                                            \
+        return (Prefix##FlatMapIterator) { map, 0 };                    \
+    }                                                                   \
+                                                                        \
+    Prefix##FlatMapEntry *Prefix##FlatMapIteratorNext(Prefix##FlatMapIterator *iter) \
+    {                                                                   \
+        assert(iter != NULL);                                           \
+        for (; iter->pos < iter->map->size; iter->pos++)                \
+        {                                                               \
+            if (iter->map->used[iter->pos])                             \
+            {                                                           \
+                return &iter->map->entries[iter->pos++];                \
+            }                                                           \
+        }                                                               \
+        return NULL;                                                    \
+    }                                                                   \
+
+#endif
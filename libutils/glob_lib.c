@@ -759,7 +759,7 @@ Seq *GlobFind(const char *pattern)
     }
 
     StringSetDestroy(expanded);
-    SeqSort(matches, StrCmpWrapper, NULL);
+    SeqSortStrings(matches, false);
 
     return matches;
 }
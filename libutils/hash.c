@@ -32,6 +32,7 @@
 #include <misc_lib.h>
 #include <file_lib.h>
 #include <string_lib.h>
+#include <perfect_hash.h>
 
 
 static const char *const CF_DIGEST_TYPES[10] =
@@ -358,18 +359,25 @@ HashSize HashLength(const Hash *hash)
 }
 
 /* Class methods */
+static pthread_once_t digest_types_table_once = PTHREAD_ONCE_INIT; /* GLOBAL_T */
+static StringPerfectHash *digest_types_table = NULL; /* GLOBAL_T */
+
+static void DigestTypesTableInit(void)
+{
+    digest_types_table = StringPerfectHashNew(CF_DIGEST_TYPES,
+                                              HASH_METHOD_NONE, false);
+}
+
 HashMethod HashIdFromName(const char *hash_name)
 {
-    int i;
-    for (i = 0; CF_DIGEST_TYPES[i] != NULL; i++)
+    if (hash_name == NULL)
     {
-        if (hash_name && (strcmp(hash_name, CF_DIGEST_TYPES[i]) == 0))
-        {
-            return (HashMethod) i;
-        }
+        return HASH_METHOD_NONE;
     }
 
-    return HASH_METHOD_NONE;
+    pthread_once(&digest_types_table_once, &DigestTypesTableInit);
+    const ssize_t i = StringPerfectHashLookup(digest_types_table, hash_name);
+    return (i >= 0) ? (HashMethod) i : HASH_METHOD_NONE;
 }
 
 const char *HashNameFromId(HashMethod hash_id)
@@ -31,6 +31,10 @@
 #define MAX_LOAD_FACTOR 0.75
 #define MIN_LOAD_FACTOR 0.35
 
+/* Slabs double in size from MIN to MAX number of items. */
+#define MIN_SLAB_ITEMS 16
+#define MAX_SLAB_ITEMS 4096
+
 HashMap *HashMapNew(MapHashFn hash_fn, MapKeyEqualFn equal_fn,
                     MapDestroyDataFn destroy_key_fn,
                     MapDestroyDataFn destroy_value_fn,
@@ -62,6 +66,56 @@ HashMap *HashMapNew(MapHashFn hash_fn, MapKeyEqualFn equal_fn,
     return map;
 }
 
+/*
+ * Instead of a malloc()/free() per insertion/removal, bucket list items are
+ * carved out of slabs owned by the map and removed items are put on a free
+ * list for reuse. The slabs are only released as a whole, on
+ * HashMapClear() and when the map is destroyed.
+ */
+static BucketListItem *AllocBucketListItem(HashMap *map)
+{
+    BucketListItem *item = map->free_items;
+    if (item != NULL)
+    {
+        map->free_items = item->next;
+        return item;
+    }
+
+    BucketListSlab *slab = map->slabs;
+    if (slab == NULL || slab->used == slab->size)
+    {
+        size_t size = (slab == NULL) ? MIN_SLAB_ITEMS
+                                     : MIN(slab->size * 2, MAX_SLAB_ITEMS);
+        BucketListSlab *new_slab = xmalloc(sizeof(BucketListSlab) +
+                                           size * sizeof(BucketListItem));
+        new_slab->next = slab;
+        new_slab->size = size;
+        new_slab->used = 0;
+        map->slabs = new_slab;
+        slab = new_slab;
+    }
+    return &slab->items[slab->used++];
+}
+
+static void FreeBucketListItem(HashMap *map, BucketListItem *item)
+{
+    item->next = map->free_items;
+    map->free_items = item;
+}
+
+static void FreeSlabs(HashMap *map)
+{
+    BucketListSlab *slab = map->slabs;
+    while (slab != NULL)
+    {
+        BucketListSlab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    map->slabs = NULL;
+    map->free_items = NULL;
+}
+
 static unsigned int HashMapGetBucket(const HashMap *map, const void *key)
 {
     assert(map != NULL);
@@ -102,6 +156,29 @@ static void HashMapResize(HashMap *map, size_t new_size)
     free (old_buckets);
 }
 
+size_t HashMapSizeForCapacity(size_t capacity)
+{
+    size_t size = MIN_HASHMAP_BUCKETS;
+    while ((size < MAX_HASHMAP_BUCKETS) &&
+           (capacity > (size_t) (size * MAX_LOAD_FACTOR)))
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+void HashMapReserve(HashMap *map, size_t capacity)
+{
+    assert(map != NULL);
+
+    const size_t new_size = HashMapSizeForCapacity(capacity);
+    if (new_size > map->size)
+    {
+        HashMapResize(map, new_size);
+    }
+    map->init_size = MAX(map->init_size, new_size);
+}
+
 /**
  * @retval true if value was preexisting in the map and got replaced.
  */
@@ -130,7 +207,7 @@ bool HashMapInsert(HashMap *map, void *key, void *value)
         }
     }
 
-    BucketListItem *i = xcalloc(1, sizeof(BucketListItem));
+    BucketListItem *i = AllocBucketListItem(map);
     i->value.key = key;
     i->value.value = value;
     i->next = map->buckets[bucket];
@@ -169,7 +246,7 @@ bool HashMapRemove(HashMap *map, const void *key)
                 map->destroy_value_fn(cur->value.value);
             }
             *prev = cur->next;
-            free(cur);
+            FreeBucketListItem(map, cur);
             map->load--;
             if ((map->load < map->min_threshold) && (map->size > map->init_size))
 
@@ -200,64 +277,43 @@ MapKeyValue *HashMapGet(const HashMap *map, const void *key)
     return NULL;
 }
 
-static void FreeBucketListItem(HashMap *map, BucketListItem *item)
-{
-    if (item->next)
-    {
-        FreeBucketListItem(map, item->next);
-    }
-
-    if (map->destroy_key_fn != NULL)
-    {
-        map->destroy_key_fn(item->value.key);
-    }
-    if (map->destroy_value_fn != NULL)
-    {
-        map->destroy_value_fn(item->value.value);
-    }
-    free(item);
-    map->load--;
-}
-
-/* Do not destroy value item */
-static void FreeBucketListItemSoft(HashMap *map, BucketListItem *item)
-{
-    if (item->next)
-    {
-        FreeBucketListItemSoft(map, item->next);
-    }
-
-    map->destroy_key_fn(item->value.key);
-    free(item);
-    map->load--;
-}
-
-void HashMapClear(HashMap *map)
+/* Destroys the keys and values, the items themselves are freed with the
+ * slabs. */
+static void DestroyBucketLists(HashMap *map, bool destroy_values)
 {
     for (size_t i = 0; i < map->size; ++i)
     {
-        if (map->buckets[i])
+        for (BucketListItem *item = map->buckets[i];
+             item != NULL;
+             item = item->next)
         {
-            FreeBucketListItem(map, map->buckets[i]);
+            if (map->destroy_key_fn != NULL)
+            {
+                map->destroy_key_fn(item->value.key);
+            }
+            if (destroy_values && (map->destroy_value_fn != NULL))
+            {
+                map->destroy_value_fn(item->value.value);
+            }
+            map->load--;
         }
         map->buckets[i] = NULL;
     }
     assert(map->load == 0);
+    FreeSlabs(map);
+}
+
+void HashMapClear(HashMap *map)
+{
+    DestroyBucketLists(map, true);
 }
 
+/* Do not destroy value item */
 void HashMapSoftDestroy(HashMap *map)
 {
     if (map)
     {
-        for (size_t i = 0; i < map->size; ++i)
-        {
-            if (map->buckets[i])
-            {
-                FreeBucketListItemSoft(map, map->buckets[i]);
-            }
-            map->buckets[i] = NULL;
-        }
-
+        DestroyBucketLists(map, false);
         free(map->buckets);
         free(map);
     }
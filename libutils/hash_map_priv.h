@@ -34,6 +34,15 @@ typedef struct BucketListItem_
     struct BucketListItem_ *next;
 } BucketListItem;
 
+/* Bucket list items are allocated from per-map slabs. */
+typedef struct BucketListSlab_
+{
+    struct BucketListSlab_ *next;
+    size_t size;
+    size_t used;
+    BucketListItem items[];
+} BucketListSlab;
+
 typedef struct
 {
     MapHashFn hash_fn;
@@ -46,6 +55,8 @@ typedef struct
     size_t load;
     size_t max_threshold;
     size_t min_threshold;
+    BucketListSlab *slabs;      /* newest first */
+    BucketListItem *free_items; /* linked through BucketListItem::next */
 } HashMap;
 
 typedef struct
@@ -60,6 +71,17 @@ HashMap *HashMapNew(MapHashFn hash_fn, MapKeyEqualFn equal_fn,
                     MapDestroyDataFn destroy_value_fn,
                     size_t init_size);
 
+/**
+ * Make room for #capacity elements without further resizing. The map is not
+ * shrunk below that size on removals.
+ */
+void HashMapReserve(HashMap *map, size_t capacity);
+
+/**
+ * Number of buckets needed to hold #capacity elements without resizing.
+ */
+size_t HashMapSizeForCapacity(size_t capacity);
+
 bool HashMapInsert(HashMap *map, void *key, void *value);
 bool HashMapRemove(HashMap *map, const void *key);
 MapKeyValue *HashMapGet(const HashMap *map, const void *key);
@@ -0,0 +1,162 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <int_map.h>
+#include <flat_map.h>
+#include <alloc.h>
+
+TYPED_FLAT_MAP_DECLARE(Int64Ptr, int64_t, void *)
+TYPED_FLAT_MAP_DEFINE(Int64Ptr, int64_t, void *, Int64Hash, Int64Equal,
+                      FLAT_MAP_NOP_DESTROY, FLAT_MAP_NOP_DESTROY)
+
+struct IntMap_
+{
+    Int64PtrFlatMap *impl;
+    MapDestroyDataFn destroy_value_fn;
+};
+
+IntMap *IntMapNewWithSize(size_t expected, MapDestroyDataFn destroy_value_fn)
+{
+    IntMap *map = xcalloc(1, sizeof(IntMap));
+    map->impl = Int64PtrFlatMapNewWithSize(expected);
+    map->destroy_value_fn = destroy_value_fn;
+    return map;
+}
+
+IntMap *IntMapNew(MapDestroyDataFn destroy_value_fn)
+{
+    return IntMapNewWithSize(0, destroy_value_fn);
+}
+
+bool IntMapInsert(IntMap *map, int64_t key, void *value)
+{
+    assert(map != NULL);
+
+    void **existing = Int64PtrFlatMapGet(map->impl, key);
+    if (existing != NULL)
+    {
+        if (map->destroy_value_fn != NULL && *existing != value)
+        {
+            map->destroy_value_fn(*existing);
+        }
+        *existing = value;
+        return true;
+    }
+
+    Int64PtrFlatMapInsert(map->impl, key, value);
+    return false;
+}
+
+bool IntMapHasKey(const IntMap *map, int64_t key)
+{
+    assert(map != NULL);
+    return Int64PtrFlatMapHasKey(map->impl, key);
+}
+
+void *IntMapGet(const IntMap *map, int64_t key)
+{
+    assert(map != NULL);
+    void **value = Int64PtrFlatMapGet(map->impl, key);
+    return (value != NULL) ? *value : NULL;
+}
+
+bool IntMapRemove(IntMap *map, int64_t key)
+{
+    assert(map != NULL);
+
+    if (map->destroy_value_fn != NULL)
+    {
+        void **value = Int64PtrFlatMapGet(map->impl, key);
+        if (value == NULL)
+        {
+            return false;
+        }
+        map->destroy_value_fn(*value);
+    }
+    return Int64PtrFlatMapRemove(map->impl, key);
+}
+
+size_t IntMapSize(const IntMap *map)
+{
+    assert(map != NULL);
+    return Int64PtrFlatMapSize(map->impl);
+}
+
+void IntMapClear(IntMap *map)
+{
+    assert(map != NULL);
+
+    if (map->destroy_value_fn != NULL)
+    {
+        Int64PtrFlatMapIterator i = Int64PtrFlatMapIteratorInit(map->impl);
+        Int64PtrFlatMapEntry *entry;
+        while ((entry = Int64PtrFlatMapIteratorNext(&i)) != NULL)
+        {
+            map->destroy_value_fn(entry->value);
+        }
+    }
+    Int64PtrFlatMapClear(map->impl);
+}
+
+void IntMapDestroy(IntMap *map)
+{
+    if (map != NULL)
+    {
+        IntMapClear(map);
+        Int64PtrFlatMapDestroy(map->impl);
+        free(map);
+    }
+}
+
+/******************************************************************************/
+
+IntMapIterator IntMapIteratorInit(const IntMap *map)
+{
+    assert(map != NULL);
+    return (IntMapIterator) { map, 0 };
+}
+
+bool IntMapIteratorNext(IntMapIterator *i, int64_t *key, void **value)
+{
+    assert(i != NULL);
+
+    const Int64PtrFlatMap *impl = i->map->impl;
+    for (; i->pos < impl->size; i->pos++)
+    {
+        if (impl->used[i->pos])
+        {
+            if (key != NULL)
+            {
+                *key = impl->entries[i->pos].key;
+            }
+            if (value != NULL)
+            {
+                *value = impl->entries[i->pos].value;
+            }
+            i->pos++;
+            return true;
+        }
+    }
+    return false;
+}
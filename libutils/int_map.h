@@ -0,0 +1,96 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_INT_MAP_H
+#define CFENGINE_INT_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>     // size_t
+#include <stdint.h>     // int64_t
+#include <map_common.h> // MapDestroyDataFn
+
+/*
+ * Hash map with int64_t keys (pids, uids, inode numbers, ...).
+ *
+ * Contrary to Map with IdentityHashFn, there is no heap node per entry and no
+ * indirect call per probe: entries live in one open addressing table (see
+ * flat_map.h) and keys are hashed with Int64Hash().
+ */
+typedef struct IntMap_ IntMap;
+
+typedef struct
+{
+    const IntMap *map;
+    size_t pos;
+} IntMapIterator;
+
+/**
+ * @param destroy_value_fn called on values removed from the map, may be NULL
+ */
+IntMap *IntMapNew(MapDestroyDataFn destroy_value_fn);
+
+/**
+ * Same as IntMapNew(), but pre-sized to hold #expected entries without
+ * resizing.
+ */
+IntMap *IntMapNewWithSize(size_t expected, MapDestroyDataFn destroy_value_fn);
+
+/**
+ * Insert a key-value pair in the map. If the key is in the map, the value
+ * gets replaced and the old value is destroyed.
+ *
+ * @retval true if key exists already.
+ */
+bool IntMapInsert(IntMap *map, int64_t key, void *value);
+
+bool IntMapHasKey(const IntMap *map, int64_t key);
+
+/*
+ * Returns the value if the key is in map, NULL otherwise. To distinguish
+ * between NULL as a value and NULL as a lack of entry, use IntMapHasKey.
+ */
+void *IntMapGet(const IntMap *map, int64_t key);
+
+/*
+ * Remove key/value pair from the map. Returns 'true' if key was present in the
+ * map.
+ */
+bool IntMapRemove(IntMap *map, int64_t key);
+
+size_t IntMapSize(const IntMap *map);
+void IntMapClear(IntMap *map);
+void IntMapDestroy(IntMap *map);
+
+/*
+ * IntMapIterator i = IntMapIteratorInit(map);
+ * int64_t key;
+ * void *value;
+ * while (IntMapIteratorNext(&i, &key, &value))
+ * {
+ *     // do something with key, value
+ * }
+ */
+IntMapIterator IntMapIteratorInit(const IntMap *map);
+bool IntMapIteratorNext(IntMapIterator *i, int64_t *key, void **value);
+
+#endif
@@ -0,0 +1,252 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <int_set.h>
+#include <flat_map.h>
+#include <alloc.h>
+
+TYPED_FLAT_MAP_DECLARE(Int64Flag, int64_t, unsigned char)
+TYPED_FLAT_MAP_DEFINE(Int64Flag, int64_t, unsigned char, Int64Hash, Int64Equal,
+                      FLAT_MAP_NOP_DESTROY, FLAT_MAP_NOP_DESTROY)
+
+#define BITS_PER_WORD 64
+
+/* Widest range given a bitset (8 MiB), wider ones start out hashed */
+#define MAX_DENSE_RANGE (UINT64_C(1) << 26)
+
+/*
+ * hashed is used as a flag "this set is not a bitset (anymore)", just like
+ * Map uses hash_fn to tell ArrayMap from HashMap.
+ */
+struct IntSet_
+{
+    Int64FlagFlatMap *hashed;
+
+    /* Bitset backend, valid if hashed == NULL */
+    uint64_t *bits;
+    int64_t min;
+    uint64_t range;             /* number of values covered */
+    size_t count;
+};
+
+static bool IsInRange(const IntSet *set, int64_t element)
+{
+    return (element >= set->min) &&
+        ((uint64_t) element - (uint64_t) set->min < set->range);
+}
+
+static bool BitGet(const IntSet *set, uint64_t bit)
+{
+    return (set->bits[bit / BITS_PER_WORD] >> (bit % BITS_PER_WORD)) & 1;
+}
+
+IntSet *IntSetNew(void)
+{
+    IntSet *set = xcalloc(1, sizeof(IntSet));
+    set->hashed = Int64FlagFlatMapNew();
+    return set;
+}
+
+IntSet *IntSetNewRange(int64_t min, int64_t max)
+{
+    assert(max >= min);
+
+    /* Also catches [INT64_MIN, INT64_MAX], whose size overflows to 0 */
+    const uint64_t range = (uint64_t) max - (uint64_t) min + 1;
+    if (range == 0 || range > MAX_DENSE_RANGE)
+    {
+        return IntSetNew();
+    }
+
+    IntSet *set = xcalloc(1, sizeof(IntSet));
+    set->min = min;
+    set->range = range;
+    set->bits = xcalloc(set->range / BITS_PER_WORD + 1, sizeof(uint64_t));
+    return set;
+}
+
+bool IntSetIsDense(const IntSet *set)
+{
+    assert(set != NULL);
+    return set->hashed == NULL;
+}
+
+static void ConvertToHashed(IntSet *set)
+{
+    assert(IntSetIsDense(set));
+
+    Int64FlagFlatMap *hashed = Int64FlagFlatMapNewWithSize(set->count * 2);
+    IntSetIterator i = IntSetIteratorInit(set);
+    int64_t element;
+    while (IntSetIteratorNext(&i, &element))
+    {
+        Int64FlagFlatMapInsert(hashed, element, 1);
+    }
+
+    free(set->bits);
+    set->bits = NULL;
+    set->hashed = hashed;
+}
+
+bool IntSetAdd(IntSet *set, int64_t element)
+{
+    assert(set != NULL);
+
+    if (IntSetIsDense(set))
+    {
+        if (IsInRange(set, element))
+        {
+            const uint64_t bit = (uint64_t) element - (uint64_t) set->min;
+            if (BitGet(set, bit))
+            {
+                return false;
+            }
+            set->bits[bit / BITS_PER_WORD] |= (UINT64_C(1) << (bit % BITS_PER_WORD));
+            set->count++;
+            return true;
+        }
+
+        /* Does not fit in the bitset, must convert to hash table. */
+        ConvertToHashed(set);
+    }
+
+    return !Int64FlagFlatMapInsert(set->hashed, element, 1);
+}
+
+bool IntSetContains(const IntSet *set, int64_t element)
+{
+    assert(set != NULL);
+
+    if (IntSetIsDense(set))
+    {
+        return IsInRange(set, element) &&
+            BitGet(set, (uint64_t) element - (uint64_t) set->min);
+    }
+    return Int64FlagFlatMapHasKey(set->hashed, element);
+}
+
+bool IntSetRemove(IntSet *set, int64_t element)
+{
+    assert(set != NULL);
+
+    if (IntSetIsDense(set))
+    {
+        if (!IntSetContains(set, element))
+        {
+            return false;
+        }
+        const uint64_t bit = (uint64_t) element - (uint64_t) set->min;
+        set->bits[bit / BITS_PER_WORD] &= ~(UINT64_C(1) << (bit % BITS_PER_WORD));
+        set->count--;
+        return true;
+    }
+    return Int64FlagFlatMapRemove(set->hashed, element);
+}
+
+size_t IntSetSize(const IntSet *set)
+{
+    assert(set != NULL);
+    return IntSetIsDense(set) ? set->count : Int64FlagFlatMapSize(set->hashed);
+}
+
+void IntSetClear(IntSet *set)
+{
+    assert(set != NULL);
+
+    if (IntSetIsDense(set))
+    {
+        memset(set->bits, 0,
+               (set->range / BITS_PER_WORD + 1) * sizeof(uint64_t));
+        set->count = 0;
+    }
+    else
+    {
+        Int64FlagFlatMapClear(set->hashed);
+    }
+}
+
+void IntSetDestroy(IntSet *set)
+{
+    if (set != NULL)
+    {
+        Int64FlagFlatMapDestroy(set->hashed);
+        free(set->bits);
+        free(set);
+    }
+}
+
+/******************************************************************************/
+
+IntSetIterator IntSetIteratorInit(const IntSet *set)
+{
+    assert(set != NULL);
+    return (IntSetIterator) { set, 0 };
+}
+
+bool IntSetIteratorNext(IntSetIterator *i, int64_t *element)
+{
+    assert(i != NULL);
+    const IntSet *set = i->set;
+
+    if (IntSetIsDense(set))
+    {
+        while (i->pos < set->range)
+        {
+            /* Skip whole empty words at once. */
+            const uint64_t word = set->bits[i->pos / BITS_PER_WORD] >>
+                (i->pos % BITS_PER_WORD);
+            if (word == 0)
+            {
+                i->pos += BITS_PER_WORD - (i->pos % BITS_PER_WORD);
+                continue;
+            }
+            if (word & 1)
+            {
+                if (element != NULL)
+                {
+                    *element = (int64_t) ((uint64_t) set->min + i->pos);
+                }
+                i->pos++;
+                return true;
+            }
+            i->pos++;
+        }
+        return false;
+    }
+
+    const Int64FlagFlatMap *hashed = set->hashed;
+    for (; i->pos < hashed->size; i->pos++)
+    {
+        if (hashed->used[i->pos])
+        {
+            if (element != NULL)
+            {
+                *element = hashed->entries[i->pos].key;
+            }
+            i->pos++;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,85 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_INT_SET_H
+#define CFENGINE_INT_SET_H
+
+#include <stdbool.h>
+#include <stddef.h>     // size_t
+#include <stdint.h>     // int64_t
+
+/*
+ * Set of int64_t values.
+ *
+ * A set created with IntSetNewRange() is a plain bitset covering the given
+ * range, which is both smaller and faster than a hash table when the values
+ * are dense (uids, small pids, ...). As soon as a value outside of the range
+ * is added, the set is converted into an open addressing hash table, which is
+ * what IntSetNew() starts with.
+ */
+typedef struct IntSet_ IntSet;
+
+typedef struct
+{
+    const IntSet *set;
+    size_t pos;
+} IntSetIterator;
+
+IntSet *IntSetNew(void);
+
+/**
+ * Create a set backed by a bitset for values in [min, max].
+ * @note Ranges of more than 2^26 values get a hash table right away.
+ */
+IntSet *IntSetNewRange(int64_t min, int64_t max);
+
+/**
+ * @retval true if element was not in the set yet.
+ */
+bool IntSetAdd(IntSet *set, int64_t element);
+bool IntSetContains(const IntSet *set, int64_t element);
+bool IntSetRemove(IntSet *set, int64_t element);
+size_t IntSetSize(const IntSet *set);
+void IntSetClear(IntSet *set);
+void IntSetDestroy(IntSet *set);
+
+/**
+ * Whether the set is (still) backed by a bitset.
+ */
+bool IntSetIsDense(const IntSet *set);
+
+/*
+ * Elements of dense sets are iterated in ascending order, elements of hashed
+ * sets in no particular order.
+ *
+ * IntSetIterator i = IntSetIteratorInit(set);
+ * int64_t element;
+ * while (IntSetIteratorNext(&i, &element))
+ * {
+ *     // do something with element
+ * }
+ */
+IntSetIterator IntSetIteratorInit(const IntSet *set);
+bool IntSetIteratorNext(IntSetIterator *i, int64_t *element);
+
+#endif
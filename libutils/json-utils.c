@@ -29,6 +29,7 @@
 #include <csv_parser.h>
 #include <json-yaml.h>  // JsonParseYamlFile()
 #include <alloc.h>
+#include <perfect_hash.h>
 #define ENV_BYTE_LIMIT 4096
 
 /**
@@ -379,27 +380,37 @@ JsonElement *JsonReadDataFile(const char *log_identifier, const char *input_path
     return NULL;
 }
 
+/* Indexed by DataFileType */
+static const char *const data_file_type_names[] =
+{
+    [DATAFILETYPE_JSON] = "json",
+    [DATAFILETYPE_YAML] = "yaml",
+    [DATAFILETYPE_CSV] = "csv",
+    [DATAFILETYPE_ENV] = "env",
+};
+
+static pthread_once_t data_file_types_table_once = PTHREAD_ONCE_INIT; /* GLOBAL_T */
+static StringPerfectHash *data_file_types_table = NULL; /* GLOBAL_T */
+
+static void DataFileTypesTableInit(void)
+{
+    data_file_types_table = StringPerfectHashNew(
+        data_file_type_names,
+        sizeof(data_file_type_names) / sizeof(data_file_type_names[0]),
+        true);
+}
+
 DataFileType GetDataFileTypeFromString(const char *const requested_mode)
 {
-    DataFileType type = DATAFILETYPE_UNKNOWN;
-    if (StringEqual_IgnoreCase(requested_mode, "yaml"))
-    {
-        type = DATAFILETYPE_YAML;
-    }
-    else if (StringEqual_IgnoreCase(requested_mode, "csv"))
-    {
-        type = DATAFILETYPE_CSV;
-    }
-    else if (StringEqual_IgnoreCase(requested_mode, "env"))
-    {
-        type = DATAFILETYPE_ENV;
-    }
-    else if (StringEqual_IgnoreCase(requested_mode, "json"))
+    if (requested_mode == NULL)
     {
-        type = DATAFILETYPE_JSON;
+        return DATAFILETYPE_UNKNOWN;
     }
 
-    return type;
+    pthread_once(&data_file_types_table_once, &DataFileTypesTableInit);
+    const ssize_t i = StringPerfectHashLookup(data_file_types_table,
+                                              requested_mode);
+    return (i >= 0) ? (DataFileType) i : DATAFILETYPE_UNKNOWN;
 }
 
 DataFileType GetDataFileTypeFromSuffix(const char *filename)
@@ -903,7 +903,7 @@ void JsonSort(
     assert(container->type == JSON_ELEMENT_TYPE_CONTAINER);
 
     Seq *const children = container->container.children;
-    SeqSort(children, (SeqItemComparator) Compare, user_data);
+    SeqStableSort(children, (SeqItemComparator) Compare, user_data);
 }
 
 JsonElement *JsonAt(const JsonElement *container, const size_t index)
@@ -21,6 +21,7 @@
   included file COSL.txt.
 */
 
+#include <platform.h>
 #include <assert.h>
 #include <alloc.h>
 #include <list.h>
@@ -31,6 +32,21 @@ struct ListNode {
     struct ListNode *previous;
 };
 typedef struct ListNode ListNode;
+/*
+ * Nodes are carved out of chunks owned by the list instead of being malloc'ed
+ * one by one, so building a list costs a handful of allocations and nodes
+ * added one after another are next to each other in memory. Nodes never move,
+ * iterators keep pointing to them.
+ */
+#define LIST_CHUNK_MIN_NODES 16
+#define LIST_CHUNK_MAX_NODES 1024
+struct ListChunk {
+    struct ListChunk *next;
+    size_t size;
+    size_t used;
+    ListNode nodes[];
+};
+typedef struct ListChunk ListChunk;
 struct ListMutableIterator {
     int valid;
     ListNode *current;
@@ -47,6 +63,10 @@ struct List {
     ListNode *first;
     // Link to the last element
     ListNode *last;
+    // Memory for the nodes, shared like the nodes themselves
+    ListChunk *chunks;
+    // Removed nodes to be reused, linked by next
+    ListNode *free_nodes;
     // This function is used to compare two elements
     int (*compare)(const void *a, const void *b);
     // This function is used whenever there is need to perform a deep copy
@@ -71,6 +91,54 @@ struct ListIterator {
 #define ChangeListState(list) \
     list->state++
 
+static ListNode *NewNode(List *list)
+{
+    if (list->free_nodes)
+    {
+        ListNode *node = list->free_nodes;
+        list->free_nodes = node->next;
+        return node;
+    }
+    ListChunk *chunk = list->chunks;
+    if (!chunk || chunk->used == chunk->size)
+    {
+        // Grow with the list, but don't waste too much on short ones
+        size_t size = chunk ? MIN(2 * chunk->size, LIST_CHUNK_MAX_NODES)
+                            : LIST_CHUNK_MIN_NODES;
+        chunk = (ListChunk *)xmalloc(sizeof(ListChunk) + size * sizeof(ListNode));
+        chunk->next = list->chunks;
+        chunk->size = size;
+        chunk->used = 0;
+        list->chunks = chunk;
+    }
+    return &chunk->nodes[chunk->used++];
+}
+
+static void FreeNode(List *list, ListNode *node)
+{
+    node->next = list->free_nodes;
+    list->free_nodes = node;
+}
+
+static void DestroyNodes(ListNode *first, ListChunk *chunks, void (*destroy)(void *element))
+{
+    ListNode *node = NULL;
+    if (destroy)
+    {
+        for (node = first; node; node = node->next)
+        {
+            destroy(node->payload);
+        }
+    }
+    ListChunk *p = NULL;
+    while (chunks)
+    {
+        p = chunks->next;
+        free(chunks);
+        chunks = p;
+    }
+}
+
 /*
  * Helper method to detach lists.
  */
@@ -86,13 +154,18 @@ static void ListDetach(List *list)
          * 2. Detach
          */
         ListNode *p = NULL, *q = NULL, *newList = NULL, *first = NULL, *last = NULL;
+        ListChunk *shared_chunks = list->chunks;
+        ListNode *shared_free_nodes = list->free_nodes;
+        list->chunks = NULL;
+        list->free_nodes = NULL;
         for (p = list->list; p; p = p->next)
         {
             if (newList)
             {
-                q->next = (ListNode *)xmalloc(sizeof(ListNode));
+                q->next = NewNode(list);
                 q->next->previous = q;
                 q->next->next = NULL;
+                q->next->payload = NULL;
                 q = q->next;
                 last = q;
                 if (p->payload)
@@ -110,9 +183,10 @@ static void ListDetach(List *list)
             else
             {
                 // First element
-                newList = (ListNode *)xmalloc(sizeof(ListNode));
+                newList = NewNode(list);
                 newList->next = NULL;
                 newList->previous = NULL;
+                newList->payload = NULL;
                 first = newList;
                 last = newList;
                 if (p->payload)
@@ -129,11 +203,21 @@ static void ListDetach(List *list)
                 q = newList;
             }
         }
+        // Ok, we have our own copy of the list. Now we detach.
+        if (!RefCountDetach(list->ref_count, list))
+        {
+            /*
+             * The other users detached in the meantime, the original is ours
+             * and the copy is not needed.
+             */
+            DestroyNodes(first, list->chunks, list->destroy);
+            list->chunks = shared_chunks;
+            list->free_nodes = shared_free_nodes;
+            return;
+        }
         list->list = newList;
         list->first = first;
         list->last = last;
-        // Ok, we have our own copy of the list. Now we detach.
-        RefCountDetach(list->ref_count, list);
         list->ref_count = NULL;
         RefCountNew(&list->ref_count);
         RefCountAttach(list->ref_count, list);
@@ -147,6 +231,8 @@ List *ListNew(int (*compare)(const void *, const void *), void (*copy)(const voi
     list->list = NULL;
     list->first = NULL;
     list->last = NULL;
+    list->chunks = NULL;
+    list->free_nodes = NULL;
     list->node_count = 0;
     list->iterator = NULL;
     list->state = 0;
@@ -164,28 +250,15 @@ int ListDestroy(List **list)
     {
         return 0;
     }
+    /*
+     * If shared, we just detach from the list. Unless the other users
+     * detached in the meantime.
+     */
     int shared = RefCountIsShared((*list)->ref_count);
-    if (shared)
-    {
-        /*
-         * We just detach from the list.
-         */
-        RefCountDetach((*list)->ref_count, (*list));
-    }
-    else
+    if (!shared || !RefCountDetach((*list)->ref_count, (*list)))
     {
         // We are the only ones using the list, we can delete it.
-        ListNode *node = NULL;
-        ListNode *p = NULL;
-        for (node = (*list)->first; node; node = p)
-        {
-            if ((*list)->destroy)
-            {
-                (*list)->destroy(node->payload);
-            }
-            p = node->next;
-            free(node);
-        }
+        DestroyNodes((*list)->first, (*list)->chunks, (*list)->destroy);
         RefCountDestroy(&(*list)->ref_count);
     }
     free((*list));
@@ -211,6 +284,8 @@ int ListCopy(List *origin, List **destination)
     (*destination)->list = origin->list;
     (*destination)->first = origin->first;
     (*destination)->last = origin->last;
+    (*destination)->chunks = origin->chunks;
+    (*destination)->free_nodes = origin->free_nodes;
     (*destination)->node_count = origin->node_count;
     (*destination)->state = origin->state;
     (*destination)->destroy = origin->destroy;
@@ -234,7 +309,7 @@ int ListPrepend(List *list, void *payload)
         return -1;
     }
     ListDetach(list);
-    node = (ListNode *)xmalloc(sizeof(ListNode));
+    node = NewNode(list);
     node->payload = payload;
     node->previous = NULL;
     if (list->list)
@@ -263,7 +338,7 @@ int ListAppend(List *list, void *payload)
         return -1;
     }
     ListDetach(list);
-    node = (ListNode *)xmalloc(sizeof(ListNode));
+    node = NewNode(list);
     node->next = NULL;
     node->payload = payload;
     if (list->last)
@@ -450,7 +525,7 @@ int ListRemove(List *list, void *payload)
     {
         free (node->payload);
     }
-    free(node);
+    FreeNode(list, node);
     ListUpdateListState(list);
     return 0;
 }
@@ -809,7 +884,7 @@ int ListMutableIteratorRemove(ListMutableIterator *iterator)
     {
         free (iterator->current->payload);
     }
-    free(iterator->current);
+    FreeNode(iterator->origin, iterator->current);
     iterator->current = node;
     ListUpdateListState(iterator->origin);
     return 0;
@@ -826,8 +901,8 @@ int ListMutableIteratorPrepend(ListMutableIterator *iterator, void *payload)
         return -1;
     }
     ListNode *node = NULL;
-    node = (ListNode *)xmalloc(sizeof(ListNode));
     ListDetach(iterator->origin);
+    node = NewNode(iterator->origin);
     node->payload = payload;
     if (iterator->current->previous)
     {
@@ -860,8 +935,8 @@ int ListMutableIteratorAppend(ListMutableIterator *iterator, void *payload)
         return -1;
     }
     ListNode *node = NULL;
-    node = (ListNode *)xmalloc(sizeof(ListNode));
     ListDetach(iterator->origin);
+    node = NewNode(iterator->origin);
     node->next = NULL;
     node->payload = payload;
     if (iterator->current->next) {
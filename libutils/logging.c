@@ -28,6 +28,7 @@
 #include <misc_lib.h>
 #include <cleanup.h>
 #include <sequence.h>
+#include <perfect_hash.h>
 
 #if defined(HAVE_SYSTEMD_SD_JOURNAL_H) && defined(HAVE_LIBSYSTEMD)
 #include <systemd/sd-journal.h> /* sd_journal_sendv() */
@@ -151,6 +152,58 @@ const char *LogLevelToString(LogLevel level)
     }
 }
 
+/* Names the log levels can be given as (case-insensitive). Any prefix of a
+ * name is accepted too, i/info/inform/information all result in
+ * LOG_LEVEL_INFO. In case of ambiguity, the first name wins. */
+static const struct
+{
+    const char *name;
+    LogLevel level;
+} log_level_names[] =
+{
+    { "CRITICAL",    LOG_LEVEL_CRIT },
+    { "errors",      LOG_LEVEL_ERR },
+    { "warnings",    LOG_LEVEL_WARNING },
+    { "notices",     LOG_LEVEL_NOTICE },
+    { "information", LOG_LEVEL_INFO },
+    { "verbose",     LOG_LEVEL_VERBOSE },
+    { "debug",       LOG_LEVEL_DEBUG },
+    { "none",        LOG_LEVEL_NONE },
+};
+
+static pthread_once_t log_level_table_once = PTHREAD_ONCE_INIT; /* GLOBAL_T */
+static StringPerfectHash *log_level_table = NULL; /* GLOBAL_T */
+static char **log_level_prefixes = NULL; /* GLOBAL_T */
+static LogLevel *log_level_prefix_levels = NULL; /* GLOBAL_T */
+
+/* All prefixes of all names, in order, looked up with a perfect hash. */
+static void LogLevelTableInit(void)
+{
+    const size_t n_names = sizeof(log_level_names) / sizeof(log_level_names[0]);
+    size_t n_prefixes = 0;
+    for (size_t i = 0; i < n_names; i++)
+    {
+        n_prefixes += strlen(log_level_names[i].name);
+    }
+
+    log_level_prefixes = xmalloc(n_prefixes * sizeof(char *));
+    log_level_prefix_levels = xmalloc(n_prefixes * sizeof(LogLevel));
+    size_t n = 0;
+    for (size_t i = 0; i < n_names; i++)
+    {
+        const char *name = log_level_names[i].name;
+        for (size_t len = 1; len <= strlen(name); len++)
+        {
+            log_level_prefixes[n] = xstrndup(name, len);
+            log_level_prefix_levels[n] = log_level_names[i].level;
+            n++;
+        }
+    }
+
+    log_level_table = StringPerfectHashNew((const char *const *) log_level_prefixes,
+                                           n_prefixes, true);
+}
+
 LogLevel LogLevelFromString(const char *const level)
 {
     // Only compare the part the user typed
@@ -160,39 +213,10 @@ LogLevel LogLevelFromString(const char *const level)
     {
         return LOG_LEVEL_NOTHING;
     }
-    if (StringEqualN_IgnoreCase(level, "CRITICAL", len))
-    {
-        return LOG_LEVEL_CRIT;
-    }
-    if (StringEqualN_IgnoreCase(level, "errors", len))
-    {
-        return LOG_LEVEL_ERR;
-    }
-    if (StringEqualN_IgnoreCase(level, "warnings", len))
-    {
-        return LOG_LEVEL_WARNING;
-    }
-    if (StringEqualN_IgnoreCase(level, "notices", len))
-    {
-        return LOG_LEVEL_NOTICE;
-    }
-    if (StringEqualN_IgnoreCase(level, "information", len))
-    {
-        return LOG_LEVEL_INFO;
-    }
-    if (StringEqualN_IgnoreCase(level, "verbose", len))
-    {
-        return LOG_LEVEL_VERBOSE;
-    }
-    if (StringEqualN_IgnoreCase(level, "debug", len))
-    {
-        return LOG_LEVEL_DEBUG;
-    }
-    if (StringEqualN_IgnoreCase(level, "none", len))
-    {
-        return LOG_LEVEL_NONE;
-    }
-    return LOG_LEVEL_NOTHING;
+
+    pthread_once(&log_level_table_once, &LogLevelTableInit);
+    const ssize_t i = StringPerfectHashLookup(log_level_table, level);
+    return (i >= 0) ? log_level_prefix_levels[i] : LOG_LEVEL_NOTHING;
 }
 
 static const char *LogLevelToColor(LogLevel level)
@@ -601,17 +625,19 @@ static const char *log_modules[LOG_MOD_MAX] =
     "ps",
 };
 
-static enum LogModule LogModuleFromString(const char *s)
+static pthread_once_t log_modules_table_once = PTHREAD_ONCE_INIT; /* GLOBAL_T */
+static StringPerfectHash *log_modules_table = NULL; /* GLOBAL_T */
+
+static void LogModulesTableInit(void)
 {
-    for (enum LogModule i = 0; i < LOG_MOD_MAX; i++)
-    {
-        if (strcmp(log_modules[i], s) == 0)
-        {
-            return i;
-        }
-    }
+    log_modules_table = StringPerfectHashNew(log_modules, LOG_MOD_MAX, false);
+}
 
-    return LOG_MOD_NONE;
+static enum LogModule LogModuleFromString(const char *s)
+{
+    pthread_once(&log_modules_table_once, &LogModulesTableInit);
+    const ssize_t i = StringPerfectHashLookup(log_modules_table, s);
+    return (i >= 0) ? (enum LogModule) i : LOG_MOD_NONE;
 }
 
 void LogEnableModule(enum LogModule mod)
@@ -122,7 +122,7 @@ size_t MapSize(const Map *map)
     }
 }
 
-static void ConvertToHashMap(Map *map)
+static void ConvertToHashMap(Map *map, size_t init_size)
 {
     assert(map != NULL);
 
@@ -130,7 +130,7 @@ static void ConvertToHashMap(Map *map)
                                   map->arraymap->equal_fn,
                                   map->arraymap->destroy_key_fn,
                                   map->arraymap->destroy_value_fn,
-                                  DEFAULT_HASHMAP_INIT_SIZE);
+                                  init_size);
 
     /* We have to use internals of ArrayMap here, as we don't want to
        destroy the values in ArrayMapDestroy */
@@ -167,12 +167,62 @@ bool MapInsert(Map *map, void *key, void *value)
         }
 
         /* Does not fit in ArrayMap, must convert to HashMap. */
-        ConvertToHashMap(map);
+        ConvertToHashMap(map, DEFAULT_HASHMAP_INIT_SIZE);
     }
 
     return HashMapInsert(map->hashmap, key, value);
 }
 
+Map *MapNewWithCapacity(MapHashFn hash_fn,
+                        MapKeyEqualFn equal_fn,
+                        MapDestroyDataFn destroy_key_fn,
+                        MapDestroyDataFn destroy_value_fn,
+                        size_t capacity)
+{
+    Map *map = MapNew(hash_fn, equal_fn, destroy_key_fn, destroy_value_fn);
+    MapReserve(map, capacity);
+    return map;
+}
+
+void MapReserve(Map *map, size_t capacity)
+{
+    assert(map != NULL);
+
+    if (IsArrayMap(map))
+    {
+        if (capacity <= TINY_LIMIT)
+        {
+            return;
+        }
+        /* Go straight to a right-sized hash table instead of growing it
+         * from DEFAULT_HASHMAP_INIT_SIZE by doubling. */
+        ConvertToHashMap(map, MAX(HashMapSizeForCapacity(capacity),
+                                  DEFAULT_HASHMAP_INIT_SIZE));
+    }
+    else
+    {
+        HashMapReserve(map->hashmap, capacity);
+    }
+}
+
+size_t MapInsertBatch(Map *map, const MapKeyValue *items, size_t count)
+{
+    assert(map != NULL);
+    assert(items != NULL || count == 0);
+
+    MapReserve(map, MapSize(map) + count);
+
+    size_t inserted = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!MapInsert(map, items[i].key, items[i].value))
+        {
+            inserted++;
+        }
+    }
+    return inserted;
+}
+
 /*
  * The best we can get out of C type system. Caller should make sure that if
  * argument is const, it does not modify the result.
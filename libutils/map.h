@@ -37,6 +37,22 @@ Map *MapNew(MapHashFn hash_fn,
             MapDestroyDataFn destroy_key_fn,
             MapDestroyDataFn destroy_value_fn);
 
+/**
+ * Same as MapNew(), but the map is ready to hold #capacity elements without
+ * any resizing (and won't shrink below that).
+ */
+Map *MapNewWithCapacity(MapHashFn hash_fn,
+                        MapKeyEqualFn equal_fn,
+                        MapDestroyDataFn destroy_key_fn,
+                        MapDestroyDataFn destroy_value_fn,
+                        size_t capacity);
+
+/**
+ * Make room for #capacity elements in total, so that inserting up to that many
+ * elements doesn't trigger any resizing.
+ */
+void MapReserve(Map *map, size_t capacity);
+
 /**
  * Insert a key-value pair in the map.
  * If the key is in the map, value get replaced. Old value is destroyed.
@@ -45,6 +61,13 @@ Map *MapNew(MapHashFn hash_fn,
  */
 bool MapInsert(Map *map, void *key, void *value);
 
+/**
+ * Insert #count key-value pairs, reserving space for all of them first.
+ *
+ * @return number of keys that were not in the map before.
+ */
+size_t MapInsertBatch(Map *map, const MapKeyValue *items, size_t count);
+
 /*
  * Returns whether the key is in the map.
  */
@@ -120,6 +143,7 @@ void MapPrintStats(const Map *map, FILE *f);
     typedef MapIterator Prefix##MapIterator;                            \
                                                                         \
     Prefix##Map *Prefix##MapNew(void);                                  \
+    void Prefix##MapReserve(Prefix##Map *map, size_t capacity);         \
     bool Prefix##MapInsert(const Prefix##Map *map, KeyType key, ValueType value); \
     bool Prefix##MapHasKey(const Prefix##Map *map, const KeyType key);  \
     ValueType Prefix##MapGet(const Prefix##Map *map, const KeyType key); \
@@ -144,6 +168,12 @@ void MapPrintStats(const Map *map, FILE *f);
         return map;                                                     \
     }                                                                   \
                                                                         \
+    void Prefix##MapReserve(Prefix##Map *map, size_t capacity)          \
+    {                                                                   \
+        assert(map);                                                    \
+        MapReserve(map->impl, capacity);                                \
+    }                                                                   \
+                                                                        \
     bool Prefix##MapInsert(const Prefix##Map *map, KeyType key, ValueType value) \
     {                                                                   \
         assert(map);                                                    \
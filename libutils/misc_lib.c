@@ -51,6 +51,18 @@ size_t UpperPowerOfTwo(size_t v)
     return v;
 }
 
+size_t GetOnlineCPUCount(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0)
+    {
+        return cpus;
+    }
+#endif
+    return 1;
+}
+
 void __ProgrammingError(const char *file, int lineno, const char *format, ...)
 {
     va_list ap;
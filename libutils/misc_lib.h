@@ -123,6 +123,11 @@ unsigned long UnsignedModulus(long dividend, long divisor);
 
 size_t UpperPowerOfTwo(size_t v);
 
+/**
+  @brief Number of CPUs online, 1 if it can't be determined.
+*/
+size_t GetOnlineCPUCount(void);
+
 
 void __ProgrammingError(const char *file, int lineno, const char *format, ...) \
     FUNC_ATTR_PRINTF(3, 4) FUNC_ATTR_NORETURN;
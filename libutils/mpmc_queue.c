@@ -0,0 +1,297 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <mpmc_queue.h>
+#include <alloc.h>
+#include <event_count.h>
+
+/* Keeps the producers' and consumers' positions in separate cache lines */
+#define CACHE_LINE_SIZE 64
+
+typedef struct
+{
+    /* For the producer of lap n the slot is free when sequence == position,
+     * for the consumer it is full when sequence == position + 1 */
+    size_t sequence;
+    void *item;
+} Slot;
+
+struct MPMCQueue_
+{
+    Slot *slots;
+    size_t mask;
+    void (*ItemDestroy) (void *item);
+    EventCount not_empty;
+    EventCount not_full;
+
+    char pad0[CACHE_LINE_SIZE];
+    size_t push_position;
+    char pad1[CACHE_LINE_SIZE - sizeof(size_t)];
+    size_t pop_position;
+    char pad2[CACHE_LINE_SIZE - sizeof(size_t)];
+};
+
+MPMCQueue *MPMCQueueNew(size_t capacity, void (*ItemDestroy) (void *item))
+{
+    size_t size = 2;
+    while (size < capacity)
+    {
+        size *= 2;
+    }
+
+    MPMCQueue *queue = xcalloc(1, sizeof(MPMCQueue));
+    queue->slots = xmalloc(size * sizeof(Slot));
+    for (size_t i = 0; i < size; i++)
+    {
+        queue->slots[i].sequence = i;
+    }
+    queue->mask = size - 1;
+    queue->ItemDestroy = ItemDestroy;
+    EventCountInit(&queue->not_empty);
+    EventCountInit(&queue->not_full);
+
+    return queue;
+}
+
+void MPMCQueueDestroy(MPMCQueue *queue)
+{
+    if (queue != NULL)
+    {
+        void *item;
+        while (MPMCQueueTryPop(queue, &item))
+        {
+            if (queue->ItemDestroy != NULL)
+            {
+                queue->ItemDestroy(item);
+            }
+        }
+
+        EventCountDestroy(&queue->not_empty);
+        EventCountDestroy(&queue->not_full);
+        free(queue->slots);
+        free(queue);
+    }
+}
+
+bool MPMCQueueTryPush(MPMCQueue *queue, void *item)
+{
+    assert(queue != NULL);
+
+    Slot *slot;
+    size_t position = __atomic_load_n(&queue->push_position, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        slot = &queue->slots[position & queue->mask];
+        size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) position;
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&queue->push_position, &position,
+                                            position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+            /* position was reloaded by the failed CAS */
+        }
+        else if (diff < 0)
+        {
+            /* Slot still holds the item from the previous lap, full */
+            return false;
+        }
+        else
+        {
+            /* Another producer got the slot */
+            position = __atomic_load_n(&queue->push_position, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->item = item;
+    __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+
+    EventCountNotifyAll(&queue->not_empty);
+    return true;
+}
+
+bool MPMCQueueTryPop(MPMCQueue *queue, void **item)
+{
+    assert(queue != NULL);
+    assert(item != NULL);
+
+    Slot *slot;
+    size_t position = __atomic_load_n(&queue->pop_position, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        slot = &queue->slots[position & queue->mask];
+        size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) (position + 1);
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&queue->pop_position, &position,
+                                            position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* Nothing pushed to the slot yet, empty */
+            return false;
+        }
+        else
+        {
+            position = __atomic_load_n(&queue->pop_position, __ATOMIC_RELAXED);
+        }
+    }
+
+    *item = slot->item;
+    /* Free for the producer of the next lap */
+    __atomic_store_n(&slot->sequence, position + queue->mask + 1,
+                     __ATOMIC_RELEASE);
+
+    EventCountNotifyAll(&queue->not_full);
+    return true;
+}
+
+/* Retry a few times, letting other threads run, before going to sleep. The
+ * other side usually catches up quickly and the sleep and wakeup cost
+ * system calls. */
+#define SPIN_ATTEMPTS 16
+
+static bool SpinPush(MPMCQueue *queue, void *item)
+{
+    for (int i = 0; i < SPIN_ATTEMPTS; i++)
+    {
+        sched_yield();
+        if (MPMCQueueTryPush(queue, item))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool SpinPop(MPMCQueue *queue, void **item)
+{
+    for (int i = 0; i < SPIN_ATTEMPTS; i++)
+    {
+        sched_yield();
+        if (MPMCQueueTryPop(queue, item))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MPMCQueuePush(MPMCQueue *queue, void *item, int timeout)
+{
+    struct timespec deadline_buf;
+    const struct timespec *deadline = NULL;
+    bool have_deadline = false;
+
+    while (!MPMCQueueTryPush(queue, item))
+    {
+        if (timeout == 0)
+        {
+            return false;
+        }
+        if (SpinPush(queue, item))
+        {
+            return true;
+        }
+        if (!have_deadline)
+        {
+            deadline = EventCountDeadline(&deadline_buf, timeout);
+            have_deadline = true;
+        }
+
+        unsigned long key = EventCountPrepareWait(&queue->not_full);
+        if (MPMCQueueTryPush(queue, item))
+        {
+            EventCountCancelWait(&queue->not_full);
+            return true;
+        }
+        if (!EventCountWait(&queue->not_full, key, deadline))
+        {
+            return MPMCQueueTryPush(queue, item);
+        }
+    }
+    return true;
+}
+
+bool MPMCQueuePop(MPMCQueue *queue, void **item, int timeout)
+{
+    struct timespec deadline_buf;
+    const struct timespec *deadline = NULL;
+    bool have_deadline = false;
+
+    while (!MPMCQueueTryPop(queue, item))
+    {
+        if (timeout == 0)
+        {
+            return false;
+        }
+        if (SpinPop(queue, item))
+        {
+            return true;
+        }
+        if (!have_deadline)
+        {
+            deadline = EventCountDeadline(&deadline_buf, timeout);
+            have_deadline = true;
+        }
+
+        unsigned long key = EventCountPrepareWait(&queue->not_empty);
+        if (MPMCQueueTryPop(queue, item))
+        {
+            EventCountCancelWait(&queue->not_empty);
+            return true;
+        }
+        if (!EventCountWait(&queue->not_empty, key, deadline))
+        {
+            return MPMCQueueTryPop(queue, item);
+        }
+    }
+    return true;
+}
+
+size_t MPMCQueueCount(const MPMCQueue *queue)
+{
+    assert(queue != NULL);
+
+    /* Load pop first, so that the difference can't be negative */
+    size_t pop = __atomic_load_n(&queue->pop_position, __ATOMIC_ACQUIRE);
+    size_t push = __atomic_load_n(&queue->push_position, __ATOMIC_ACQUIRE);
+    return MIN(push - pop, queue->mask + 1);
+}
+
+size_t MPMCQueueCapacity(const MPMCQueue *queue)
+{
+    assert(queue != NULL);
+    return queue->mask + 1;
+}
@@ -0,0 +1,92 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_MPMC_QUEUE_H
+#define CFENGINE_MPMC_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>     // size_t
+
+/*
+ * Bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's
+ * design: a ring of slots with sequence numbers, producers and consumers
+ * each claim a slot with a single compare-and-swap).
+ *
+ * Unlike ThreadedQueue it doesn't grow, and pushing and popping don't take
+ * any lock: MPMCQueueTryPush() and MPMCQueueTryPop() never block. The
+ * blocking MPMCQueuePush() and MPMCQueuePop() only sleep when the queue is
+ * full or empty, respectively.
+ */
+
+typedef struct MPMCQueue_ MPMCQueue;
+
+/**
+  @brief Create a new queue.
+  @param [in] capacity Maximum number of items, rounded up to a power of 2.
+  @param [in] ItemDestroy Function used to destroy items left in the queue.
+  */
+MPMCQueue *MPMCQueueNew(size_t capacity, void (*ItemDestroy) (void *item));
+
+/**
+  @brief Destroy the queue and the items left in it.
+  @warning No other thread may be using the queue.
+  */
+void MPMCQueueDestroy(MPMCQueue *queue);
+
+/**
+  @brief Push an item unless the queue is full.
+  @return true if the item was pushed.
+  */
+bool MPMCQueueTryPush(MPMCQueue *queue, void *item);
+
+/**
+  @brief Pop the oldest item unless the queue is empty.
+  @param [out] item The popped item.
+  @return true if an item was popped.
+  */
+bool MPMCQueueTryPop(MPMCQueue *queue, void **item);
+
+/**
+  @brief Push an item, waiting while the queue is full.
+  @param [in] timeout Seconds to wait, can be THREAD_BLOCK_INDEFINITELY.
+  @return true if the item was pushed, false if timed out.
+  */
+bool MPMCQueuePush(MPMCQueue *queue, void *item, int timeout);
+
+/**
+  @brief Pop the oldest item, waiting while the queue is empty.
+  @param [out] item The popped item.
+  @param [in] timeout Seconds to wait, can be THREAD_BLOCK_INDEFINITELY.
+  @return true if an item was popped, false if timed out.
+  */
+bool MPMCQueuePop(MPMCQueue *queue, void **item, int timeout);
+
+/**
+  @brief Number of items in the queue.
+  @note Only a snapshot when other threads use the queue.
+  */
+size_t MPMCQueueCount(const MPMCQueue *queue);
+
+size_t MPMCQueueCapacity(const MPMCQueue *queue);
+
+#endif
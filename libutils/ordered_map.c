@@ -0,0 +1,337 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <ordered_map.h>
+#include <alloc.h>
+
+#define INDEX_EMPTY   UINT32_MAX
+#define INDEX_DELETED (UINT32_MAX - 1)
+#define MIN_INDEX_SIZE 8
+
+typedef struct
+{
+    MapKeyValue kv;             /* kv.key == NULL means removed */
+    unsigned int hash;
+} OrderedMapEntry;
+
+struct OrderedMap_
+{
+    MapHashFn hash_fn;
+    MapKeyEqualFn equal_fn;
+    MapDestroyDataFn destroy_key_fn;
+    MapDestroyDataFn destroy_value_fn;
+
+    /* Dense entries in insertion order, including removed ones until the
+     * next compaction. */
+    OrderedMapEntry *entries;
+    size_t n_entries;
+    size_t entries_capacity;
+    size_t load;                /* number of live entries */
+
+    /* Open addressing index into entries, index_size is a power of 2. */
+    uint32_t *index;
+    size_t index_size;
+};
+
+/* Keep the index at most 2/3 full (counting removed entries). */
+static bool IndexOverloaded(size_t used, size_t index_size)
+{
+    return (used * 3) > (index_size * 2);
+}
+
+OrderedMap *OrderedMapNew(MapHashFn hash_fn,
+                          MapKeyEqualFn equal_fn,
+                          MapDestroyDataFn destroy_key_fn,
+                          MapDestroyDataFn destroy_value_fn)
+{
+    assert(hash_fn != NULL);
+    assert(equal_fn != NULL);
+
+    OrderedMap *map = xcalloc(1, sizeof(OrderedMap));
+    map->hash_fn = hash_fn;
+    map->equal_fn = equal_fn;
+    map->destroy_key_fn = destroy_key_fn;
+    map->destroy_value_fn = destroy_value_fn;
+
+    map->index_size = MIN_INDEX_SIZE;
+    map->index = xmalloc(map->index_size * sizeof(uint32_t));
+    memset(map->index, 0xff, map->index_size * sizeof(uint32_t));
+    return map;
+}
+
+/**
+ * Find the index slot for key.
+ *
+ * @return the slot holding key's entry or, if not found, the slot where it
+ *         should be inserted (first deleted slot on the way, if any)
+ */
+static size_t FindSlot(const OrderedMap *map, const void *key,
+                       unsigned int hash, bool *found)
+{
+    const size_t mask = map->index_size - 1;
+    size_t free_slot = SIZE_MAX;
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask)
+    {
+        const uint32_t ix = map->index[i];
+        if (ix == INDEX_EMPTY)
+        {
+            *found = false;
+            return (free_slot != SIZE_MAX) ? free_slot : i;
+        }
+        if (ix == INDEX_DELETED)
+        {
+            if (free_slot == SIZE_MAX)
+            {
+                free_slot = i;
+            }
+            continue;
+        }
+
+        const OrderedMapEntry *entry = &map->entries[ix];
+        if (entry->hash == hash && map->equal_fn(entry->kv.key, key))
+        {
+            *found = true;
+            return i;
+        }
+    }
+}
+
+/**
+ * Drop removed entries (preserving order) and rebuild the index with room for
+ * at least #capacity entries.
+ */
+static void Rebuild(OrderedMap *map, size_t capacity)
+{
+    size_t live = 0;
+    for (size_t i = 0; i < map->n_entries; i++)
+    {
+        if (map->entries[i].kv.key != NULL)
+        {
+            map->entries[live++] = map->entries[i];
+        }
+    }
+    assert(live == map->load);
+    map->n_entries = live;
+
+    size_t index_size = MIN_INDEX_SIZE;
+    while (IndexOverloaded(capacity, index_size))
+    {
+        index_size <<= 1;
+    }
+    free(map->index);
+    map->index_size = index_size;
+    map->index = xmalloc(index_size * sizeof(uint32_t));
+    memset(map->index, 0xff, index_size * sizeof(uint32_t));
+
+    const size_t mask = index_size - 1;
+    for (size_t i = 0; i < live; i++)
+    {
+        size_t slot = map->entries[i].hash & mask;
+        while (map->index[slot] != INDEX_EMPTY)
+        {
+            slot = (slot + 1) & mask;
+        }
+        map->index[slot] = i;
+    }
+}
+
+bool OrderedMapInsert(OrderedMap *map, void *key, void *value)
+{
+    assert(map != NULL);
+    assert(key != NULL);
+
+    const unsigned int hash = map->hash_fn(key, 0);
+    bool found;
+    size_t slot = FindSlot(map, key, hash, &found);
+
+    if (found)
+    {
+        /* Replace the key with the new one despite those two being the
+         * same, since the new key might be referenced somewhere inside
+         * the new value. */
+        OrderedMapEntry *entry = &map->entries[map->index[slot]];
+        if (map->destroy_key_fn != NULL)
+        {
+            map->destroy_key_fn(entry->kv.key);
+        }
+        if (map->destroy_value_fn != NULL)
+        {
+            map->destroy_value_fn(entry->kv.value);
+        }
+        entry->kv.key = key;
+        entry->kv.value = value;
+        return true;
+    }
+
+    if (IndexOverloaded(map->n_entries + 1, map->index_size))
+    {
+        /* Only grow if there are not enough removed entries to reclaim. */
+        Rebuild(map, MAX(map->load + 1, map->load * 2));
+        slot = FindSlot(map, key, hash, &found);
+    }
+
+    if (map->n_entries == map->entries_capacity)
+    {
+        map->entries_capacity = MAX(map->entries_capacity * 2, MIN_INDEX_SIZE);
+        map->entries = xrealloc(map->entries,
+                                map->entries_capacity * sizeof(OrderedMapEntry));
+    }
+
+    map->entries[map->n_entries] = (OrderedMapEntry) { { key, value }, hash };
+    map->index[slot] = map->n_entries;
+    map->n_entries++;
+    map->load++;
+    return false;
+}
+
+static OrderedMapEntry *OrderedMapGetEntry(const OrderedMap *map,
+                                           const void *key)
+{
+    assert(map != NULL);
+    assert(key != NULL);
+
+    bool found;
+    size_t slot = FindSlot(map, key, map->hash_fn(key, 0), &found);
+    return found ? &map->entries[map->index[slot]] : NULL;
+}
+
+bool OrderedMapHasKey(const OrderedMap *map, const void *key)
+{
+    return OrderedMapGetEntry(map, key) != NULL;
+}
+
+void *OrderedMapGet(const OrderedMap *map, const void *key)
+{
+    OrderedMapEntry *entry = OrderedMapGetEntry(map, key);
+    return (entry != NULL) ? entry->kv.value : NULL;
+}
+
+bool OrderedMapRemove(OrderedMap *map, const void *key)
+{
+    assert(map != NULL);
+    assert(key != NULL);
+
+    bool found;
+    size_t slot = FindSlot(map, key, map->hash_fn(key, 0), &found);
+    if (!found)
+    {
+        return false;
+    }
+
+    OrderedMapEntry *entry = &map->entries[map->index[slot]];
+    if (map->destroy_key_fn != NULL)
+    {
+        map->destroy_key_fn(entry->kv.key);
+    }
+    if (map->destroy_value_fn != NULL)
+    {
+        map->destroy_value_fn(entry->kv.value);
+    }
+    entry->kv.key = NULL;
+    entry->kv.value = NULL;
+    map->index[slot] = INDEX_DELETED;
+    map->load--;
+
+    /* Compact when most entries are removed ones. */
+    if (map->n_entries > MIN_INDEX_SIZE && map->load * 4 < map->n_entries)
+    {
+        Rebuild(map, map->load);
+    }
+    return true;
+}
+
+size_t OrderedMapSize(const OrderedMap *map)
+{
+    assert(map != NULL);
+    return map->load;
+}
+
+void OrderedMapClear(OrderedMap *map)
+{
+    assert(map != NULL);
+
+    for (size_t i = 0; i < map->n_entries; i++)
+    {
+        MapKeyValue *kv = &map->entries[i].kv;
+        if (kv->key != NULL)
+        {
+            if (map->destroy_key_fn != NULL)
+            {
+                map->destroy_key_fn(kv->key);
+            }
+            if (map->destroy_value_fn != NULL)
+            {
+                map->destroy_value_fn(kv->value);
+            }
+        }
+    }
+    map->n_entries = 0;
+    map->load = 0;
+    memset(map->index, 0xff, map->index_size * sizeof(uint32_t));
+}
+
+void OrderedMapDestroy(OrderedMap *map)
+{
+    if (map != NULL)
+    {
+        OrderedMapClear(map);
+        free(map->entries);
+        free(map->index);
+        free(map);
+    }
+}
+
+void OrderedMapPrintStats(const OrderedMap *map, FILE *f)
+{
+    assert(map != NULL);
+
+    fprintf(f, "\tIndex size:                  %5zu\n", map->index_size);
+    fprintf(f, "\tNumber of elements:          %5zu\n", map->load);
+    fprintf(f, "\tNumber of removed entries:   %5zu\n", map->n_entries - map->load);
+    fprintf(f, "\tEntries capacity:            %5zu\n", map->entries_capacity);
+}
+
+/******************************************************************************/
+
+OrderedMapIterator OrderedMapIteratorInit(OrderedMap *map)
+{
+    assert(map != NULL);
+    return (OrderedMapIterator) { map, 0 };
+}
+
+MapKeyValue *OrderedMapIteratorNext(OrderedMapIterator *i)
+{
+    assert(i != NULL);
+
+    while (i->pos < i->map->n_entries)
+    {
+        MapKeyValue *kv = &i->map->entries[i->pos++].kv;
+        if (kv->key != NULL)
+        {
+            return kv;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,96 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_ORDERED_MAP_H
+#define CFENGINE_ORDERED_MAP_H
+
+#include <stddef.h>     // size_t
+#include <stdio.h>      // FILE
+#include <map_common.h>
+
+/*
+ * Insertion-ordered map.
+ *
+ * Entries are stored densely in an array in the order they were inserted and
+ * a separate, small open addressing index (an array of entry positions) is
+ * used for lookups, the same layout as Python's compact dict. Compared to
+ * HashMap there is no node per entry and iteration is cache-friendly and
+ * deterministic: always in insertion order. Replacing the value of an
+ * existing key keeps its position, removing and re-inserting a key moves it to
+ * the end.
+ *
+ * Keys must not be NULL. Removing entries while iterating is not supported.
+ */
+typedef struct OrderedMap_ OrderedMap;
+
+typedef struct
+{
+    OrderedMap *map;
+    size_t pos;
+} OrderedMapIterator;
+
+OrderedMap *OrderedMapNew(MapHashFn hash_fn,
+                          MapKeyEqualFn equal_fn,
+                          MapDestroyDataFn destroy_key_fn,
+                          MapDestroyDataFn destroy_value_fn);
+
+/**
+ * Insert a key-value pair in the map.
+ * If the key is in the map, value get replaced. Old value is destroyed.
+ *
+ * @retval true if key exists already.
+ */
+bool OrderedMapInsert(OrderedMap *map, void *key, void *value);
+
+bool OrderedMapHasKey(const OrderedMap *map, const void *key);
+
+/*
+ * Returns the value if the key is in map, NULL otherwise.
+ */
+void *OrderedMapGet(const OrderedMap *map, const void *key);
+
+/*
+ * Remove key/value pair from the map. Returns 'true' if key was present in the
+ * map.
+ */
+bool OrderedMapRemove(OrderedMap *map, const void *key);
+
+size_t OrderedMapSize(const OrderedMap *map);
+void OrderedMapClear(OrderedMap *map);
+void OrderedMapDestroy(OrderedMap *map);
+void OrderedMapPrintStats(const OrderedMap *map, FILE *f);
+
+/*
+ * Iterates in insertion order.
+ *
+ * OrderedMapIterator i = OrderedMapIteratorInit(map);
+ * MapKeyValue *item;
+ * while ((item = OrderedMapIteratorNext(&i)))
+ * {
+ *     // do something with item->key, item->value
+ * }
+ */
+OrderedMapIterator OrderedMapIteratorInit(OrderedMap *map);
+MapKeyValue *OrderedMapIteratorNext(OrderedMapIterator *i);
+
+#endif
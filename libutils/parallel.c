@@ -0,0 +1,619 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <parallel.h>
+#include <alloc.h>
+#include <cleanup.h>            // RegisterCleanupFunction()
+#include <misc_lib.h>           // GetOnlineCPUCount()
+
+/* Limit on the number of worker threads, whatever the number of CPUs */
+#define PARALLEL_MAX_WORKERS 63
+
+/* Chunks per thread when the caller lets us pick the chunk size, more chunks
+ * balance uneven work better at the cost of more atomic increments */
+#define PARALLEL_CHUNKS_PER_THREAD 8
+
+typedef struct
+{
+    ParallelForFn *fn;
+    void *data;
+    size_t from;
+    size_t to;
+    size_t chunk_size;
+    size_t next;                /* next index to hand out, atomic */
+} ParallelJob;
+
+typedef struct
+{
+    pthread_mutex_t lock;       /* protects all the fields below */
+    pthread_cond_t job_posted;
+    pthread_cond_t job_done;
+    pthread_t *threads;
+    size_t n_threads;
+    bool started;
+    bool shutdown;
+    unsigned long generation;   /* incremented with every posted job */
+    ParallelJob *job;
+    size_t n_busy;              /* workers not yet done with the job */
+} WorkerPool;
+
+static WorkerPool POOL = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .job_posted = PTHREAD_COND_INITIALIZER,
+    .job_done = PTHREAD_COND_INITIALIZER,
+};
+
+/* Held by the thread running a job on the pool */
+static pthread_mutex_t POOL_SUBMIT_LOCK = PTHREAD_MUTEX_INITIALIZER;
+
+static void RunJob(ParallelJob *job)
+{
+    for (;;)
+    {
+        size_t from = __atomic_fetch_add(&job->next, job->chunk_size,
+                                         __ATOMIC_RELAXED);
+        if (from >= job->to)
+        {
+            return;
+        }
+        job->fn(from, MIN(from + job->chunk_size, job->to), job->data);
+    }
+}
+
+static void *WorkerMain(ARG_UNUSED void *arg)
+{
+    unsigned long seen_generation = 0;
+
+    pthread_mutex_lock(&POOL.lock);
+    for (;;)
+    {
+        while (!POOL.shutdown && POOL.generation == seen_generation)
+        {
+            pthread_cond_wait(&POOL.job_posted, &POOL.lock);
+        }
+        if (POOL.shutdown)
+        {
+            break;
+        }
+        seen_generation = POOL.generation;
+        ParallelJob *job = POOL.job;
+        pthread_mutex_unlock(&POOL.lock);
+
+        RunJob(job);
+
+        pthread_mutex_lock(&POOL.lock);
+        if (--POOL.n_busy == 0)
+        {
+            pthread_cond_signal(&POOL.job_done);
+        }
+    }
+    pthread_mutex_unlock(&POOL.lock);
+
+    return NULL;
+}
+
+static void PoolShutdown(void)
+{
+    /* A loop is running, maybe on this very thread when the cleanup comes
+     * from a loop body (e.g. FatalError()), leave the workers be */
+    if (pthread_mutex_trylock(&POOL_SUBMIT_LOCK) != 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&POOL.lock);
+    POOL.shutdown = true;
+    pthread_cond_broadcast(&POOL.job_posted);
+    pthread_mutex_unlock(&POOL.lock);
+
+    for (size_t i = 0; i < POOL.n_threads; i++)
+    {
+        pthread_join(POOL.threads[i], NULL);
+    }
+    free(POOL.threads);
+    POOL.threads = NULL;
+    /* Any later loops run on the calling thread */
+    POOL.n_threads = 0;
+
+    pthread_mutex_unlock(&POOL_SUBMIT_LOCK);
+}
+
+#ifndef __MINGW32__
+/* The workers do not survive fork(), the child starts its own pool when it
+ * needs one. The locks may have been held by threads that are gone too. */
+static void PoolResetInChild(void)
+{
+    pthread_mutex_init(&POOL.lock, NULL);
+    pthread_cond_init(&POOL.job_posted, NULL);
+    pthread_cond_init(&POOL.job_done, NULL);
+    pthread_mutex_init(&POOL_SUBMIT_LOCK, NULL);
+
+    free(POOL.threads);
+    POOL.threads = NULL;
+    POOL.n_threads = 0;
+    POOL.started = false;
+    POOL.shutdown = false;
+    POOL.job = NULL;
+    POOL.n_busy = 0;
+}
+
+static pthread_once_t POOL_ATFORK_ONCE = PTHREAD_ONCE_INIT;
+
+static void PoolRegisterAtFork(void)
+{
+    pthread_atfork(NULL, NULL, PoolResetInChild);
+}
+#endif
+
+/* Start the pool with the given number of workers, unless already started */
+static void PoolStart(size_t n_workers)
+{
+    pthread_mutex_lock(&POOL.lock);
+    if (POOL.started)
+    {
+        pthread_mutex_unlock(&POOL.lock);
+        return;
+    }
+    POOL.started = true;
+#ifndef __MINGW32__
+    pthread_once(&POOL_ATFORK_ONCE, PoolRegisterAtFork);
+#endif
+
+    n_workers = MIN(n_workers, PARALLEL_MAX_WORKERS);
+    POOL.threads = xcalloc(MAX(n_workers, 1), sizeof(pthread_t));
+    while (POOL.n_threads < n_workers &&
+           pthread_create(&POOL.threads[POOL.n_threads], NULL,
+                          WorkerMain, NULL) == 0)
+    {
+        POOL.n_threads++;
+    }
+    pthread_mutex_unlock(&POOL.lock);
+
+    if (n_workers > 0)
+    {
+        RegisterCleanupFunction(PoolShutdown);
+    }
+}
+
+static void PoolEnsureStarted(void)
+{
+    PoolStart(GetOnlineCPUCount() - 1);
+}
+
+size_t ParallelThreadCount(void)
+{
+    PoolEnsureStarted();
+
+    pthread_mutex_lock(&POOL.lock);
+    size_t n_threads = POOL.n_threads + 1;
+    pthread_mutex_unlock(&POOL.lock);
+
+    return n_threads;
+}
+
+void ParallelFor(size_t from, size_t to, size_t chunk_size,
+                 ParallelForFn *fn, void *data)
+{
+    assert(fn != NULL);
+
+    if (from >= to)
+    {
+        return;
+    }
+
+    PoolEnsureStarted();
+
+    /* Pool busy (nested call, other thread) or no workers, run it here */
+    if (pthread_mutex_trylock(&POOL_SUBMIT_LOCK) != 0)
+    {
+        fn(from, to, data);
+        return;
+    }
+    if (POOL.n_threads == 0)
+    {
+        pthread_mutex_unlock(&POOL_SUBMIT_LOCK);
+        fn(from, to, data);
+        return;
+    }
+
+    if (chunk_size == 0)
+    {
+        chunk_size = (to - from) /
+            ((POOL.n_threads + 1) * PARALLEL_CHUNKS_PER_THREAD);
+        chunk_size = MAX(chunk_size, 1);
+    }
+
+    ParallelJob job = {
+        .fn = fn,
+        .data = data,
+        .from = from,
+        .to = to,
+        .chunk_size = chunk_size,
+        .next = from,
+    };
+
+    pthread_mutex_lock(&POOL.lock);
+    POOL.job = &job;
+    POOL.n_busy = POOL.n_threads;
+    POOL.generation++;
+    pthread_cond_broadcast(&POOL.job_posted);
+    pthread_mutex_unlock(&POOL.lock);
+
+    RunJob(&job);
+
+    /* All the workers must be done with the job before it goes out of
+     * scope, even those which found nothing left to do */
+    pthread_mutex_lock(&POOL.lock);
+    while (POOL.n_busy > 0)
+    {
+        pthread_cond_wait(&POOL.job_done, &POOL.lock);
+    }
+    POOL.job = NULL;
+    pthread_mutex_unlock(&POOL.lock);
+
+    pthread_mutex_unlock(&POOL_SUBMIT_LOCK);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Sequence operations
+//////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    const Seq *seq;
+    Seq *result;
+    SeqMapFn *map;
+    void *data;
+} SeqMapJob;
+
+static void SeqMapRange(size_t from, size_t to, void *data)
+{
+    SeqMapJob *job = data;
+    for (size_t i = from; i < to; i++)
+    {
+        job->result->data[i] = job->map(job->seq->data[i], job->data);
+    }
+}
+
+Seq *SeqParallelMap(const Seq *seq, SeqMapFn *map, void *data,
+                    void (*ItemDestroy) (void *item))
+{
+    assert(seq != NULL);
+    assert(map != NULL);
+
+    Seq *result = SeqNew(seq->length, ItemDestroy);
+    SeqMapJob job = { seq, result, map, data };
+    ParallelFor(0, seq->length, 0, SeqMapRange, &job);
+    result->length = seq->length;
+
+    return result;
+}
+
+typedef struct
+{
+    const Seq *seq;
+    bool *remove;
+    SeqFilterFn *filter;
+} SeqFilterJob;
+
+static void SeqFilterRange(size_t from, size_t to, void *data)
+{
+    SeqFilterJob *job = data;
+    for (size_t i = from; i < to; i++)
+    {
+        job->remove[i] = job->filter(job->seq->data[i]);
+    }
+}
+
+Seq *SeqParallelFilter(Seq *seq, SeqFilterFn filter)
+{
+    assert(seq != NULL);
+    assert(filter != NULL);
+
+    const size_t length = seq->length;
+    bool *remove = xmalloc(length * sizeof(bool));
+    SeqFilterJob job = { seq, remove, filter };
+    ParallelFor(0, length, 0, SeqFilterRange, &job);
+
+    size_t to = 0;
+    for (size_t from = 0; from < length; from++)
+    {
+        if (remove[from])
+        {
+            if (seq->ItemDestroy != NULL)
+            {
+                seq->ItemDestroy(seq->data[from]);
+            }
+        }
+        else
+        {
+            seq->data[to++] = seq->data[from];
+        }
+    }
+    seq->length = to;
+
+    free(remove);
+    return seq;
+}
+
+typedef struct
+{
+    const Seq *seq;
+    size_t chunk_size;
+    void **accumulators;        /* one per chunk */
+    SeqReduceFn *reduce;
+    void *data;
+} SeqReduceJob;
+
+/* Usually gets a single chunk, but all of them if ParallelFor() falls back to
+ * running on the calling thread */
+static void SeqReduceRange(size_t from, size_t to, void *data)
+{
+    SeqReduceJob *job = data;
+    for (size_t start = from; start < to; start += job->chunk_size)
+    {
+        const size_t end = MIN(start + job->chunk_size, to);
+        void *accumulator = NULL;
+        for (size_t i = start; i < end; i++)
+        {
+            accumulator = job->reduce(accumulator, job->seq->data[i], job->data);
+        }
+        job->accumulators[start / job->chunk_size] = accumulator;
+    }
+}
+
+void *SeqParallelReduce(const Seq *seq, SeqReduceFn *reduce,
+                        SeqCombineFn *combine, void *data)
+{
+    assert(seq != NULL);
+    assert(reduce != NULL);
+    assert(combine != NULL);
+
+    const size_t length = seq->length;
+    if (length == 0)
+    {
+        return NULL;
+    }
+
+    /* Fixed chunks, so that the accumulators can be combined in order */
+    const size_t n_chunks_wanted =
+        ParallelThreadCount() * PARALLEL_CHUNKS_PER_THREAD;
+    const size_t chunk_size = MAX(length / n_chunks_wanted, 1);
+    const size_t n_chunks = (length + chunk_size - 1) / chunk_size;
+
+    SeqReduceJob job = {
+        .seq = seq,
+        .chunk_size = chunk_size,
+        .accumulators = xcalloc(n_chunks, sizeof(void *)),
+        .reduce = reduce,
+        .data = data,
+    };
+    ParallelFor(0, length, chunk_size, SeqReduceRange, &job);
+
+    void *result = job.accumulators[0];
+    for (size_t i = 1; i < n_chunks; i++)
+    {
+        result = combine(result, job.accumulators[i], data);
+    }
+
+    free(job.accumulators);
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Parallel sort
+//////////////////////////////////////////////////////////////////////////////
+
+/*
+ * SeqSortParallel() splits the data into one chunk per thread, sorts the
+ * chunks with SeqSort() and then merges them pairwise in log2(chunks)
+ * rounds. In every round each chunk index produces an equal share of the
+ * output, finding where its share starts in the two runs by binary search, so
+ * the merging is parallel all the way up to the last round.
+ */
+
+/* Chunks smaller than this are not worth a thread */
+#define SORT_MIN_CHUNK (1 << 15)
+
+typedef struct
+{
+    SeqItemComparator compare;
+    void *user_data;
+    void **src;
+    void **dst;
+    size_t length;
+    size_t n_chunks;
+    size_t width;               /* chunks per run in the current round */
+} ParallelSort;
+
+static inline bool SortLess(const ParallelSort *sort, const void *a,
+                            const void *b)
+{
+    return sort->compare(a, b, sort->user_data) < 0;
+}
+
+static size_t SortChunkStart(const ParallelSort *sort, size_t chunk)
+{
+    return (sort->length / sort->n_chunks) * chunk +
+        MIN(chunk, sort->length % sort->n_chunks);
+}
+
+static void SortChunks(size_t from, size_t to, void *data)
+{
+    const ParallelSort *sort = data;
+    for (size_t chunk = from; chunk < to; chunk++)
+    {
+        const size_t start = SortChunkStart(sort, chunk);
+        const size_t end = SortChunkStart(sort, chunk + 1);
+
+        /* A view of the chunk, SeqSort() only reorders the items */
+        Seq view = { .data = sort->src + start, .length = end - start };
+        SeqSort(&view, sort->compare, sort->user_data);
+    }
+}
+
+/**
+ * @return how many of the first k items of the stable merge of left and
+ *         right come from left
+ */
+static size_t MergeSplit(const ParallelSort *sort,
+                         void *const *left, size_t n_left,
+                         void *const *right, size_t n_right, size_t k)
+{
+    size_t low = (k > n_right) ? k - n_right : 0;
+    size_t high = MIN(k, n_left);
+
+    while (low < high)
+    {
+        size_t i = low + (high - low) / 2;
+        size_t j = k - i;
+        /* left[i] goes before right[j - 1], need more from left */
+        if (!SortLess(sort, right[j - 1], left[i]))
+        {
+            low = i + 1;
+        }
+        else
+        {
+            high = i;
+        }
+    }
+    return low;
+}
+
+static void Merge(const ParallelSort *sort,
+                  void *const *left, size_t n_left,
+                  void *const *right, size_t n_right, void **dst)
+{
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < n_left && j < n_right)
+    {
+        /* Take from the right run only if strictly smaller, keeps the merge
+         * consistent with MergeSplit() */
+        if (SortLess(sort, right[j], left[i]))
+        {
+            *dst++ = right[j++];
+        }
+        else
+        {
+            *dst++ = left[i++];
+        }
+    }
+    memcpy(dst, left + i, (n_left - i) * sizeof(void *));
+    dst += n_left - i;
+    memcpy(dst, right + j, (n_right - j) * sizeof(void *));
+}
+
+static void MergeShares(size_t from, size_t to, void *data)
+{
+    const ParallelSort *sort = data;
+    for (size_t share = from; share < to; share++)
+    {
+        /* This share of the output */
+        const size_t out_start = SortChunkStart(sort, share);
+        const size_t out_end = SortChunkStart(sort, share + 1);
+
+        for (size_t chunk = 0; chunk < sort->n_chunks; chunk += 2 * sort->width)
+        {
+            const size_t start = SortChunkStart(sort, chunk);
+            const size_t middle = SortChunkStart(sort,
+                MIN(chunk + sort->width, sort->n_chunks));
+            const size_t end = SortChunkStart(sort,
+                MIN(chunk + 2 * sort->width, sort->n_chunks));
+
+            if (end <= out_start || start >= out_end)
+            {
+                continue;
+            }
+
+            void *const *left = sort->src + start;
+            void *const *right = sort->src + middle;
+            const size_t n_left = middle - start;
+            const size_t n_right = end - middle;
+
+            const size_t k_from = MAX(out_start, start) - start;
+            const size_t k_to = MIN(out_end, end) - start;
+            const size_t i_from = MergeSplit(sort, left, n_left,
+                                             right, n_right, k_from);
+            const size_t i_to = MergeSplit(sort, left, n_left,
+                                           right, n_right, k_to);
+
+            Merge(sort, left + i_from, i_to - i_from,
+                  right + (k_from - i_from), (k_to - i_to) - (k_from - i_from),
+                  sort->dst + start + k_from);
+        }
+    }
+}
+
+static void SortParallel(Seq *seq, SeqItemComparator compare, void *user_data,
+                         size_t n_chunks)
+{
+    assert(n_chunks >= 2);
+    assert(seq->length >= n_chunks);
+
+    ParallelSort sort = {
+        .compare = compare,
+        .user_data = user_data,
+        .src = seq->data,
+        .dst = NULL,
+        .length = seq->length,
+        .n_chunks = n_chunks,
+        .width = 1,
+    };
+
+    ParallelFor(0, n_chunks, 1, SortChunks, &sort);
+
+    void **buffer = xmalloc(seq->length * sizeof(void *));
+    sort.dst = buffer;
+    for (; sort.width < sort.n_chunks; sort.width *= 2)
+    {
+        ParallelFor(0, n_chunks, 1, MergeShares, &sort);
+        void **tmp = sort.src;
+        sort.src = sort.dst;
+        sort.dst = tmp;
+    }
+
+    if (sort.src != seq->data)
+    {
+        memcpy(seq->data, sort.src, seq->length * sizeof(void *));
+    }
+    free(buffer);
+}
+
+void SeqSortParallel(Seq *seq, SeqItemComparator compare, void *user_data)
+{
+    assert(seq != NULL);
+    assert(compare != NULL);
+
+    const size_t n_chunks = MIN(ParallelThreadCount(),
+                                seq->length / SORT_MIN_CHUNK);
+    if (n_chunks < 2)
+    {
+        SeqSort(seq, compare, user_data);
+        return;
+    }
+
+    SortParallel(seq, compare, user_data, n_chunks);
+}
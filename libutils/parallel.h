@@ -0,0 +1,120 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_PARALLEL_H
+#define CFENGINE_PARALLEL_H
+
+#include <stddef.h>     // size_t
+#include <sequence.h>   // Seq, SeqFilterFn
+
+/*
+ * Data-parallel loops on a process-wide pool of worker threads.
+ *
+ * The pool has one thread less than there are CPUs (the calling thread does
+ * its share of the work) and is started on first use. The index range is cut
+ * into chunks which the threads take one by one, so uneven per-item costs
+ * are balanced out.
+ *
+ * Only one loop runs on the pool at a time. A loop started while the pool is
+ * busy, e.g. a nested one or one from another thread, simply runs on the
+ * calling thread. The callbacks are called concurrently and must be
+ * thread-safe.
+ */
+
+/**
+ * @brief Callback processing the items in [from, to)
+ */
+typedef void ParallelForFn(size_t from, size_t to, void *data);
+
+/**
+ * @brief Call fn() over [from, to) in chunks of at most chunk_size indices
+ * @param chunk_size Number of indices per chunk, 0 to pick one based on the
+ *                   number of threads
+ * @note Returns when all the chunks have been processed.
+ */
+void ParallelFor(size_t from, size_t to, size_t chunk_size,
+                 ParallelForFn *fn, void *data);
+
+/**
+ * @brief Number of threads ParallelFor() uses, including the calling one
+ */
+size_t ParallelThreadCount(void);
+
+/**
+ * @brief Callback for SeqParallelMap()
+ * @return The item of the new sequence
+ */
+typedef void *SeqMapFn(void *item, void *data);
+
+/**
+ * @brief Create a new sequence of map(item, data) for every item of seq
+ * @param ItemDestroy Destroy function of the new sequence
+ */
+Seq *SeqParallelMap(const Seq *seq, SeqMapFn *map, void *data,
+                    void (*ItemDestroy) (void *item));
+
+/**
+ * @brief Same as SeqFilter(), with the filter function called in parallel
+ * @note Filtered items are destroyed by the calling thread.
+ */
+Seq *SeqParallelFilter(Seq *seq, SeqFilterFn filter);
+
+/**
+ * @brief Callback for SeqParallelReduce() folding an item into an accumulator
+ * @param accumulator NULL for the first item of a chunk
+ * @return The new accumulator
+ */
+typedef void *SeqReduceFn(void *accumulator, void *item, void *data);
+
+/**
+ * @brief Callback for SeqParallelReduce() merging two chunks' accumulators
+ * @param left Accumulator of the items preceding those of right
+ * @return The merged accumulator, left and right are not used afterwards
+ */
+typedef void *SeqCombineFn(void *left, void *right, void *data);
+
+/**
+ * @brief Reduce the sequence, the chunks in parallel
+ *
+ * Every chunk is folded with reduce(), starting from NULL, and then the
+ * chunks' accumulators are merged in order with combine(). reduce() and
+ * combine() must together be associative, they need not be commutative.
+ *
+ * @return The final accumulator, NULL for an empty sequence
+ */
+void *SeqParallelReduce(const Seq *seq, SeqReduceFn *reduce,
+                        SeqCombineFn *combine, void *data);
+
+/**
+ * @brief Same as SeqSort(), but uses the pool's threads on big sequences
+ *
+ * The chunks are sorted with SeqSort() and then merged in parallel.
+ *
+ * @note Not stable. Falls back to SeqSort() for small sequences or when the
+ *       pool has no workers.
+ * @note The comparator is called concurrently from several threads with the
+ *       same user_data, so it must be thread-safe.
+ */
+void SeqSortParallel(Seq *seq, SeqItemComparator compare, void *user_data);
+
+#endif
@@ -0,0 +1,262 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <perfect_hash.h>
+#include <alloc.h>
+#include <string_lib.h>
+#include <misc_lib.h> // ProgrammingError()
+
+#define NO_KEY UINT32_MAX
+
+/* Plenty, a suitable seed is usually found within a few tries. */
+#define MAX_SEED_TRIES (1U << 24)
+
+struct StringPerfectHash_
+{
+    const char *const *keys;
+    bool ignore_case;
+    size_t max_len;
+    size_t n_buckets;
+    size_t n_slots;             /* number of unique keys */
+    uint32_t *seeds;            /* per bucket */
+    uint32_t *slots;            /* index into keys */
+};
+
+typedef struct
+{
+    uint32_t bucket;
+    uint32_t first;             /* position in the sorted keys */
+    uint32_t count;
+} Bucket;
+
+static inline unsigned int BucketHash(const char *str, size_t len)
+{
+    return StringHashN(str, len, 0);
+}
+
+static inline unsigned int SlotHash(const char *str, size_t len,
+                                    unsigned int seed)
+{
+    return StringHashN(str, len, seed);
+}
+
+static int BucketCompareBySizeDesc(const void *a, const void *b)
+{
+    const Bucket *ba = a, *bb = b;
+    return (ba->count < bb->count) - (ba->count > bb->count);
+}
+
+/**
+ * Find a seed that maps all the keys of bucket to distinct free slots and
+ * claim those slots.
+ */
+static void PlaceBucket(StringPerfectHash *table, const Bucket *bucket,
+                        char *const *hashed, const uint32_t *key_index,
+                        const uint32_t *sorted, uint32_t *candidate)
+{
+    for (uint32_t seed = 1; seed < MAX_SEED_TRIES; seed++)
+    {
+        size_t k;
+        for (k = 0; k < bucket->count; k++)
+        {
+            const char *key = hashed[sorted[bucket->first + k]];
+            candidate[k] = SlotHash(key, strlen(key), seed) % table->n_slots;
+            if (table->slots[candidate[k]] != NO_KEY)
+            {
+                break;
+            }
+            /* Must not collide within the bucket either. */
+            size_t j = 0;
+            while (j < k && candidate[j] != candidate[k])
+            {
+                j++;
+            }
+            if (j < k)
+            {
+                break;
+            }
+        }
+
+        if (k == bucket->count)
+        {
+            table->seeds[bucket->bucket] = seed;
+            for (k = 0; k < bucket->count; k++)
+            {
+                table->slots[candidate[k]] =
+                    key_index[sorted[bucket->first + k]];
+            }
+            return;
+        }
+    }
+
+    ProgrammingError("StringPerfectHashNew: No seed found for bucket %"
+                     PRIu32, bucket->bucket);
+}
+
+StringPerfectHash *StringPerfectHashNew(const char *const *keys, size_t n_keys,
+                                        bool ignore_case)
+{
+    assert(keys != NULL || n_keys == 0);
+
+    StringPerfectHash *table = xcalloc(1, sizeof(StringPerfectHash));
+    table->keys = keys;
+    table->ignore_case = ignore_case;
+
+    /* Non-NULL keys to hash (case folded if needed) and their indices */
+    const size_t alloc_n = MAX(n_keys, 1);
+    char **hashed = xmalloc(alloc_n * sizeof(char *));
+    uint32_t *key_index = xmalloc(alloc_n * sizeof(uint32_t));
+    size_t n = 0;
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        if (keys[i] != NULL)
+        {
+            const size_t len = strlen(keys[i]);
+            assert(!ignore_case || len <= STRING_PERFECT_HASH_MAX_CASE_KEY_LEN);
+            hashed[n] = xstrdup(keys[i]);
+            if (ignore_case)
+            {
+                ToLowerStrInplace(hashed[n]);
+            }
+            table->max_len = MAX(table->max_len, len);
+            key_index[n++] = i;
+        }
+    }
+
+    /* Sort the keys into buckets (stable, so the first of duplicate keys
+     * comes first) and drop duplicates, which always share a bucket. */
+    table->n_buckets = MAX(n, 1);
+    Bucket *buckets = xcalloc(table->n_buckets, sizeof(Bucket));
+    uint32_t *bucket_of = xmalloc(alloc_n * sizeof(uint32_t));
+    for (size_t i = 0; i < n; i++)
+    {
+        bucket_of[i] = BucketHash(hashed[i], strlen(hashed[i])) % table->n_buckets;
+        buckets[bucket_of[i]].first++;
+    }
+    uint32_t first = 0;
+    for (size_t b = 0; b < table->n_buckets; b++)
+    {
+        const uint32_t size = buckets[b].first;
+        buckets[b].bucket = b;
+        buckets[b].first = first;
+        first += size;
+    }
+
+    uint32_t *sorted = xmalloc(alloc_n * sizeof(uint32_t));
+    for (size_t i = 0; i < n; i++)
+    {
+        Bucket *bucket = &buckets[bucket_of[i]];
+        bool duplicate = false;
+        for (size_t k = 0; k < bucket->count; k++)
+        {
+            duplicate = duplicate ||
+                StringEqual(hashed[sorted[bucket->first + k]], hashed[i]);
+        }
+        if (!duplicate)
+        {
+            sorted[bucket->first + bucket->count++] = i;
+            table->n_slots++;
+        }
+    }
+
+    table->seeds = xcalloc(table->n_buckets, sizeof(uint32_t));
+    table->slots = xmalloc(MAX(table->n_slots, 1) * sizeof(uint32_t));
+    for (size_t s = 0; s < MAX(table->n_slots, 1); s++)
+    {
+        table->slots[s] = NO_KEY;
+    }
+
+    /* Biggest buckets first, while there's still most room. */
+    qsort(buckets, table->n_buckets, sizeof(Bucket), BucketCompareBySizeDesc);
+    uint32_t *candidate = xmalloc(alloc_n * sizeof(uint32_t));
+    for (size_t b = 0; b < table->n_buckets && buckets[b].count > 0; b++)
+    {
+        PlaceBucket(table, &buckets[b], hashed, key_index, sorted, candidate);
+    }
+
+    free(candidate);
+    free(sorted);
+    free(bucket_of);
+    free(buckets);
+    free(key_index);
+    for (size_t i = 0; i < n; i++)
+    {
+        free(hashed[i]);
+    }
+    free(hashed);
+
+    return table;
+}
+
+ssize_t StringPerfectHashLookup(const StringPerfectHash *table, const char *str)
+{
+    assert(table != NULL);
+    assert(str != NULL);
+
+    if (table->n_slots == 0)
+    {
+        return -1;
+    }
+
+    /* Too long strings can't be in the table, no need to hash them. */
+    const size_t len = strnlen(str, table->max_len + 1);
+    if (len > table->max_len)
+    {
+        return -1;
+    }
+
+    const char *hashed = str;
+    char folded[STRING_PERFECT_HASH_MAX_CASE_KEY_LEN + 1];
+    if (table->ignore_case)
+    {
+        for (size_t i = 0; i <= len; i++)
+        {
+            folded[i] = ToLower(str[i]);
+        }
+        hashed = folded;
+    }
+
+    const size_t bucket = BucketHash(hashed, len) % table->n_buckets;
+    const size_t slot = SlotHash(hashed, len, table->seeds[bucket]) % table->n_slots;
+    const uint32_t i = table->slots[slot];
+    if (i == NO_KEY)
+    {
+        return -1;
+    }
+
+    const bool equal = table->ignore_case ?
+        StringEqual_IgnoreCase(table->keys[i], str) :
+        StringEqual(table->keys[i], str);
+    return equal ? (ssize_t) i : -1;
+}
+
+void StringPerfectHashDestroy(StringPerfectHash *table)
+{
+    if (table != NULL)
+    {
+        free(table->seeds);
+        free(table->slots);
+        free(table);
+    }
+}
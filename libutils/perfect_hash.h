@@ -0,0 +1,62 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_PERFECT_HASH_H
+#define CFENGINE_PERFECT_HASH_H
+
+#include <stdbool.h>
+#include <stddef.h>     // size_t
+#include <sys/types.h>  // ssize_t
+
+/*
+ * Minimal perfect hash for constant tables of strings.
+ *
+ * Built once (typically with pthread_once()) from a fixed array of strings,
+ * after which looking up a string costs two hashes and a single string
+ * comparison, no matter how big the table is, instead of a strcmp() per entry
+ * of a linear scan. Uses hash and displace: keys are split into buckets by a
+ * first hash, and for every bucket a seed is searched for so that the second
+ * (seeded) hash maps all keys of the bucket into distinct, still free slots.
+ */
+typedef struct StringPerfectHash_ StringPerfectHash;
+
+/* Longest key supported by case-insensitive tables */
+#define STRING_PERFECT_HASH_MAX_CASE_KEY_LEN 255
+
+/**
+ * @param keys array of n_keys strings, NULL entries are skipped, for
+ *             duplicates the first one is found. Not copied, must outlive
+ *             the table.
+ * @param ignore_case whether lookups are case-insensitive (ASCII)
+ */
+StringPerfectHash *StringPerfectHashNew(const char *const *keys, size_t n_keys,
+                                        bool ignore_case);
+
+/**
+ * @return index of str in the keys array, -1 if not there
+ */
+ssize_t StringPerfectHashLookup(const StringPerfectHash *table, const char *str);
+
+void StringPerfectHashDestroy(StringPerfectHash *table);
+
+#endif
@@ -57,6 +57,7 @@ struct RBTreeIterator_
 {
     const RBTree *tree;
     RBNode *curr;
+    RBNode *end;                /* tree->nil unless iterating a range */
 };
 
 static void PutFix_(RBTree *tree, RBNode *z);
@@ -155,17 +156,20 @@ static void TreeDestroy_(RBTree *tree, RBNode *x)
 
 RBTree *RBTreeCopy(const RBTree *tree, RBTreePredicate *filter, void *user_data)
 {
-    RBNode **nodes = xmalloc(tree->size * sizeof(RBNode *));
-    size_t node_count = 0;
+    const void **keys = xmalloc(tree->size * sizeof(void *));
+    const void **values = xmalloc(tree->size * sizeof(void *));
+    size_t count = 0;
 
     {
-        RBTreeIterator *iter = NULL;
-        for (iter = RBTreeIteratorNew(tree); iter->curr != iter->tree->nil; iter->curr = Next_(iter->tree, iter->curr))
+        RBTreeIterator *iter = RBTreeIteratorNew(tree);
+        void *key, *value;
+        while (RBTreeIteratorNext(iter, &key, &value))
         {
-            if (!filter || filter(iter->curr->key, iter->curr->value, user_data))
+            if (!filter || filter(key, value, user_data))
             {
-                nodes[node_count] = iter->curr;
-                node_count++;
+                keys[count] = key;
+                values[count] = value;
+                count++;
             }
         }
         RBTreeIteratorDestroy(iter);
@@ -174,36 +178,72 @@ RBTree *RBTreeCopy(const RBTree *tree, RBTreePredicate *filter, void *user_data)
     RBTree *copy = RBTreeNew(tree->KeyCopy, tree->KeyCompare, tree->KeyDestroy,
                              tree->ValueCopy, tree->ValueCompare, tree->ValueDestroy);
 
-    RBNode *node = NULL;
-    // [0, 1, 2, 3, 4]
-    if ((node_count % 2) != 0)
+    NDEBUG_UNUSED bool loaded = RBTreeBulkLoad(copy, keys, values, count);
+    assert(loaded);
+
+    free(keys);
+    free(values);
+
+    return copy;
+}
+
+static RBNode *BuildSorted_(RBTree *tree, RBNode *parent,
+                            const void *const *keys, const void *const *values,
+                            size_t count, int depth, int red_depth)
+{
+    if (count == 0)
     {
-        node = nodes[node_count / 2];
-        RBTreePut(copy, node->key, node->value);
-        node_count--;
+        return tree->nil;
     }
-    else
+
+    const size_t mid = (count - 1) / 2;
+    RBNode *node = NodeNew_(tree, parent, depth == red_depth,
+                            keys[mid], values[mid]);
+    node->left = BuildSorted_(tree, node, keys, values, mid,
+                              depth + 1, red_depth);
+    node->right = BuildSorted_(tree, node, keys + mid + 1, values + mid + 1,
+                               count - mid - 1, depth + 1, red_depth);
+    return node;
+}
+
+bool RBTreeBulkLoad(RBTree *tree, const void *const *keys,
+                    const void *const *values, size_t count)
+{
+    assert(tree->size == 0);
+
+    for (size_t i = 1; i < count; i++)
     {
-        node = copy->root;
+        if (tree->KeyCompare(keys[i - 1], keys[i]) >= 0)
+        {
+            return false;
+        }
     }
 
-    assert((node_count % 2) == 0);
-
-    // [0, 1, 2, 3]
-    for (size_t i = 0; i < (node_count / 2); i += 1)
+    if (count == 0)
     {
-        node = nodes[(node_count / 2) + i];
-        RBTreePut(copy, node->key, node->value);
+        return true;
+    }
 
-        node = nodes[(node_count / 2) - i - 1];
-        RBTreePut(copy, node->key, node->value);
+    /* Splitting at the middle fills all levels but the deepest one, so
+     * coloring just the deepest level red gives every path the same number
+     * of black nodes. The root has to stay black though. */
+    int red_depth = 0;
+    for (size_t c = count; c > 1; c >>= 1)
+    {
+        red_depth++;
+    }
+    if (red_depth == 0)
+    {
+        red_depth = -1;
     }
 
-    free(nodes);
+    tree->root->left = BuildSorted_(tree, tree->root, keys, values, count,
+                                    0, red_depth);
+    tree->size = count;
 
-    VerifyTree_(copy);
+    VerifyTree_(tree);
 
-    return copy;
+    return true;
 }
 
 bool RBTreeEqual(const void *_a, const void *_b)
@@ -662,10 +702,99 @@ RBTreeIterator *RBTreeIteratorNew(const RBTree *tree)
 
     iter->tree = tree;
     for (iter->curr = iter->tree->root; iter->curr->left != tree->nil; iter->curr = iter->curr->left);
+    iter->end = tree->nil;
 
     return iter;
 }
 
+/**
+ * @return the first node with a key not less than key (greater than key if
+ *         strict), tree->nil if there is none
+ */
+static RBNode *Bound_(const RBTree *tree, const void *key, bool strict)
+{
+    RBNode *bound = tree->nil;
+    RBNode *curr = tree->root->left;
+
+    while (curr != tree->nil)
+    {
+        int cmp = tree->KeyCompare(curr->key, key);
+        if (cmp > 0 || (cmp == 0 && !strict))
+        {
+            bound = curr;
+            curr = curr->left;
+        }
+        else
+        {
+            curr = curr->right;
+        }
+    }
+
+    return bound;
+}
+
+static bool BoundEntry_(const RBTree *tree, const void *key, bool strict,
+                        void **found_key, void **found_value)
+{
+    RBNode *node = Bound_(tree, key, strict);
+    if (node == tree->nil)
+    {
+        return false;
+    }
+
+    if (found_key)
+    {
+        *found_key = node->key;
+    }
+    if (found_value)
+    {
+        *found_value = node->value;
+    }
+    return true;
+}
+
+bool RBTreeLowerBound(const RBTree *tree, const void *key,
+                      void **found_key, void **found_value)
+{
+    return BoundEntry_(tree, key, false, found_key, found_value);
+}
+
+bool RBTreeUpperBound(const RBTree *tree, const void *key,
+                      void **found_key, void **found_value)
+{
+    return BoundEntry_(tree, key, true, found_key, found_value);
+}
+
+RBTreeIterator *RBTreeIteratorNewRange(const RBTree *tree,
+                                       const void *from, const void *to)
+{
+    RBTreeIterator *iter = RBTreeIteratorNew(tree);
+
+    if (tree->KeyCompare(from, to) >= 0)
+    {
+        iter->curr = tree->nil;
+        return iter;
+    }
+
+    iter->curr = Bound_(tree, from, false);
+    iter->end = Bound_(tree, to, false);
+    return iter;
+}
+
+RBTreeIterator *RBTreeIteratorNewFrom(const RBTree *tree, const void *from)
+{
+    RBTreeIterator *iter = RBTreeIteratorNew(tree);
+    iter->curr = Bound_(tree, from, false);
+    return iter;
+}
+
+RBTreeIterator *RBTreeIteratorNewTo(const RBTree *tree, const void *to)
+{
+    RBTreeIterator *iter = RBTreeIteratorNew(tree);
+    iter->end = Bound_(tree, to, false);
+    return iter;
+}
+
 bool Peek_(RBTreeIterator *iter, void **key, void **value)
 {
     if (iter->tree->size == 0)
@@ -673,7 +802,7 @@ bool Peek_(RBTreeIterator *iter, void **key, void **value)
         return false;
     }
 
-    if (iter->curr == iter->tree->nil)
+    if (iter->curr == iter->tree->nil || iter->curr == iter->end)
     {
         return false;
     }
@@ -47,6 +47,17 @@ RBTree *RBTreeNew(RBTreeKeyCopyFn *key_copy,
 
 RBTree *RBTreeCopy(const RBTree *tree, RBTreePredicate *filter, void *user_data);
 
+/**
+ * Fill an empty tree from entries already sorted by key, in O(count) time
+ * instead of O(count log count) for RBTreePut() of every entry.
+ *
+ * @param keys, values count keys and their values, copied like in RBTreePut()
+ * @return false (and the tree is left empty) if the keys are not in strictly
+ *         ascending order
+ */
+bool RBTreeBulkLoad(RBTree *tree, const void *const *keys,
+                    const void *const *values, size_t count);
+
 bool RBTreeEqual(const void *a, const void *b);
 void RBTreeDestroy(void *rb_tree);
 
@@ -56,7 +67,36 @@ bool RBTreeRemove(RBTree *tree, const void *key);
 void RBTreeClear(RBTree *tree);
 size_t RBTreeSize(const RBTree *tree);
 
+/**
+ * Find the first entry with a key not less than (lower bound) or greater than
+ * (upper bound) key.
+ *
+ * @param found_key, found_value set to the entry found (if not NULL)
+ * @return false if there is no such entry
+ */
+bool RBTreeLowerBound(const RBTree *tree, const void *key,
+                      void **found_key, void **found_value);
+bool RBTreeUpperBound(const RBTree *tree, const void *key,
+                      void **found_key, void **found_value);
+
 RBTreeIterator *RBTreeIteratorNew(const RBTree *tree);
+/**
+ * Iterate over entries with keys in [from, to), in ascending order.
+ *
+ * NULL is a key like any other (pointer keys with the default comparator),
+ * use RBTreeIteratorNewFrom() and RBTreeIteratorNewTo() for ranges open on
+ * one side.
+ */
+RBTreeIterator *RBTreeIteratorNewRange(const RBTree *tree,
+                                       const void *from, const void *to);
+/**
+ * Iterate over entries with keys not less than from, in ascending order.
+ */
+RBTreeIterator *RBTreeIteratorNewFrom(const RBTree *tree, const void *from);
+/**
+ * Iterate over entries with keys less than to, in ascending order.
+ */
+RBTreeIterator *RBTreeIteratorNewTo(const RBTree *tree, const void *to);
 bool RBTreeIteratorNext(RBTreeIterator *iter, void **key, void **value);
 void RBTreeIteratorDestroy(void *_rb_iter);
 
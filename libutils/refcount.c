@@ -25,6 +25,13 @@
 #include <refcount.h>
 #include <misc_lib.h>
 #include <platform.h>
+#include <mutex.h>
+
+/* Only decided here, so that code built with and without NDEBUG agrees on
+ * the RefCount structure. */
+#if !defined(NDEBUG) && !defined(REFCOUNT_NO_OWNER_TRACKING)
+# define REFCOUNT_TRACK_OWNERS
+#endif
 
 void RefCountNew(RefCount **ref)
 {
@@ -34,6 +41,9 @@ void RefCountNew(RefCount **ref)
     }
     *ref = (RefCount *)xmalloc(sizeof(RefCount));
     (*ref)->user_count = 0;
+#ifdef REFCOUNT_TRACK_OWNERS
+    pthread_mutex_init(&(*ref)->lock, NULL);
+#endif
     (*ref)->users = NULL;
     (*ref)->last = NULL;
 }
@@ -44,11 +54,16 @@ void RefCountDestroy(RefCount **ref)
     {
         // Destroying a refcount which has more than one user is a bug, but we let it
         // pass in production code (memory leak).
-        assert((*ref)->user_count <= 1);
-        if ((*ref)->user_count > 1)
+        const unsigned int user_count =
+            __atomic_load_n(&(*ref)->user_count, __ATOMIC_ACQUIRE);
+        assert(user_count <= 1);
+        if (user_count > 1)
             return;
+#ifdef REFCOUNT_TRACK_OWNERS
         if ((*ref)->users)
             free((*ref)->users);
+        pthread_mutex_destroy(&(*ref)->lock);
+#endif
         free(*ref);
         *ref = NULL;
     }
@@ -60,10 +75,13 @@ void RefCountAttach(RefCount *ref, void *owner)
     {
         ProgrammingError("Either refcount or owner is NULL (or both)");
     }
-    ref->user_count++;
+#ifdef REFCOUNT_TRACK_OWNERS
     RefCountNode *node = (RefCountNode *)xmalloc(sizeof(RefCountNode));
     node->next = NULL;
     node->user = owner;
+
+    ThreadLock(&ref->lock);
+    __atomic_fetch_add(&ref->user_count, 1, __ATOMIC_RELAXED);
     if (ref->last)
     {
         ref->last->next = node;
@@ -75,21 +93,23 @@ void RefCountAttach(RefCount *ref, void *owner)
         node->previous = NULL;
     }
     ref->last = node;
+    ThreadUnlock(&ref->lock);
+#else
+    /* The caller already holds a reference, nothing to synchronize with. */
+    __atomic_fetch_add(&ref->user_count, 1, __ATOMIC_RELAXED);
+#endif
 }
 
-void RefCountDetach(RefCount *ref, void *owner)
+#ifdef REFCOUNT_TRACK_OWNERS
+static bool DetachOwner(RefCount *ref, void *owner)
 {
-    if (!ref || !owner)
-    {
-        ProgrammingError("Either refcount or owner is NULL (or both)");
-    }
     if (ref->user_count <= 1)
     {
         /*
          * Semantics: If 1 that means that we are the only users, if 0 nobody is using it.
          * In either case it is safe to destroy the refcount.
          */
-        return;
+        return false;
     }
     RefCountNode *p = NULL;
     int found = 0;
@@ -118,7 +138,7 @@ void RefCountDetach(RefCount *ref, void *owner)
             else
             {
                 // Only one node, we cannot detach from ourselves.
-                return;
+                return false;
             }
             free(p);
             break;
@@ -128,15 +148,57 @@ void RefCountDetach(RefCount *ref, void *owner)
     {
         ProgrammingError("The object is not attached to the RefCount object");
     }
-    ref->user_count--;
+    __atomic_fetch_sub(&ref->user_count, 1, __ATOMIC_RELEASE);
+    return true;
+}
+#endif
+
+bool RefCountDetach(RefCount *ref, void *owner)
+{
+    if (!ref || !owner)
+    {
+        ProgrammingError("Either refcount or owner is NULL (or both)");
+    }
+#ifdef REFCOUNT_TRACK_OWNERS
+    ThreadLock(&ref->lock);
+    const bool detached = DetachOwner(ref, owner);
+    ThreadUnlock(&ref->lock);
+    return detached;
+#else
+    /*
+     * Acquire pairs with the release of the other users detaching, their use
+     * of the shared data has to be over once we see we are the only user.
+     */
+    unsigned int user_count = __atomic_load_n(&ref->user_count, __ATOMIC_ACQUIRE);
+    do
+    {
+        // Same semantics as above, the last user cannot detach.
+        if (user_count <= 1)
+        {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&ref->user_count, &user_count,
+                                          user_count - 1, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return true;
+#endif
 }
 
 bool RefCountIsShared(RefCount *ref)
 {
-    return ref && (ref->user_count > 1);
+    return ref && (__atomic_load_n(&ref->user_count, __ATOMIC_ACQUIRE) > 1);
 }
 
 bool RefCountIsEqual(RefCount *a, RefCount *b)
 {
     return (a && b) && (a == b);
 }
+
+bool RefCountTracksOwners(void)
+{
+#ifdef REFCOUNT_TRACK_OWNERS
+    return true;
+#else
+    return false;
+#endif
+}
@@ -30,11 +30,21 @@
   @brief Simple reference count implementation.
 
   Reference counting helps to keep track of elements and avoid unnecessary duplication.
+  The count is updated atomically, so the holders of a shared data structure can
+  attach and detach from different threads (each holder itself is still only
+  safe to use from one thread at a time).
+
   In C we need to manually keep track of the users, while in C++ this is implicitly done
-  by the "this" pointer. If we don't do that and we just count how many users we have,
-  we risk multiples attach or detach. We need one way to find out who is connected to
-  the refcount so we can act properly.
+  by the "this" pointer. If we just count how many users we have, we risk multiple
+  attach or detach. When libutils is built with owner tracking (the default in debug
+  builds, REFCOUNT_NO_OWNER_TRACKING turns it off) every RefCount also keeps a list of
+  its owners, so that detaching an owner which is not attached is caught. This makes
+  attaching and detaching O(number of owners) and serialized by a mutex, so release
+  builds only keep the counter. The layout of the structure is the same either way,
+  only the library decides whether the owner fields are used.
   */
+#include <pthread.h>
+
 struct RefCountNode {
     struct RefCountNode *next;
     struct RefCountNode *previous;
@@ -43,8 +53,10 @@ struct RefCountNode {
 typedef struct RefCountNode RefCountNode;
 
 struct RefCount {
-    // Normally one unless we are shared.
+    // Normally one unless we are shared, only accessed atomically.
     unsigned int user_count;
+    // The owners, only used with owner tracking.
+    pthread_mutex_t lock;
     RefCountNode *users;
     RefCountNode *last;
 };
@@ -75,8 +87,11 @@ void RefCountAttach(RefCount *ref, void *owner);
   to undesired side effects.
   @param ref RefCountr structure
   @param owner Data structure to be detached.
+  @return False if owner was not detached because it is the only user left,
+  in which case it owns the data structure and is responsible for destroying it
+  (another user may have detached concurrently since RefCountIsShared() was checked).
   */
-void RefCountDetach(RefCount *ref, void *owner);
+bool RefCountDetach(RefCount *ref, void *owner);
 /**
   @brief Simple check to see if a given data structure is shared.
   @param ref RefCount structure.
@@ -93,5 +108,9 @@ bool RefCountIsShared(RefCount *ref);
   then most likely the structures are the same.
   */
 bool RefCountIsEqual(RefCount *a, RefCount *b);
+/**
+  @brief Whether the library keeps the list of owners of RefCounts.
+  */
+bool RefCountTracksOwners(void);
 
 #endif // CFENGINE_REFCOUNT_H
@@ -0,0 +1,161 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <segmented_sequence.h>
+#include <alloc.h>
+
+SegSeq *SegSeqNew(void (*ItemDestroy) (void *item))
+{
+    SegSeq *seq = xcalloc(1, sizeof(SegSeq));
+    seq->ItemDestroy = ItemDestroy;
+    return seq;
+}
+
+static void DestroyItems(SegSeq *seq)
+{
+    if (seq->ItemDestroy != NULL)
+    {
+        for (size_t i = 0; i < seq->length; i++)
+        {
+            seq->ItemDestroy(SegSeqAt(seq, i));
+        }
+    }
+}
+
+/* Free all the blocks from the given one on */
+static void FreeBlocks(SegSeq *seq, size_t from_block)
+{
+    for (size_t i = from_block; i < seq->n_blocks; i++)
+    {
+        free(seq->blocks[i]);
+    }
+    seq->n_blocks = MIN(seq->n_blocks, from_block);
+}
+
+void SegSeqSoftDestroy(SegSeq *seq)
+{
+    if (seq != NULL)
+    {
+        FreeBlocks(seq, 0);
+        free(seq->blocks);
+        free(seq);
+    }
+}
+
+void SegSeqDestroy(SegSeq *seq)
+{
+    if (seq != NULL)
+    {
+        DestroyItems(seq);
+        SegSeqSoftDestroy(seq);
+    }
+}
+
+void SegSeqSet(SegSeq *seq, size_t i, void *item)
+{
+    void **slot = SegSeqSlot(seq, i);
+    if (seq->ItemDestroy != NULL)
+    {
+        seq->ItemDestroy(*slot);
+    }
+    *slot = item;
+}
+
+void **SegSeqAppend(SegSeq *seq, void *item)
+{
+    assert(seq != NULL);
+
+    const size_t block = seq->length >> SEG_SEQ_BLOCK_SHIFT;
+    if (block == seq->n_blocks)
+    {
+        if (seq->n_blocks == seq->directory_capacity)
+        {
+            /* Only the directory is reallocated, never the blocks */
+            seq->directory_capacity = MAX(2 * seq->directory_capacity, 4);
+            seq->blocks = xrealloc(seq->blocks,
+                                   seq->directory_capacity * sizeof(void **));
+        }
+        seq->blocks[seq->n_blocks++] = xmalloc(SEG_SEQ_BLOCK_SIZE * sizeof(void *));
+    }
+
+    void **slot = &seq->blocks[block][seq->length & SEG_SEQ_BLOCK_MASK];
+    *slot = item;
+    seq->length++;
+    return slot;
+}
+
+void *SegSeqPop(SegSeq *seq)
+{
+    assert(seq != NULL);
+
+    if (seq->length == 0)
+    {
+        return NULL;
+    }
+
+    void *item = SegSeqAt(seq, seq->length - 1);
+    seq->length--;
+
+    /* Keep one spare block, so that alternating appends and pops at a
+     * block boundary don't free and allocate it over and over */
+    const size_t used_blocks =
+        (seq->length + SEG_SEQ_BLOCK_MASK) >> SEG_SEQ_BLOCK_SHIFT;
+    if (seq->n_blocks > used_blocks + 1)
+    {
+        FreeBlocks(seq, used_blocks + 1);
+    }
+    return item;
+}
+
+void SegSeqClear(SegSeq *seq)
+{
+    assert(seq != NULL);
+
+    DestroyItems(seq);
+    FreeBlocks(seq, 1);
+    seq->length = 0;
+}
+
+Seq *SegSeqToSeq(SegSeq *seq)
+{
+    assert(seq != NULL);
+
+    const size_t length = seq->length;
+    Seq *result = SeqNew(length, seq->ItemDestroy);
+
+    size_t copied = 0;
+    for (size_t block = 0; copied < length; block++)
+    {
+        const size_t n = MIN(length - copied, SEG_SEQ_BLOCK_SIZE);
+        memcpy(result->data + copied, seq->blocks[block], n * sizeof(void *));
+        copied += n;
+    }
+    result->length = length;
+
+    /* The items belong to the new sequence now */
+    seq->length = 0;
+    FreeBlocks(seq, 1);
+
+    return result;
+}
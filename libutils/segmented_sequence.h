@@ -0,0 +1,123 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_SEGMENTED_SEQUENCE_H
+#define CFENGINE_SEGMENTED_SEQUENCE_H
+
+#include <stddef.h>     // size_t
+#include <assert.h>
+#include <sequence.h>   // Seq
+
+/*
+ * Segmented sequence, a Seq variant for collecting very many items.
+ *
+ * Items are stored in fixed-size blocks found through a small directory, so
+ * growing never copies the items (only the directory, 1/1024 of their size)
+ * and the address of an item slot never changes for the life of the
+ * sequence. Indexing is a shift and a mask, still O(1).
+ *
+ * Use it instead of Seq when appending a lot, e.g. streaming collection,
+ * where Seq's doubling realloc would copy all the items and temporarily need
+ * twice the memory. SegSeqToSeq() hands the result over to Seq based APIs.
+ */
+
+#define SEG_SEQ_BLOCK_SHIFT 10
+#define SEG_SEQ_BLOCK_SIZE  ((size_t) 1 << SEG_SEQ_BLOCK_SHIFT)
+#define SEG_SEQ_BLOCK_MASK  (SEG_SEQ_BLOCK_SIZE - 1)
+
+typedef struct
+{
+    void ***blocks;             /* directory of blocks of SEG_SEQ_BLOCK_SIZE items */
+    size_t n_blocks;            /* allocated blocks */
+    size_t directory_capacity;
+    size_t length;
+    void (*ItemDestroy) (void *item);
+} SegSeq;
+
+/**
+  @brief Create a new segmented Sequence
+  @param [in] ItemDestroy Optional item destructor to clean up memory when needed.
+  */
+SegSeq *SegSeqNew(void (*ItemDestroy) (void *item));
+
+/**
+  @brief Destroy the Sequence and its items.
+  */
+void SegSeqDestroy(SegSeq *seq);
+
+/**
+  @brief Destroy the Sequence without destroying its items.
+  */
+void SegSeqSoftDestroy(SegSeq *seq);
+
+static inline size_t SegSeqLength(const SegSeq *seq)
+{
+    assert(seq != NULL);
+    return seq->length;
+}
+
+/**
+  @brief Address of the slot holding item at the given index.
+  @note  The address stays valid until the item is removed or the Sequence is destroyed.
+  */
+static inline void **SegSeqSlot(const SegSeq *seq, size_t i)
+{
+    assert(seq != NULL);
+    assert(i < seq->length);
+    return &seq->blocks[i >> SEG_SEQ_BLOCK_SHIFT][i & SEG_SEQ_BLOCK_MASK];
+}
+
+static inline void *SegSeqAt(const SegSeq *seq, size_t i)
+{
+    return *SegSeqSlot(seq, i);
+}
+
+/**
+  @brief Replace the item at the given index, the old one is destroyed.
+  */
+void SegSeqSet(SegSeq *seq, size_t i, void *item);
+
+/**
+  @brief Append an item.
+  @return The slot the item was stored in.
+  */
+void **SegSeqAppend(SegSeq *seq, void *item);
+
+/**
+  @brief Remove the last item and return it, without destroying it.
+  @return The removed item, NULL if the Sequence is empty.
+  */
+void *SegSeqPop(SegSeq *seq);
+
+/**
+  @brief Destroy all the items, keeping the first block for reuse.
+  */
+void SegSeqClear(SegSeq *seq);
+
+/**
+  @brief Create a Seq with the items, which then belong to it.
+  @note  The segmented Sequence is left empty. Needs one allocation of exactly SegSeqLength() pointers.
+  */
+Seq *SegSeqToSeq(SegSeq *seq);
+
+#endif
@@ -254,44 +254,478 @@ static void Swap(void **l, void **r)
     *r = t;
 }
 
-// adopted from http://rosettacode.org/wiki/Sorting_algorithms/Quicksort#C
-static void QuickSortRecursive(void **data, int n, SeqItemComparator Compare, void *user_data, size_t maxterm)
+/*
+ * SeqSort() is a pattern-defeating quicksort (pdqsort, Orson Peters):
+ *
+ *  - insertion sort for small ranges
+ *  - median of 3 (or pseudomedian of 9 for big ranges) pivot
+ *  - runs of elements equal to the previous pivot are put aside in linear
+ *    time, so inputs with many duplicates are fast
+ *  - already partitioned ranges get a bounded insertion sort first, making
+ *    sorted and nearly sorted input O(n)
+ *  - unbalanced partitions shuffle a few elements to break patterns and, if
+ *    that keeps happening, the range is heapsorted, so the worst case is
+ *    O(n log n)
+ *  - the smaller side is sorted recursively and the bigger one in a loop,
+ *    so the stack depth is O(log n)
+ */
+
+#define SORT_INSERTION_THRESHOLD 24
+#define SORT_NINTHER_THRESHOLD 128
+#define SORT_PARTIAL_INSERTION_LIMIT 8
+
+typedef struct
+{
+    SeqItemComparator Compare;
+    void *user_data;
+} SortContext;
+
+static inline bool SortLess(const SortContext *ctx, const void *a, const void *b)
+{
+    return ctx->Compare(a, b, ctx->user_data) < 0;
+}
+
+static void InsertionSort(void **begin, void **end, const SortContext *ctx)
 {
-    if (n < 2)
+    if (begin == end)
     {
         return;
     }
 
-    void *pivot = data[n / 2];
-    void **l = data;
-    void **r = data + n - 1;
+    for (void **cur = begin + 1; cur != end; cur++)
+    {
+        void **sift = cur;
+        void **sift_1 = cur - 1;
+        if (SortLess(ctx, *sift, *sift_1))
+        {
+            void *tmp = *sift;
+            do
+            {
+                *sift-- = *sift_1;
+            } while (sift != begin && SortLess(ctx, tmp, *--sift_1));
+            *sift = tmp;
+        }
+    }
+}
+
+/* The element before begin must not be greater than any in [begin, end) */
+static void UnguardedInsertionSort(void **begin, void **end, const SortContext *ctx)
+{
+    if (begin == end)
+    {
+        return;
+    }
+
+    for (void **cur = begin + 1; cur != end; cur++)
+    {
+        void **sift = cur;
+        void **sift_1 = cur - 1;
+        if (SortLess(ctx, *sift, *sift_1))
+        {
+            void *tmp = *sift;
+            do
+            {
+                *sift-- = *sift_1;
+            } while (SortLess(ctx, tmp, *--sift_1));
+            *sift = tmp;
+        }
+    }
+}
+
+/**
+ * Insertion sort giving up after moving SORT_PARTIAL_INSERTION_LIMIT
+ * elements.
+ *
+ * @return true if the range got sorted
+ */
+static bool PartialInsertionSort(void **begin, void **end, const SortContext *ctx)
+{
+    if (begin == end)
+    {
+        return true;
+    }
+
+    size_t limit = 0;
+    for (void **cur = begin + 1; cur != end; cur++)
+    {
+        void **sift = cur;
+        void **sift_1 = cur - 1;
+        if (SortLess(ctx, *sift, *sift_1))
+        {
+            void *tmp = *sift;
+            do
+            {
+                *sift-- = *sift_1;
+            } while (sift != begin && SortLess(ctx, tmp, *--sift_1));
+            *sift = tmp;
+            limit += cur - sift;
+        }
+
+        if (limit > SORT_PARTIAL_INSERTION_LIMIT)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void SiftDown(void **data, size_t root, size_t n, const SortContext *ctx)
+{
+    void *item = data[root];
+    for (;;)
+    {
+        size_t child = 2 * root + 1;
+        if (child >= n)
+        {
+            break;
+        }
+        if (child + 1 < n && SortLess(ctx, data[child], data[child + 1]))
+        {
+            child++;
+        }
+        if (!SortLess(ctx, item, data[child]))
+        {
+            break;
+        }
+        data[root] = data[child];
+        root = child;
+    }
+    data[root] = item;
+}
+
+static void HeapSort(void **begin, void **end, const SortContext *ctx)
+{
+    size_t n = end - begin;
+    for (size_t i = n / 2; i > 0; i--)
+    {
+        SiftDown(begin, i - 1, n, ctx);
+    }
+    for (size_t i = n - 1; i > 0; i--)
+    {
+        Swap(&begin[0], &begin[i]);
+        SiftDown(begin, 0, i, ctx);
+    }
+}
+
+static void Sort2(void **a, void **b, const SortContext *ctx)
+{
+    if (SortLess(ctx, *b, *a))
+    {
+        Swap(a, b);
+    }
+}
+
+static void Sort3(void **a, void **b, void **c, const SortContext *ctx)
+{
+    Sort2(a, b, ctx);
+    Sort2(b, c, ctx);
+    Sort2(a, b, ctx);
+}
+
+/**
+ * Partition [begin, end) around the pivot *begin, elements equal to the pivot
+ * go to the right.
+ *
+ * @param already_partitioned set if no elements had to be swapped
+ * @return the final position of the pivot
+ */
+static void **PartitionRight(void **begin, void **end, const SortContext *ctx,
+                             bool *already_partitioned)
+{
+    void *pivot = *begin;
+    void **first = begin;
+    void **last = end;
+
+    /* The median of 3 selection guarantees there is an element not less than
+     * the pivot to stop the first scan. */
+    while (SortLess(ctx, *++first, pivot))
+    {
+    }
+
+    if (first - 1 == begin)
+    {
+        while (first < last && !SortLess(ctx, *--last, pivot))
+        {
+        }
+    }
+    else
+    {
+        while (!SortLess(ctx, *--last, pivot))
+        {
+        }
+    }
+
+    *already_partitioned = (first >= last);
+
+    while (first < last)
+    {
+        Swap(first, last);
+        while (SortLess(ctx, *++first, pivot))
+        {
+        }
+        while (!SortLess(ctx, *--last, pivot))
+        {
+        }
+    }
+
+    void **pivot_pos = first - 1;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    return pivot_pos;
+}
+
+/**
+ * Partition [begin, end) around the pivot *begin, elements equal to the pivot
+ * go to the left. Used when the pivot equals the previous one, so all the
+ * elements on the left are equal and need no further sorting.
+ *
+ * @return the final position of the pivot
+ */
+static void **PartitionLeft(void **begin, void **end, const SortContext *ctx)
+{
+    void *pivot = *begin;
+    void **first = begin;
+    void **last = end;
+
+    while (SortLess(ctx, pivot, *--last))
+    {
+    }
+
+    if (last + 1 == end)
+    {
+        while (first < last && !SortLess(ctx, pivot, *++first))
+        {
+        }
+    }
+    else
+    {
+        while (!SortLess(ctx, pivot, *++first))
+        {
+        }
+    }
 
-    while (l <= r)
+    while (first < last)
     {
-        while (Compare(*l, pivot, user_data) < 0)
+        Swap(first, last);
+        while (SortLess(ctx, pivot, *--last))
         {
-            ++l;
         }
-        while (Compare(*r, pivot, user_data) > 0)
+        while (!SortLess(ctx, pivot, *++first))
         {
-            --r;
         }
-        if (l <= r)
+    }
+
+    void **pivot_pos = last;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    return pivot_pos;
+}
+
+/* Swap a few elements of an unbalanced partition to break up patterns */
+static void BreakPatterns(void **begin, void **end)
+{
+    const size_t size = end - begin;
+    if (size >= SORT_INSERTION_THRESHOLD)
+    {
+        const size_t q = size / 4;
+        Swap(begin, begin + q);
+        Swap(end - 1, end - q);
+        if (size > SORT_NINTHER_THRESHOLD)
         {
-            Swap(l, r);
-            ++l;
-            --r;
+            Swap(begin + 1, begin + (q + 1));
+            Swap(begin + 2, begin + (q + 2));
+            Swap(end - 2, end - (q + 1));
+            Swap(end - 3, end - (q + 2));
         }
     }
+}
+
+/**
+ * @param bad_allowed number of unbalanced partitions left before switching to
+ *                    heapsort
+ * @param leftmost whether begin is the start of the whole array, otherwise
+ *                 the element before begin is not greater than any in
+ *                 [begin, end)
+ */
+static void PatternDefeatingQuickSort(void **begin, void **end,
+                                      const SortContext *ctx,
+                                      int bad_allowed, bool leftmost)
+{
+    for (;;)
+    {
+        const size_t size = end - begin;
+
+        if (size < SORT_INSERTION_THRESHOLD)
+        {
+            if (leftmost)
+            {
+                InsertionSort(begin, end, ctx);
+            }
+            else
+            {
+                UnguardedInsertionSort(begin, end, ctx);
+            }
+            return;
+        }
+
+        /* Move the chosen pivot to begin */
+        const size_t s2 = size / 2;
+        if (size > SORT_NINTHER_THRESHOLD)
+        {
+            Sort3(begin, begin + s2, end - 1, ctx);
+            Sort3(begin + 1, begin + (s2 - 1), end - 2, ctx);
+            Sort3(begin + 2, begin + (s2 + 1), end - 3, ctx);
+            Sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), ctx);
+            Swap(begin, begin + s2);
+        }
+        else
+        {
+            Sort3(begin + s2, begin, end - 1, ctx);
+        }
+
+        /* Pivot equal to the previous one (the element before begin), so
+         * there are no smaller elements in this range. Skip the equal ones. */
+        if (!leftmost && !SortLess(ctx, *(begin - 1), *begin))
+        {
+            begin = PartitionLeft(begin, end, ctx) + 1;
+            continue;
+        }
+
+        bool already_partitioned;
+        void **pivot_pos = PartitionRight(begin, end, ctx, &already_partitioned);
 
-    QuickSortRecursive(data, r - data + 1, Compare, user_data, maxterm + 1);
-    QuickSortRecursive(l, data + n - l, Compare, user_data, maxterm + 1);
+        const size_t l_size = pivot_pos - begin;
+        const size_t r_size = end - (pivot_pos + 1);
+        if (l_size < size / 8 || r_size < size / 8)
+        {
+            if (--bad_allowed == 0)
+            {
+                HeapSort(begin, end, ctx);
+                return;
+            }
+            BreakPatterns(begin, pivot_pos);
+            BreakPatterns(pivot_pos + 1, end);
+        }
+        else if (already_partitioned &&
+                 PartialInsertionSort(begin, pivot_pos, ctx) &&
+                 PartialInsertionSort(pivot_pos + 1, end, ctx))
+        {
+            return;
+        }
+
+        /* Recurse into the smaller side, keeping the stack shallow */
+        if (l_size < r_size)
+        {
+            PatternDefeatingQuickSort(begin, pivot_pos, ctx, bad_allowed, leftmost);
+            begin = pivot_pos + 1;
+            leftmost = false;
+        }
+        else
+        {
+            PatternDefeatingQuickSort(pivot_pos + 1, end, ctx, bad_allowed, false);
+            end = pivot_pos;
+        }
+    }
+}
+
+static void QuickSort(void **begin, void **end, const SortContext *ctx)
+{
+    int log2_length = 0;
+    for (size_t n = end - begin; n > 1; n >>= 1)
+    {
+        log2_length++;
+    }
+
+    PatternDefeatingQuickSort(begin, end, ctx, log2_length, true);
 }
 
 void SeqSort(Seq *seq, SeqItemComparator Compare, void *user_data)
 {
     assert(seq != NULL);
-    QuickSortRecursive(seq->data, seq->length, Compare, user_data, 0);
+
+    const size_t length = seq->length;
+    if (length < 2)
+    {
+        return;
+    }
+
+    const SortContext ctx = { Compare, user_data };
+    QuickSort(seq->data, seq->data + length, &ctx);
+}
+
+/* Runs sorted by insertion sort before merging, stable since it only moves
+ * strictly smaller elements. */
+#define STABLE_SORT_RUN 16
+
+static void MergeRuns(void *const *left, size_t n_left,
+                      void *const *right, size_t n_right,
+                      void **dst, const SortContext *ctx)
+{
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < n_left && j < n_right)
+    {
+        /* Take from the right run only if strictly smaller, keeps equal
+         * elements in their original order. */
+        if (SortLess(ctx, right[j], left[i]))
+        {
+            *dst++ = right[j++];
+        }
+        else
+        {
+            *dst++ = left[i++];
+        }
+    }
+    memcpy(dst, left + i, (n_left - i) * sizeof(void *));
+    dst += n_left - i;
+    memcpy(dst, right + j, (n_right - j) * sizeof(void *));
+}
+
+void SeqStableSort(Seq *seq, SeqItemComparator Compare, void *user_data)
+{
+    assert(seq != NULL);
+
+    const size_t length = seq->length;
+    if (length < 2)
+    {
+        return;
+    }
+
+    const SortContext ctx = { Compare, user_data };
+    for (size_t start = 0; start < length; start += STABLE_SORT_RUN)
+    {
+        const size_t end = MIN(start + STABLE_SORT_RUN, length);
+        InsertionSort(seq->data + start, seq->data + end, &ctx);
+    }
+    if (length <= STABLE_SORT_RUN)
+    {
+        return;
+    }
+
+    /* Bottom-up merging, alternating between the data and a buffer */
+    void **src = seq->data;
+    void **dst = xmalloc(length * sizeof(void *));
+    void **buffer = dst;
+    for (size_t width = STABLE_SORT_RUN; width < length; width *= 2)
+    {
+        for (size_t start = 0; start < length; start += 2 * width)
+        {
+            const size_t middle = MIN(start + width, length);
+            const size_t end = MIN(start + 2 * width, length);
+            MergeRuns(src + start, middle - start, src + middle, end - middle,
+                      dst + start, &ctx);
+        }
+        void **tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != seq->data)
+    {
+        memcpy(seq->data, src, length * sizeof(void *));
+    }
+    free(buffer);
 }
 
 Seq *SeqSoftSort(const Seq *seq, SeqItemComparator compare, void *user_data)
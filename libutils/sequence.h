@@ -202,11 +202,20 @@ void SeqRemove(Seq *seq, size_t index);
 
 /**
   @brief Sort a Sequence according to the given item comparator function
+  @note Not stable. O(n log n) in the worst case, O(n) for sorted input.
   @param compare [in] The comparator function used for sorting.
   @param user_data [in] Pointer passed to the comparator function
   */
 void SeqSort(Seq *seq, SeqItemComparator compare, void *user_data);
 
+/**
+  @brief Same as SeqSort(), but items comparing equal keep their relative order
+  @note Merge sort, allocates a temporary array of SeqLength(seq) pointers.
+  @param compare [in] The comparator function used for sorting.
+  @param user_data [in] Pointer passed to the comparator function
+  */
+void SeqStableSort(Seq *seq, SeqItemComparator compare, void *user_data);
+
 /**
   @brief Returns a soft copy of the sequence sorted according to the given item comparator function.
   @param compare [in] The comparator function used for sorting.
@@ -0,0 +1,146 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <sequence_uniq.h>
+#include <alloc.h>
+#include <map.h>
+
+static int ComparePointers(const void *a, const void *b)
+{
+    const uintptr_t x = (uintptr_t) *(void *const *) a;
+    const uintptr_t y = (uintptr_t) *(void *const *) b;
+    return (x > y) - (x < y);
+}
+
+void SeqUniq(Seq *seq, MapHashFn hash, MapKeyEqualFn equal)
+{
+    assert(seq != NULL);
+    assert(hash != NULL);
+    assert(equal != NULL);
+
+    const size_t length = seq->length;
+    Map *seen = MapNewWithCapacity(hash, equal, NULL, NULL, length);
+
+    /* Swap the kept items to the front, in their original order, and
+     * collect the removed ones behind them */
+    size_t to = 0;
+    for (size_t from = 0; from < length; from++)
+    {
+        void *item = seq->data[from];
+        void *first = MapGet(seen, item);
+        if (first == NULL)
+        {
+            MapInsert(seen, item, item);
+            seq->data[from] = seq->data[to];
+            seq->data[to++] = item;
+        }
+        else if (first == item)
+        {
+            /* Another occurrence of a kept pointer, it must stay alive */
+            seq->data[from] = NULL;
+        }
+    }
+    MapSoftDestroy(seen);
+
+    if (seq->ItemDestroy != NULL)
+    {
+        /* The same removed pointer may be there several times, sort them
+         * to destroy each only once */
+        void **removed = seq->data + to;
+        const size_t n_removed = length - to;
+        qsort(removed, n_removed, sizeof(void *), ComparePointers);
+        for (size_t i = 0; i < n_removed; i++)
+        {
+            if (removed[i] != NULL && (i == 0 || removed[i] != removed[i - 1]))
+            {
+                seq->ItemDestroy(removed[i]);
+            }
+        }
+    }
+    seq->length = to;
+}
+
+struct SeqHashIndex_
+{
+    /* item -> item, to tell an equal item from the very same one */
+    Map *items;
+};
+
+SeqHashIndex *SeqHashIndexNew(const Seq *seq, MapHashFn hash, MapKeyEqualFn equal)
+{
+    assert(seq != NULL);
+    assert(hash != NULL);
+    assert(equal != NULL);
+
+    SeqHashIndex *index = xmalloc(sizeof(SeqHashIndex));
+    index->items = MapNewWithCapacity(hash, equal, NULL, NULL, seq->length);
+
+    for (size_t i = 0; i < seq->length; i++)
+    {
+        void *item = seq->data[i];
+        if (!MapHasKey(index->items, item))
+        {
+            MapInsert(index->items, item, item);
+        }
+    }
+
+    return index;
+}
+
+void SeqHashIndexDestroy(SeqHashIndex *index)
+{
+    if (index != NULL)
+    {
+        MapSoftDestroy(index->items);
+        free(index);
+    }
+}
+
+bool SeqAppendOnceIndexed(Seq *seq, SeqHashIndex *index, void *item)
+{
+    assert(seq != NULL);
+    assert(index != NULL);
+    assert(item != NULL);
+
+    void *present = MapGet(index->items, item);
+    if (present == NULL)
+    {
+        MapInsert(index->items, item, item);
+        SeqAppend(seq, item);
+        return true;
+    }
+
+    /* swallow the item anyway */
+    if (present != item && seq->ItemDestroy != NULL)
+    {
+        seq->ItemDestroy(item);
+    }
+    return false;
+}
+
+bool SeqHashIndexContains(const SeqHashIndex *index, const void *item)
+{
+    assert(index != NULL);
+    return MapHasKey(index->items, item);
+}
@@ -0,0 +1,76 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_SEQUENCE_UNIQ_H
+#define CFENGINE_SEQUENCE_UNIQ_H
+
+#include <sequence.h>
+#include <map_common.h> // MapHashFn, MapKeyEqualFn
+
+/* Hash based helpers for Sequences of unique items, kept apart from
+ * sequence.h so that the Sequence itself does not depend on Map. */
+
+/**
+  @brief Remove duplicate items from the Sequence, keeping the first occurrence of each.
+  @note  Uses a temporary hash table, so it is O(n) unlike repeated SeqAppendOnce() calls. The order of the
+         remaining items is preserved, the removed ones are passed to the item destructor
+         (once each, even if the same pointer was in the Sequence several times).
+  @param seq [in] The Sequence to remove duplicates from, must not contain NULL items.
+  @param hash [in] Hash function of the items.
+  @param equal [in] Equality function of the items, consistent with hash.
+  */
+void SeqUniq(Seq *seq, MapHashFn hash, MapKeyEqualFn equal);
+
+/**
+  @brief Hash index of the items of a Sequence, for unique appends in amortized O(1).
+
+  The index is only valid as long as all the items are added to the Sequence with SeqAppendOnceIndexed() and none
+  are removed or replaced. It does not own the items.
+
+      SeqHashIndex *index = SeqHashIndexNew(seq, StringHash_untyped, StringEqual_untyped);
+      SeqAppendOnceIndexed(seq, index, xstrdup("foo"));
+      ...
+      SeqHashIndexDestroy(index);
+  */
+typedef struct SeqHashIndex_ SeqHashIndex;
+
+/**
+  @brief Create an index of the current items of the Sequence.
+  @note  Duplicates already in the Sequence are left there, only the first one is indexed.
+  */
+SeqHashIndex *SeqHashIndexNew(const Seq *seq, MapHashFn hash, MapKeyEqualFn equal);
+void SeqHashIndexDestroy(SeqHashIndex *index);
+
+/**
+  @brief Same as SeqAppendOnce(), but looks the item up in the index instead of searching the Sequence.
+  @param item [in] The item to append, must not be NULL. It is passed to the item destructor if already present.
+  @return true if the item was appended, false if it was already present.
+  */
+bool SeqAppendOnceIndexed(Seq *seq, SeqHashIndex *index, void *item);
+
+/**
+  @brief Check whether an item equal to the given one is in the indexed Sequence.
+  */
+bool SeqHashIndexContains(const SeqHashIndex *index, const void *item);
+
+#endif
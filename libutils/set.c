@@ -44,6 +44,12 @@ void SetDestroy(Set *set)
     MapDestroy(set);
 }
 
+void SetReserve(Set *set, size_t capacity)
+{
+    assert(set != NULL);
+    MapReserve(set, capacity);
+}
+
 void SetAdd(Set *set, void *element)
 {
     assert(set != NULL);
@@ -113,6 +119,174 @@ void SetJoin(Set *set, Set *otherset, SetElementCopyFn copy_function)
     }
 }
 
+static void SetAddCopy(Set *set, void *element, SetElementCopyFn copy_function)
+{
+    SetAdd(set, (copy_function != NULL) ? copy_function(element) : element);
+}
+
+/* Add elements of iterated that are (or are not) in lookup to result. */
+static void SetAddFiltered(Set *result, const Set *iterated, const Set *lookup,
+                           bool contained, SetElementCopyFn copy_function)
+{
+    SetIterator si = SetIteratorInit((Set *) iterated);
+    void *ptr;
+    while ((ptr = SetIteratorNext(&si)) != NULL)
+    {
+        if (SetContains(lookup, ptr) == contained)
+        {
+            SetAddCopy(result, ptr, copy_function);
+        }
+    }
+}
+
+void SetIntersect(Set *result, const Set *set1, const Set *set2,
+                  SetElementCopyFn copy_function)
+{
+    assert(result != NULL);
+    assert(set1 != NULL);
+    assert(set2 != NULL);
+    assert(result != set1 && result != set2);
+
+    if (SetSize(set1) <= SetSize(set2))
+    {
+        SetAddFiltered(result, set1, set2, true, copy_function);
+    }
+    else
+    {
+        SetAddFiltered(result, set2, set1, true, copy_function);
+    }
+}
+
+void SetDifference(Set *result, const Set *set1, const Set *set2,
+                   SetElementCopyFn copy_function)
+{
+    assert(result != NULL);
+    assert(set1 != NULL);
+    assert(set2 != NULL);
+    assert(result != set1 && result != set2);
+
+    /* Every element of set1 is a candidate, no way around iterating it. */
+    SetAddFiltered(result, set1, set2, false, copy_function);
+}
+
+void SetSymmetricDifference(Set *result, const Set *set1, const Set *set2,
+                            SetElementCopyFn copy_function)
+{
+    assert(result != NULL);
+    assert(set1 != NULL);
+    assert(set2 != NULL);
+    assert(result != set1 && result != set2);
+
+    SetAddFiltered(result, set1, set2, false, copy_function);
+    SetAddFiltered(result, set2, set1, false, copy_function);
+}
+
+/* Remove the elements of set that are (or are not) in otherset. Elements to
+ * remove are collected first, removing while iterating is not safe. */
+static void SetRemoveFiltered(Set *set, const Set *otherset, bool contained)
+{
+    void **to_remove = xmalloc(SetSize(set) * sizeof(void *));
+    size_t n = 0;
+
+    SetIterator si = SetIteratorInit(set);
+    void *ptr;
+    while ((ptr = SetIteratorNext(&si)) != NULL)
+    {
+        if (SetContains(otherset, ptr) == contained)
+        {
+            to_remove[n++] = ptr;
+        }
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        SetRemove(set, to_remove[i]);
+    }
+    free(to_remove);
+}
+
+void SetIntersectInPlace(Set *set, const Set *otherset)
+{
+    assert(set != NULL);
+    assert(otherset != NULL);
+    if (set == otherset)
+    {
+        return;
+    }
+
+    /* Every element of set has to be checked, it may need to go. */
+    SetRemoveFiltered(set, otherset, false);
+}
+
+void SetDifferenceInPlace(Set *set, const Set *otherset)
+{
+    assert(set != NULL);
+    assert(otherset != NULL);
+    if (set == otherset)
+    {
+        SetClear(set);
+        return;
+    }
+
+    if (SetSize(otherset) < SetSize(set))
+    {
+        SetIterator si = SetIteratorInit((Set *) otherset);
+        void *ptr;
+        while ((ptr = SetIteratorNext(&si)) != NULL)
+        {
+            SetRemove(set, ptr);
+        }
+    }
+    else
+    {
+        SetRemoveFiltered(set, otherset, true);
+    }
+}
+
+void SetSymmetricDifferenceInPlace(Set *set, const Set *otherset,
+                                   SetElementCopyFn copy_function)
+{
+    assert(set != NULL);
+    assert(otherset != NULL);
+    if (set == otherset)
+    {
+        SetClear(set);
+        return;
+    }
+
+    SetIterator si = SetIteratorInit((Set *) otherset);
+    void *ptr;
+    while ((ptr = SetIteratorNext(&si)) != NULL)
+    {
+        if (!SetRemove(set, ptr))
+        {
+            SetAddCopy(set, ptr, copy_function);
+        }
+    }
+}
+
+bool SetIsSubset(const Set *set, const Set *otherset)
+{
+    assert(set != NULL);
+    assert(otherset != NULL);
+
+    if (SetSize(set) > SetSize(otherset))
+    {
+        return false;
+    }
+
+    SetIterator si = SetIteratorInit((Set *) set);
+    void *ptr;
+    while ((ptr = SetIteratorNext(&si)) != NULL)
+    {
+        if (!SetContains(otherset, ptr))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 Buffer *StringSetToBuffer(StringSet *set, const char delimiter)
 {
     assert(set != NULL);
@@ -38,6 +38,11 @@ Set *SetNew(MapHashFn element_hash_fn,
             MapDestroyDataFn element_destroy_fn);
 void SetDestroy(Set *set);
 
+/**
+ * Make room for #capacity elements, see MapReserve().
+ */
+void SetReserve(Set *set, size_t capacity);
+
 void SetAdd(Set *set, void *element);
 void SetJoin(Set *set, Set *otherset, SetElementCopyFn copy_function);
 bool SetContains(const Set *set, const void *element);
@@ -47,6 +52,38 @@ size_t SetSize(const Set *set);
 
 bool SetIsEqual(const Set *set1, const Set *set2);
 
+/*
+ * Set algebra. The functions writing into #result add the elements found in
+ * set1/set2 (copied with copy_function, unless it's NULL) to it, so #result
+ * must be created by the caller with suitable hash, equal and destroy
+ * functions. The lookups always go into the bigger of the two sets, i.e. the
+ * smaller one is the one being iterated, wherever the operation allows.
+ */
+
+/* result |= set1 & set2 */
+void SetIntersect(Set *result, const Set *set1, const Set *set2,
+                  SetElementCopyFn copy_function);
+/* result |= set1 - set2 */
+void SetDifference(Set *result, const Set *set1, const Set *set2,
+                   SetElementCopyFn copy_function);
+/* result |= set1 ^ set2 */
+void SetSymmetricDifference(Set *result, const Set *set1, const Set *set2,
+                            SetElementCopyFn copy_function);
+
+/* set &= otherset, removed elements are destroyed */
+void SetIntersectInPlace(Set *set, const Set *otherset);
+/* set -= otherset, removed elements are destroyed */
+void SetDifferenceInPlace(Set *set, const Set *otherset);
+/* set ^= otherset, elements added from otherset are copied with
+ * copy_function (unless it's NULL) */
+void SetSymmetricDifferenceInPlace(Set *set, const Set *otherset,
+                                   SetElementCopyFn copy_function);
+
+/**
+ * Whether all elements of set are also in otherset.
+ */
+bool SetIsSubset(const Set *set, const Set *otherset);
+
 SetIterator SetIteratorInit(Set *set);
 void *SetIteratorNext(SetIterator *i);
 
@@ -60,6 +97,7 @@ void *SetIteratorNext(SetIterator *i);
     typedef SetIterator Prefix##SetIterator;                            \
                                                                         \
     Prefix##Set *Prefix##SetNew(void);                                  \
+    void Prefix##SetReserve(const Prefix##Set *set, size_t capacity);   \
     void Prefix##SetAdd(const Prefix##Set *set, ElementType element);   \
     void Prefix##SetJoin(const Prefix##Set *set, const Prefix##Set *otherset, Prefix##CopyFn copy_function); \
     bool Prefix##SetContains(const Prefix##Set *Set, const ElementType element);  \
@@ -67,6 +105,17 @@ void *SetIteratorNext(SetIterator *i);
     void Prefix##SetClear(Prefix##Set *set);                            \
     size_t Prefix##SetSize(const Prefix##Set *set);                     \
     bool Prefix##SetIsEqual(const Prefix##Set *set1, const Prefix##Set *set2); \
+    void Prefix##SetIntersect(const Prefix##Set *result, const Prefix##Set *set1, \
+                              const Prefix##Set *set2, Prefix##CopyFn copy_function); \
+    void Prefix##SetDifference(const Prefix##Set *result, const Prefix##Set *set1, \
+                               const Prefix##Set *set2, Prefix##CopyFn copy_function); \
+    void Prefix##SetSymmetricDifference(const Prefix##Set *result, const Prefix##Set *set1, \
+                                        const Prefix##Set *set2, Prefix##CopyFn copy_function); \
+    void Prefix##SetIntersectInPlace(const Prefix##Set *set, const Prefix##Set *otherset); \
+    void Prefix##SetDifferenceInPlace(const Prefix##Set *set, const Prefix##Set *otherset); \
+    void Prefix##SetSymmetricDifferenceInPlace(const Prefix##Set *set, const Prefix##Set *otherset, \
+                                               Prefix##CopyFn copy_function); \
+    bool Prefix##SetIsSubset(const Prefix##Set *set, const Prefix##Set *otherset); \
     void Prefix##SetDestroy(Prefix##Set *set);                          \
     Prefix##SetIterator Prefix##SetIteratorInit(Prefix##Set *set);      \
     ElementType Prefix##SetIteratorNext(Prefix##SetIterator *iter);     \
@@ -80,6 +129,11 @@ void *SetIteratorNext(SetIterator *i);
         return set;                                                     \
     }                                                                   \
                                                                         \
+    void Prefix##SetReserve(const Prefix##Set *set, size_t capacity)    \
+    {                                                                   \
+        SetReserve(set->impl, capacity);                                \
+    }                                                                   \
+                                                                        \
     void Prefix##SetAdd(const Prefix##Set *set, ElementType element)    \
     {                                                                   \
         SetAdd(set->impl, (void *)element);                             \
@@ -115,6 +169,49 @@ void *SetIteratorNext(SetIterator *i);
         return SetIsEqual(set1->impl, set2->impl);                      \
     }                                                                   \
                                                                         \
+    void Prefix##SetIntersect(const Prefix##Set *result, const Prefix##Set *set1, \
+                              const Prefix##Set *set2, Prefix##CopyFn copy_function) \
+    {                                                                   \
+        SetIntersect(result->impl, set1->impl, set2->impl,              \
+                     (SetElementCopyFn) copy_function);                 \
+    }                                                                   \
+                                                                        \
+    void Prefix##SetDifference(const Prefix##Set *result, const Prefix##Set *set1, \
+                               const Prefix##Set *set2, Prefix##CopyFn copy_function) \
+    {                                                                   \
+        SetDifference(result->impl, set1->impl, set2->impl,             \
+                      (SetElementCopyFn) copy_function);                \
+    }                                                                   \
+                                                                        \
+    void Prefix##SetSymmetricDifference(const Prefix##Set *result, const Prefix##Set *set1, \
+                                        const Prefix##Set *set2, Prefix##CopyFn copy_function) \
+    {                                                                   \
+        SetSymmetricDifference(result->impl, set1->impl, set2->impl,    \
+                               (SetElementCopyFn) copy_function);       \
+    }                                                                   \
+                                                                        \
+    void Prefix##SetIntersectInPlace(const Prefix##Set *set, const Prefix##Set *otherset) \
+    {                                                                   \
+        SetIntersectInPlace(set->impl, otherset->impl);                 \
+    }                                                                   \
+                                                                        \
+    void Prefix##SetDifferenceInPlace(const Prefix##Set *set, const Prefix##Set *otherset) \
+    {                                                                   \
+        SetDifferenceInPlace(set->impl, otherset->impl);                \
+    }                                                                   \
+                                                                        \
+    void Prefix##SetSymmetricDifferenceInPlace(const Prefix##Set *set, const Prefix##Set *otherset, \
+                                               Prefix##CopyFn copy_function) \
+    {                                                                   \
+        SetSymmetricDifferenceInPlace(set->impl, otherset->impl,        \
+                                      (SetElementCopyFn) copy_function); \
+    }                                                                   \
+                                                                        \
+    bool Prefix##SetIsSubset(const Prefix##Set *set, const Prefix##Set *otherset) \
+    {                                                                   \
+        return SetIsSubset(set->impl, otherset->impl);                  \
+    }                                                                   \
+                                                                        \
     void Prefix##SetDestroy(Prefix##Set *set)                           \
     {                                                                   \
         if (set)                                                        \
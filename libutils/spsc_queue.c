@@ -0,0 +1,310 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <spsc_queue.h>
+#include <alloc.h>
+#include <event_count.h>
+
+#define CACHE_LINE_SIZE 64
+
+/* Yields before going to sleep, see SpinWait() */
+#define SPIN_ATTEMPTS 16
+
+struct SPSCQueue_
+{
+    void **slots;
+    size_t mask;
+    void (*ItemDestroy) (void *item);
+    EventCount not_empty;
+    EventCount not_full;
+
+    /* Producer's cache line */
+    char pad0[CACHE_LINE_SIZE];
+    size_t tail;                /* next position to push to */
+    size_t cached_head;         /* last seen head */
+
+    /* Consumer's cache line */
+    char pad1[CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+    size_t head;                /* next position to pop from */
+    size_t cached_tail;         /* last seen tail */
+    char pad2[CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+};
+
+SPSCQueue *SPSCQueueNew(size_t capacity, void (*ItemDestroy) (void *item))
+{
+    size_t size = 2;
+    while (size < capacity)
+    {
+        size *= 2;
+    }
+
+    SPSCQueue *queue = xcalloc(1, sizeof(SPSCQueue));
+    queue->slots = xmalloc(size * sizeof(void *));
+    queue->mask = size - 1;
+    queue->ItemDestroy = ItemDestroy;
+    EventCountInit(&queue->not_empty);
+    EventCountInit(&queue->not_full);
+
+    return queue;
+}
+
+void SPSCQueueDestroy(SPSCQueue *queue)
+{
+    if (queue != NULL)
+    {
+        if (queue->ItemDestroy != NULL)
+        {
+            for (size_t i = queue->head; i != queue->tail; i++)
+            {
+                queue->ItemDestroy(queue->slots[i & queue->mask]);
+            }
+        }
+
+        EventCountDestroy(&queue->not_empty);
+        EventCountDestroy(&queue->not_full);
+        free(queue->slots);
+        free(queue);
+    }
+}
+
+/* Copy between the ring and an array, n items from the given position */
+static void CopyToRing(SPSCQueue *queue, size_t position,
+                       void *const *items, size_t n)
+{
+    const size_t start = position & queue->mask;
+    const size_t first = MIN(n, queue->mask + 1 - start);
+    memcpy(queue->slots + start, items, first * sizeof(void *));
+    memcpy(queue->slots, items + first, (n - first) * sizeof(void *));
+}
+
+static void CopyFromRing(SPSCQueue *queue, size_t position,
+                         void **items, size_t n)
+{
+    const size_t start = position & queue->mask;
+    const size_t first = MIN(n, queue->mask + 1 - start);
+    memcpy(items, queue->slots + start, first * sizeof(void *));
+    memcpy(items + first, queue->slots, (n - first) * sizeof(void *));
+}
+
+size_t SPSCQueueTryPushN(SPSCQueue *queue, void *const *items, size_t n_items)
+{
+    assert(queue != NULL);
+    assert(items != NULL || n_items == 0);
+
+    const size_t capacity = queue->mask + 1;
+    const size_t tail = queue->tail;
+
+    size_t free_slots = capacity - (tail - queue->cached_head);
+    if (free_slots < n_items)
+    {
+        queue->cached_head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        free_slots = capacity - (tail - queue->cached_head);
+    }
+
+    const size_t n = MIN(n_items, free_slots);
+    if (n > 0)
+    {
+        CopyToRing(queue, tail, items, n);
+        __atomic_store_n(&queue->tail, tail + n, __ATOMIC_RELEASE);
+        EventCountNotifyAll(&queue->not_empty);
+    }
+    return n;
+}
+
+bool SPSCQueueTryPush(SPSCQueue *queue, void *item)
+{
+    assert(queue != NULL);
+
+    const size_t tail = queue->tail;
+    if (tail - queue->cached_head > queue->mask)
+    {
+        queue->cached_head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        if (tail - queue->cached_head > queue->mask)
+        {
+            return false;
+        }
+    }
+
+    queue->slots[tail & queue->mask] = item;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    EventCountNotifyAll(&queue->not_empty);
+    return true;
+}
+
+size_t SPSCQueueTryPopN(SPSCQueue *queue, void **items, size_t max_items)
+{
+    assert(queue != NULL);
+    assert(items != NULL || max_items == 0);
+
+    const size_t head = queue->head;
+
+    size_t available = queue->cached_tail - head;
+    if (available < max_items)
+    {
+        queue->cached_tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+        available = queue->cached_tail - head;
+    }
+
+    const size_t n = MIN(max_items, available);
+    if (n > 0)
+    {
+        CopyFromRing(queue, head, items, n);
+        __atomic_store_n(&queue->head, head + n, __ATOMIC_RELEASE);
+        EventCountNotifyAll(&queue->not_full);
+    }
+    return n;
+}
+
+bool SPSCQueueTryPop(SPSCQueue *queue, void **item)
+{
+    assert(queue != NULL);
+    assert(item != NULL);
+
+    const size_t head = queue->head;
+    if (head == queue->cached_tail)
+    {
+        queue->cached_tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+        if (head == queue->cached_tail)
+        {
+            return false;
+        }
+    }
+
+    *item = queue->slots[head & queue->mask];
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    EventCountNotifyAll(&queue->not_full);
+    return true;
+}
+
+/* Condition the blocking functions wait for */
+typedef bool SPSCQueueReady(const SPSCQueue *queue);
+
+static bool HasItems(const SPSCQueue *queue)
+{
+    return __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) != queue->head;
+}
+
+static bool HasRoom(const SPSCQueue *queue)
+{
+    return queue->tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) <=
+        queue->mask;
+}
+
+/**
+ * Wait until ready() or the deadline, yielding a few times first since the
+ * other thread usually catches up quickly and sleeping costs system calls.
+ *
+ * @return false if timed out
+ */
+static bool SpinWait(SPSCQueue *queue, SPSCQueueReady *ready, EventCount *ec,
+                     const struct timespec *deadline)
+{
+    for (int i = 0; i < SPIN_ATTEMPTS; i++)
+    {
+        sched_yield();
+        if (ready(queue))
+        {
+            return true;
+        }
+    }
+
+    while (!ready(queue))
+    {
+        unsigned long key = EventCountPrepareWait(ec);
+        if (ready(queue))
+        {
+            EventCountCancelWait(ec);
+            return true;
+        }
+        if (!EventCountWait(ec, key, deadline))
+        {
+            return ready(queue);
+        }
+    }
+    return true;
+}
+
+size_t SPSCQueuePushN(SPSCQueue *queue, void *const *items, size_t n_items,
+                      int timeout)
+{
+    size_t pushed = SPSCQueueTryPushN(queue, items, n_items);
+    if (pushed == n_items || timeout == 0)
+    {
+        return pushed;
+    }
+
+    struct timespec deadline_buf;
+    const struct timespec *deadline = EventCountDeadline(&deadline_buf, timeout);
+    while (pushed < n_items &&
+           SpinWait(queue, HasRoom, &queue->not_full, deadline))
+    {
+        pushed += SPSCQueueTryPushN(queue, items + pushed, n_items - pushed);
+    }
+    return pushed;
+}
+
+bool SPSCQueuePush(SPSCQueue *queue, void *item, int timeout)
+{
+    return SPSCQueueTryPush(queue, item) ||
+        SPSCQueuePushN(queue, &item, 1, timeout) == 1;
+}
+
+size_t SPSCQueuePopN(SPSCQueue *queue, void **items, size_t max_items,
+                     int timeout)
+{
+    size_t popped = SPSCQueueTryPopN(queue, items, max_items);
+    if (popped > 0 || max_items == 0 || timeout == 0)
+    {
+        return popped;
+    }
+
+    struct timespec deadline_buf;
+    const struct timespec *deadline = EventCountDeadline(&deadline_buf, timeout);
+    if (!SpinWait(queue, HasItems, &queue->not_empty, deadline))
+    {
+        return 0;
+    }
+    return SPSCQueueTryPopN(queue, items, max_items);
+}
+
+bool SPSCQueuePop(SPSCQueue *queue, void **item, int timeout)
+{
+    return SPSCQueueTryPop(queue, item) ||
+        SPSCQueuePopN(queue, item, 1, timeout) == 1;
+}
+
+size_t SPSCQueueCount(const SPSCQueue *queue)
+{
+    assert(queue != NULL);
+
+    size_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    size_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    return MIN(tail - head, queue->mask + 1);
+}
+
+size_t SPSCQueueCapacity(const SPSCQueue *queue)
+{
+    assert(queue != NULL);
+    return queue->mask + 1;
+}
@@ -0,0 +1,113 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_SPSC_QUEUE_H
+#define CFENGINE_SPSC_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>     // size_t
+
+/*
+ * Bounded wait-free queue for exactly one producer and one consumer thread.
+ *
+ * The producer only writes the tail index and the consumer only the head
+ * index, each in its own cache line together with a cached copy of the other
+ * side's index, so the other side's cache line is only touched when the
+ * queue looks full (producer) or empty (consumer). The N variants move many
+ * items with a single index update.
+ *
+ * The Try variants never block. The others wait, only when the queue is full
+ * or empty, with the same timeouts as ThreadedQueue: seconds or
+ * THREAD_BLOCK_INDEFINITELY.
+ *
+ * @warning Calling the push functions from more than one thread (or the pop
+ *          functions from more than one thread) corrupts the queue, use
+ *          MPMCQueue for that.
+ */
+
+typedef struct SPSCQueue_ SPSCQueue;
+
+/**
+  @brief Create a new queue.
+  @param [in] capacity Maximum number of items, rounded up to a power of 2.
+  @param [in] ItemDestroy Function used to destroy items left in the queue.
+  */
+SPSCQueue *SPSCQueueNew(size_t capacity, void (*ItemDestroy) (void *item));
+
+/**
+  @brief Destroy the queue and the items left in it.
+  @warning Neither the producer nor the consumer may be using the queue.
+  */
+void SPSCQueueDestroy(SPSCQueue *queue);
+
+bool SPSCQueueTryPush(SPSCQueue *queue, void *item);
+
+/**
+  @brief Push as many of the items as fit.
+  @return Number of items pushed, from the start of the array.
+  */
+size_t SPSCQueueTryPushN(SPSCQueue *queue, void *const *items, size_t n_items);
+
+bool SPSCQueueTryPop(SPSCQueue *queue, void **item);
+
+/**
+  @brief Pop up to max_items items into the given array.
+  @return Number of items popped.
+  */
+size_t SPSCQueueTryPopN(SPSCQueue *queue, void **items, size_t max_items);
+
+/**
+  @brief Push an item, waiting while the queue is full.
+  @return true if the item was pushed, false if timed out.
+  */
+bool SPSCQueuePush(SPSCQueue *queue, void *item, int timeout);
+
+/**
+  @brief Push all the items, waiting for room as needed.
+  @return Number of items pushed, less than n_items if timed out.
+  */
+size_t SPSCQueuePushN(SPSCQueue *queue, void *const *items, size_t n_items,
+                      int timeout);
+
+/**
+  @brief Pop an item, waiting while the queue is empty.
+  @return true if an item was popped, false if timed out.
+  */
+bool SPSCQueuePop(SPSCQueue *queue, void **item, int timeout);
+
+/**
+  @brief Pop up to max_items items, waiting while the queue is empty.
+  @return Number of items popped, 0 if timed out.
+  */
+size_t SPSCQueuePopN(SPSCQueue *queue, void **items, size_t max_items,
+                     int timeout);
+
+/**
+  @brief Number of items in the queue.
+  @note Only a snapshot when the other thread uses the queue.
+  */
+size_t SPSCQueueCount(const SPSCQueue *queue);
+
+size_t SPSCQueueCapacity(const SPSCQueue *queue);
+
+#endif
@@ -86,28 +86,128 @@ size_t StringCopy(const char *const from, char *const to, const size_t buf_size)
     */
 }
 
-unsigned int StringHash(const char *str, unsigned int seed)
+/*
+ * String hashing is based on wyhash (https://github.com/wangyi-fudan/wyhash),
+ * which consumes the input 8 bytes at a time (48 bytes per round for long
+ * strings) instead of the single byte per round of Jenkins one-at-a-time.
+ *
+ * The reads are native-endian, so the hash values differ between big and
+ * little endian hosts. They are only meant for in-memory hash tables, never
+ * store them.
+ */
+
+static const uint64_t STRING_HASH_SECRET[4] =
 {
-    assert(str != NULL);
-    unsigned const char *p = (unsigned const char *) str;
-    unsigned int h = seed;
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
 
-    // NULL is not allowed, but we will prevent segfault anyway:
-    size_t len = (str != NULL) ? strlen(str) : 0;
+/* 64x64 -> 128 bit multiplication, folding the two halves together. */
+static inline uint64_t StringHashMix(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t) a * b;
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+    const uint64_t ha = a >> 32, hb = b >> 32;
+    const uint64_t la = (uint32_t) a, lb = (uint32_t) b;
+    const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const uint64_t t = rl + (rm0 << 32);
+    uint64_t c = (t < rl);
+    const uint64_t lo = t + (rm1 << 32);
+    c += (lo < t);
+    const uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
 
-    /* https://en.wikipedia.org/wiki/Jenkins_hash_function#one-at-a-time */
-    for (size_t i = 0; i < len; i++)
+static inline uint64_t StringHashRead64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t StringHashRead32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+unsigned int StringHashN(const char *str, size_t len, unsigned int seed)
+{
+    assert(str != NULL || len == 0);
+    const unsigned char *p = (const unsigned char *) str;
+    const uint64_t *s = STRING_HASH_SECRET;
+    uint64_t h = StringHashMix(seed ^ s[0], s[1]);
+    uint64_t a, b;
+
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            /* Two possibly overlapping 4-byte reads from each end. */
+            const size_t off = (len >> 3) << 2;
+            a = (StringHashRead32(p) << 32) | StringHashRead32(p + off);
+            b = (StringHashRead32(p + len - 4) << 32) |
+                StringHashRead32(p + len - 4 - off);
+        }
+        else if (len > 0)
+        {
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) |
+                p[len - 1];
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
     {
-        h += p[i];
-        h += (h << 10);
-        h ^= (h >> 6);
+        size_t i = len;
+        if (i > 48)
+        {
+            /* Three independent lanes keep the multipliers busy. */
+            uint64_t h1 = h, h2 = h;
+            do
+            {
+                h  = StringHashMix(StringHashRead64(p)      ^ s[1],
+                                   StringHashRead64(p + 8)  ^ h);
+                h1 = StringHashMix(StringHashRead64(p + 16) ^ s[2],
+                                   StringHashRead64(p + 24) ^ h1);
+                h2 = StringHashMix(StringHashRead64(p + 32) ^ s[3],
+                                   StringHashRead64(p + 40) ^ h2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            h ^= h1 ^ h2;
+        }
+        while (i > 16)
+        {
+            h = StringHashMix(StringHashRead64(p) ^ s[1],
+                              StringHashRead64(p + 8) ^ h);
+            p += 16;
+            i -= 16;
+        }
+        /* Last 16 bytes, overlapping with already consumed ones if needed. */
+        a = StringHashRead64(p + i - 16);
+        b = StringHashRead64(p + i - 8);
     }
 
-    h += (h << 3);
-    h ^= (h >> 11);
-    h += (h << 15);
+    h = StringHashMix(s[1] ^ len, StringHashMix(a ^ s[1], b ^ h));
+    return (unsigned int) (h ^ (h >> 32));
+}
+
+unsigned int StringHash(const char *str, unsigned int seed)
+{
+    assert(str != NULL);
+
+    // NULL is not allowed, but we will prevent segfault anyway:
+    size_t len = (str != NULL) ? strlen(str) : 0;
 
-    return h;
+    return StringHashN(str, len, seed);
 }
 
 unsigned int StringHash_untyped(const void *str, unsigned int seed)
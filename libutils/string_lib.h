@@ -59,6 +59,14 @@ typedef struct
 #endif
 
 unsigned int StringHash        (const char *str, unsigned int seed);
+/**
+ * @brief Same as StringHash(), but for a string of known length.
+ *
+ * Avoids the strlen() when the length is already known (#StringRef,
+ * #Buffer, ...). The string doesn't have to be NUL-terminated and may contain
+ * NUL bytes. StringHashN(s, strlen(s), seed) == StringHash(s, seed).
+ */
+unsigned int StringHashN       (const char *str, size_t len, unsigned int seed);
 unsigned int StringHash_untyped(const void *str, unsigned int seed);
 
 char ToLower(char ch);
@@ -181,6 +189,8 @@ ssize_t StringReplace(char *buf, size_t buf_size, const char *find, const char *
 ssize_t StringReplaceN(char *buf, size_t buf_size,
                        const char *find, const char *replace, size_t n);
 
+/* Linear scans of NULL-terminated arrays, for constant tables looked up
+ * often see StringPerfectHash in perfect_hash.h */
 bool IsStrIn(const char *str, const char *const strs[]);
 bool IsStrCaseIn(const char *str, const char *const strs[]);
 
@@ -0,0 +1,453 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <string_map_file.h>
+#include <alloc.h>
+#include <file_lib.h>   // safe_open(), FullRead(), FullWrite()
+#include <logging.h>
+
+#ifndef __MINGW32__
+# include <sys/mman.h>
+#endif
+
+#define STRING_MAP_FILE_MAGIC "NTSMAP\0\0"
+#define STRING_MAP_FILE_VERSION 1
+#define STRING_MAP_FILE_BYTE_ORDER 0x01020304
+
+typedef struct
+{
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t n_entries;
+    uint64_t n_slots;           /* power of 2 */
+    uint64_t slots_offset;
+    uint64_t data_offset;
+    uint64_t file_size;
+} FileHeader;
+
+/* Data of a used slot are the key and the value, both NUL-terminated. */
+typedef struct
+{
+    uint64_t offset;            /* 0 for an empty slot */
+    uint32_t hash;
+    uint32_t key_len;
+} Slot;
+
+struct StringMapFile_
+{
+    const char *data;
+    size_t size;
+    bool mapped;
+    const FileHeader *header;
+    const Slot *slots;
+};
+
+/**
+ * 64-bit FNV-1a. Part of the file format, unlike StringHash() which is free
+ * to change between versions.
+ */
+static uint64_t FileHash(const char *str, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char) str[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t SlotsForEntries(size_t n_entries)
+{
+    /* Keep the load under 3/4, there has to be an empty slot to stop probing */
+    uint64_t n_slots = 8;
+    while (n_slots - n_slots / 4 <= n_entries)
+    {
+        n_slots *= 2;
+    }
+    return n_slots;
+}
+
+#ifndef __MINGW32__
+/* Make the rename() of a file in path's directory durable */
+static void SyncDirectoryOf(const char *path)
+{
+    const char *last_slash = strrchr(path, '/');
+    char *dir;
+    if (last_slash == NULL)
+    {
+        dir = xstrdup(".");
+    }
+    else if (last_slash == path)
+    {
+        dir = xstrdup("/");
+    }
+    else
+    {
+        dir = xstrndup(path, last_slash - path);
+    }
+
+    int fd = open(dir, O_RDONLY);
+    if (fd != -1)
+    {
+        if (fsync(fd) != 0)
+        {
+            Log(LOG_LEVEL_VERBOSE, "Failed to sync directory '%s' (fsync: %s)",
+                dir, GetErrorStr());
+        }
+        close(fd);
+    }
+    free(dir);
+}
+#endif
+
+static bool WriteFileAtomically(const char *path, const char *data, size_t size)
+{
+    /* A unique temporary file, so that concurrent writers of the same path
+     * don't write into each other's file, in the same directory, so that it
+     * can be renamed into place. */
+    char *tmp_path;
+    xasprintf(&tmp_path, "%s.XXXXXX", path);
+
+    int fd = mkstemp(tmp_path);
+    if (fd == -1)
+    {
+        Log(LOG_LEVEL_ERR, "Failed to create string map file '%s' (mkstemp: %s)",
+            tmp_path, GetErrorStr());
+        free(tmp_path);
+        return false;
+    }
+
+#ifndef __MINGW32__
+    /* mkstemp() creates the file readable only by the owner */
+    if (fchmod(fd, 0644) != 0)
+    {
+        Log(LOG_LEVEL_VERBOSE,
+            "Failed to set permissions of string map file '%s' (fchmod: %s)",
+            tmp_path, GetErrorStr());
+    }
+#endif
+
+    if (FullWrite(fd, data, size) < 0)
+    {
+        Log(LOG_LEVEL_ERR, "Failed to write string map file '%s' (write: %s)",
+            tmp_path, GetErrorStr());
+        close(fd);
+        unlink(tmp_path);
+        free(tmp_path);
+        return false;
+    }
+
+    /* The data must be on disk before the rename is, otherwise a crash can
+     * leave an empty file behind. */
+    if (fsync(fd) != 0)
+    {
+        Log(LOG_LEVEL_ERR, "Failed to sync string map file '%s' (fsync: %s)",
+            tmp_path, GetErrorStr());
+        close(fd);
+        unlink(tmp_path);
+        free(tmp_path);
+        return false;
+    }
+    close(fd);
+
+    /* Never truncate the file in place, readers have it mapped. rename()
+     * does not replace an existing file on Windows. */
+#ifdef __MINGW32__
+    if (!MoveFileEx(tmp_path, path,
+                    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+#else
+    if (rename(tmp_path, path) != 0)
+#endif
+    {
+        Log(LOG_LEVEL_ERR, "Failed to replace string map file '%s' (rename: %s)",
+            path, GetErrorStr());
+        unlink(tmp_path);
+        free(tmp_path);
+        return false;
+    }
+    free(tmp_path);
+
+#ifndef __MINGW32__
+    SyncDirectoryOf(path);
+#endif
+    return true;
+}
+
+bool StringMapFileWrite(StringMap *map, const char *path)
+{
+    assert(map != NULL);
+    assert(path != NULL);
+
+    const size_t n_entries = StringMapSize(map);
+    const uint64_t n_slots = SlotsForEntries(n_entries);
+    const uint64_t slots_offset = sizeof(FileHeader);
+    const uint64_t data_offset = slots_offset + n_slots * sizeof(Slot);
+
+    uint64_t file_size = data_offset;
+    StringMapIterator iter = StringMapIteratorInit(map);
+    MapKeyValue *item;
+    while ((item = StringMapIteratorNext(&iter)) != NULL)
+    {
+        const size_t key_len = strlen(item->key);
+        if (key_len > UINT32_MAX - 1)
+        {
+            Log(LOG_LEVEL_ERR,
+                "Key too long for string map file '%s' (%zu bytes)",
+                path, key_len);
+            return false;
+        }
+        /* A lookup can't tell a NULL value from a missing key */
+        if (item->value == NULL)
+        {
+            Log(LOG_LEVEL_ERR,
+                "NULL value of key '%s' can't be stored in string map file '%s'",
+                item->key, path);
+            return false;
+        }
+        file_size += key_len + 1 + strlen(item->value) + 1;
+    }
+
+    char *image = xcalloc(1, file_size);
+    FileHeader *header = (FileHeader *) image;
+    memcpy(header->magic, STRING_MAP_FILE_MAGIC, sizeof(header->magic));
+    header->byte_order = STRING_MAP_FILE_BYTE_ORDER;
+    header->version = STRING_MAP_FILE_VERSION;
+    header->n_entries = n_entries;
+    header->n_slots = n_slots;
+    header->slots_offset = slots_offset;
+    header->data_offset = data_offset;
+    header->file_size = file_size;
+
+    Slot *slots = (Slot *) (image + slots_offset);
+    uint64_t offset = data_offset;
+    iter = StringMapIteratorInit(map);
+    while ((item = StringMapIteratorNext(&iter)) != NULL)
+    {
+        const char *key = item->key;
+        const char *value = item->value;
+        const size_t key_len = strlen(key);
+        const uint64_t hash = FileHash(key, key_len);
+
+        uint64_t pos = hash & (n_slots - 1);
+        while (slots[pos].offset != 0)
+        {
+            pos = (pos + 1) & (n_slots - 1);
+        }
+        slots[pos].offset = offset;
+        slots[pos].hash = (uint32_t) (hash >> 32);
+        slots[pos].key_len = key_len;
+
+        memcpy(image + offset, key, key_len + 1);
+        offset += key_len + 1;
+        const size_t value_len = strlen(value);
+        memcpy(image + offset, value, value_len + 1);
+        offset += value_len + 1;
+    }
+    assert(offset == file_size);
+
+    const bool success = WriteFileAtomically(path, image, file_size);
+    free(image);
+    return success;
+}
+
+static bool IsValidHeader(const FileHeader *header, size_t size)
+{
+    if (memcmp(header->magic, STRING_MAP_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->byte_order != STRING_MAP_FILE_BYTE_ORDER ||
+        header->version != STRING_MAP_FILE_VERSION ||
+        header->file_size != size)
+    {
+        return false;
+    }
+
+    const uint64_t n_slots = header->n_slots;
+    if (n_slots == 0 || (n_slots & (n_slots - 1)) != 0 ||
+        header->n_entries >= n_slots ||
+        header->slots_offset != sizeof(FileHeader) ||
+        n_slots > (size - header->slots_offset) / sizeof(Slot) ||
+        header->data_offset != header->slots_offset + n_slots * sizeof(Slot))
+    {
+        return false;
+    }
+
+    /* Makes sure every string in the data ends within the file. */
+    return (header->data_offset == size ||
+            ((const char *) header)[size - 1] == '\0');
+}
+
+StringMapFile *StringMapFileOpen(const char *path)
+{
+    assert(path != NULL);
+
+    int fd = safe_open(path, O_RDONLY | O_BINARY);
+    if (fd == -1)
+    {
+        Log(LOG_LEVEL_ERR, "Failed to open string map file '%s' (open: %s)",
+            path, GetErrorStr());
+        return NULL;
+    }
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0)
+    {
+        Log(LOG_LEVEL_ERR, "Failed to open string map file '%s' (fstat: %s)",
+            path, GetErrorStr());
+        close(fd);
+        return NULL;
+    }
+    if (sb.st_size < (off_t) sizeof(FileHeader))
+    {
+        Log(LOG_LEVEL_ERR, "Invalid string map file '%s'", path);
+        close(fd);
+        return NULL;
+    }
+
+    StringMapFile *file = xcalloc(1, sizeof(StringMapFile));
+    file->size = sb.st_size;
+
+#ifndef __MINGW32__
+    void *data = mmap(NULL, file->size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        Log(LOG_LEVEL_ERR, "Failed to map string map file '%s' (mmap: %s)",
+            path, GetErrorStr());
+        close(fd);
+        free(file);
+        return NULL;
+    }
+# ifdef MADV_RANDOM
+    /* Lookups jump around the file, read-ahead would only waste memory. */
+    madvise(data, file->size, MADV_RANDOM);
+# endif
+    file->data = data;
+    file->mapped = true;
+#else
+    char *data = xmalloc(file->size);
+    if (FullRead(fd, data, file->size) != (ssize_t) file->size)
+    {
+        Log(LOG_LEVEL_ERR, "Failed to read string map file '%s' (read: %s)",
+            path, GetErrorStr());
+        close(fd);
+        free(data);
+        free(file);
+        return NULL;
+    }
+    file->data = data;
+    file->mapped = false;
+#endif
+    close(fd);
+
+    file->header = (const FileHeader *) file->data;
+    if (!IsValidHeader(file->header, file->size))
+    {
+        Log(LOG_LEVEL_ERR, "Invalid string map file '%s'", path);
+        StringMapFileClose(file);
+        return NULL;
+    }
+    file->slots = (const Slot *) (file->data + file->header->slots_offset);
+
+    return file;
+}
+
+/**
+ * @return the slot for key, NULL if there is none
+ */
+static const Slot *FindSlot(const StringMapFile *file, const char *key)
+{
+    assert(file != NULL);
+    assert(key != NULL);
+
+    const size_t key_len = strlen(key);
+    const uint64_t hash = FileHash(key, key_len);
+    const uint32_t short_hash = (uint32_t) (hash >> 32);
+    const uint64_t n_slots = file->header->n_slots;
+
+    uint64_t pos = hash & (n_slots - 1);
+    /* Bounded, so that a damaged file without empty slots cannot hang us */
+    for (uint64_t i = 0; i < n_slots; i++)
+    {
+        const Slot *slot = &file->slots[pos];
+        if (slot->offset == 0)
+        {
+            return NULL;
+        }
+        if (slot->hash == short_hash &&
+            slot->key_len == key_len &&
+            slot->offset >= file->header->data_offset &&
+            slot->offset + key_len < file->size &&
+            memcmp(file->data + slot->offset, key, key_len + 1) == 0)
+        {
+            return slot;
+        }
+        pos = (pos + 1) & (n_slots - 1);
+    }
+    return NULL;
+}
+
+const char *StringMapFileGet(const StringMapFile *file, const char *key)
+{
+    const Slot *slot = FindSlot(file, key);
+    if (slot == NULL)
+    {
+        return NULL;
+    }
+
+    const uint64_t value_offset = slot->offset + slot->key_len + 1;
+    if (value_offset >= file->size)
+    {
+        return NULL;
+    }
+    return file->data + value_offset;
+}
+
+bool StringMapFileHasKey(const StringMapFile *file, const char *key)
+{
+    return (FindSlot(file, key) != NULL);
+}
+
+size_t StringMapFileSize(const StringMapFile *file)
+{
+    assert(file != NULL);
+    return file->header->n_entries;
+}
+
+void StringMapFileClose(StringMapFile *file)
+{
+    if (file != NULL)
+    {
+#ifndef __MINGW32__
+        if (file->mapped)
+        {
+            munmap((void *) file->data, file->size);
+        }
+        else
+#endif
+        {
+            free((void *) file->data);
+        }
+        free(file);
+    }
+}
@@ -0,0 +1,70 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_STRING_MAP_FILE_H
+#define CFENGINE_STRING_MAP_FILE_H
+
+#include <map.h>        // StringMap
+#include <stdbool.h>
+#include <stddef.h>     // size_t
+
+/*
+ * Read-only persistent hash table of strings.
+ *
+ * A StringMap is written out once into a file holding an open-addressing
+ * slot index followed by the key/value strings. Opening the file maps it into
+ * memory and lookups are done in place, so opening is O(1) regardless of the
+ * number of entries, nothing is parsed or copied, and processes using the same
+ * file share its pages in the page cache.
+ *
+ * The file is written in the host byte order and is rejected on hosts with a
+ * different one, it is meant as a local cache, not an exchange format.
+ */
+typedef struct StringMapFile_ StringMapFile;
+
+/**
+ * Write all entries of map into a new file at path.
+ *
+ * The file is written under a temporary name and renamed over path, so
+ * processes having the old file open keep seeing the old contents.
+ *
+ * @return false in case of error (logged), e.g. if a value is NULL
+ */
+bool StringMapFileWrite(StringMap *map, const char *path);
+
+/**
+ * @return NULL if the file cannot be opened or is not a valid string map file
+ *         (logged)
+ */
+StringMapFile *StringMapFileOpen(const char *path);
+
+/**
+ * @return the value for key pointing into the file (valid until
+ *         StringMapFileClose()), NULL if there is no such key
+ */
+const char *StringMapFileGet(const StringMapFile *file, const char *key);
+bool StringMapFileHasKey(const StringMapFile *file, const char *key);
+size_t StringMapFileSize(const StringMapFile *file);
+void StringMapFileClose(StringMapFile *file);
+
+#endif
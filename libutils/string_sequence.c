@@ -3,6 +3,8 @@
 #include <string_lib.h> // SafeStringLength()
 #include <alloc.h>  // xstrdup()
 #include <string.h> // strlen()
+#include <strings.h> // strcasecmp()
+#include <ctype.h> // tolower()
 #include <writer.h> // StringWriter()
 #include <file_lib.h> // safe_fopen()
 
@@ -126,6 +128,243 @@ int SeqStringLength(Seq *seq)
     return total_length;
 }
 
+/*
+ * SeqSortStrings() is a multikey quicksort (Bentley & Sedgewick): items are
+ * partitioned on their next characters into less / equal / greater, and
+ * only the equal part moves on to the following characters. Shared prefixes
+ * (e.g. of file paths) are thus scanned once per partitioning step instead
+ * of once per comparison.
+ *
+ * The characters are taken 8 at a time, packed big endian into an integer
+ * kept next to the string pointer, so partitioning compares integers in
+ * a contiguous array instead of chasing a pointer per comparison.
+ */
+
+/* Ranges smaller than this are insertion sorted */
+#define STRING_SORT_INSERTION_THRESHOLD 16
+
+typedef struct
+{
+    uint64_t key;               /* 8 characters from depth on, 0 padded */
+    char *str;
+} StringSortItem;
+
+/* Load the keys of the items at the given depth, the strings are known to
+ * be at least depth characters long */
+static void StringSortLoadKeys(StringSortItem *items, size_t n, size_t depth,
+                               bool ignore_case)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        const unsigned char *str = (const unsigned char *) items[i].str + depth;
+        uint64_t key = 0;
+        size_t j = 0;
+        for (; j < sizeof(key) && str[j] != '\0'; j++)
+        {
+            key = (key << 8) | (ignore_case ? tolower(str[j]) : str[j]);
+        }
+        for (; j < sizeof(key); j++)
+        {
+            key <<= 8;
+        }
+        items[i].key = key;
+    }
+}
+
+/* Whether the string ends within its key, in which case equal keys mean
+ * equal strings */
+static inline bool StringSortKeyEnds(uint64_t key)
+{
+    return (key & 0xFF) == 0;
+}
+
+static int StringSortCompare(const StringSortItem *a, const StringSortItem *b,
+                             size_t depth, bool ignore_case)
+{
+    if (a->key != b->key)
+    {
+        return (a->key < b->key) ? -1 : 1;
+    }
+    if (StringSortKeyEnds(a->key))
+    {
+        return 0;
+    }
+
+    depth += sizeof(a->key);
+    return ignore_case ? strcasecmp(a->str + depth, b->str + depth)
+                       : strcmp(a->str + depth, b->str + depth);
+}
+
+static inline void StringSortSwap(StringSortItem *a, StringSortItem *b)
+{
+    StringSortItem tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void StringInsertionSort(StringSortItem *items, size_t n, size_t depth,
+                                bool ignore_case)
+{
+    for (size_t i = 1; i < n; i++)
+    {
+        StringSortItem item = items[i];
+        size_t j = i;
+        while (j > 0 &&
+               StringSortCompare(&items[j - 1], &item, depth, ignore_case) > 0)
+        {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = item;
+    }
+}
+
+static size_t StringSortMedianOf3(const StringSortItem *items,
+                                  size_t a, size_t b, size_t c)
+{
+    const uint64_t ka = items[a].key;
+    const uint64_t kb = items[b].key;
+    const uint64_t kc = items[c].key;
+
+    if (ka < kb)
+    {
+        return (kb < kc) ? b : ((ka < kc) ? c : a);
+    }
+    return (kb > kc) ? b : ((ka < kc) ? a : c);
+}
+
+/* The keys of the items must be loaded for the given depth */
+static void MultikeyQuickSort(StringSortItem *items, size_t n, size_t depth,
+                              bool ignore_case)
+{
+    while (n >= STRING_SORT_INSERTION_THRESHOLD)
+    {
+        StringSortSwap(&items[0], &items[StringSortMedianOf3(items, 0, n / 2, n - 1)]);
+        const uint64_t v = items[0].key;
+
+        /*
+         * Bentley-McIlroy 3-way partitioning:
+         * [0, a) == v, [a, b) < v, (c, d] > v, (d, n) == v
+         */
+        size_t a = 1;
+        size_t b = 1;
+        size_t c = n - 1;
+        size_t d = n - 1;
+        for (;;)
+        {
+            while (b <= c && items[b].key <= v)
+            {
+                if (items[b].key == v)
+                {
+                    StringSortSwap(&items[a++], &items[b]);
+                }
+                b++;
+            }
+            while (b <= c && items[c].key >= v)
+            {
+                if (items[c].key == v)
+                {
+                    StringSortSwap(&items[c], &items[d--]);
+                }
+                c--;
+            }
+            if (b > c)
+            {
+                break;
+            }
+            StringSortSwap(&items[b++], &items[c--]);
+        }
+
+        /* Move the equal parts to the middle */
+        size_t r = MIN(a, b - a);
+        for (size_t i = 0; i < r; i++)
+        {
+            StringSortSwap(&items[i], &items[b - r + i]);
+        }
+        r = MIN(d - c, n - 1 - d);
+        for (size_t i = 0; i < r; i++)
+        {
+            StringSortSwap(&items[b + i], &items[n - r + i]);
+        }
+
+        const size_t n_less = b - a;
+        const size_t n_greater = d - c;
+        const size_t n_equal = n - n_less - n_greater;
+        StringSortItem *equal = items + n_less;
+        StringSortItem *greater = items + n - n_greater;
+
+        /* Equal strings that all ended need no more sorting, otherwise they
+         * continue with the next characters */
+        const bool equal_done = StringSortKeyEnds(v);
+        if (!equal_done)
+        {
+            StringSortLoadKeys(equal, n_equal, depth + sizeof(v), ignore_case);
+        }
+
+        /* Recurse into the two smaller parts and loop on the biggest one,
+         * keeping the stack depth logarithmic. */
+        if (n_less >= n_greater && n_less >= n_equal)
+        {
+            MultikeyQuickSort(greater, n_greater, depth, ignore_case);
+            if (!equal_done)
+            {
+                MultikeyQuickSort(equal, n_equal, depth + sizeof(v), ignore_case);
+            }
+            n = n_less;
+        }
+        else if (n_greater >= n_equal)
+        {
+            MultikeyQuickSort(items, n_less, depth, ignore_case);
+            if (!equal_done)
+            {
+                MultikeyQuickSort(equal, n_equal, depth + sizeof(v), ignore_case);
+            }
+            items = greater;
+            n = n_greater;
+        }
+        else
+        {
+            MultikeyQuickSort(items, n_less, depth, ignore_case);
+            MultikeyQuickSort(greater, n_greater, depth, ignore_case);
+            if (equal_done)
+            {
+                return;
+            }
+            items = equal;
+            n = n_equal;
+            depth += sizeof(v);
+        }
+    }
+
+    StringInsertionSort(items, n, depth, ignore_case);
+}
+
+void SeqSortStrings(Seq *seq, bool ignore_case)
+{
+    assert(seq != NULL);
+
+    const size_t length = seq->length;
+    if (length < 2)
+    {
+        return;
+    }
+
+    StringSortItem *items = xmalloc(length * sizeof(StringSortItem));
+    for (size_t i = 0; i < length; i++)
+    {
+        items[i].str = seq->data[i];
+    }
+    StringSortLoadKeys(items, length, 0, ignore_case);
+
+    MultikeyQuickSort(items, length, 0, ignore_case);
+
+    for (size_t i = 0; i < length; i++)
+    {
+        seq->data[i] = items[i].str;
+    }
+    free(items);
+}
+
 // TODO: These static helper functions could be (re)moved
 static bool HasNulByte(const char *str, size_t n)
 {
@@ -47,6 +47,20 @@ bool SeqStringContains(const Seq *seq, const char *str);
  */
 int SeqStringLength(Seq *seq);
 
+/**
+ * @brief Sort a sequence of strings, faster than SeqSort() with StrCmpWrapper
+ *
+ * A multikey quicksort comparing 8 characters at a time, packed into an
+ * integer, so long common prefixes (e.g. of paths) are not compared over and
+ * over again. Expect it to be about 1.6 times as fast as SeqSort() with
+ * StrCmpWrapper on short paths.
+ *
+ * @param[in] ignore_case Order as strcasecmp() would, otherwise as strcmp()
+ * @note Not stable, strings differing only in case are in no particular
+ *       order when ignore_case is true.
+ */
+void SeqSortStrings(Seq *seq, bool ignore_case);
+
 /**
  * Serialize the string into a length-prefixed format that consists of:
  * 1. 10 bytes of length prefix, where index 9 must be a space
@@ -0,0 +1,284 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <task_scheduler.h>
+#include <alloc.h>
+#include <misc_lib.h>         // ProgrammingError(), GetOnlineCPUCount()
+#include <event_count.h>
+#include <threaded_queue.h>
+#include <work_stealing_deque.h>
+
+/* Attempts to find a task, yielding in between, before going to sleep */
+#define SPIN_ATTEMPTS 16
+
+typedef struct
+{
+    TaskFn *fn;
+    void *data;
+    TaskGroup *group;
+} Task;
+
+typedef struct
+{
+    TaskScheduler *scheduler;
+    WSDeque *deque;
+    uint64_t random_state;      /* for picking victims to steal from */
+    pthread_t thread;
+} Worker;
+
+struct TaskScheduler_
+{
+    Worker *workers;
+    size_t n_workers;
+    size_t n_started;           /* threads actually running */
+    ThreadedQueue *injected;    /* tasks spawned from outside the workers */
+    size_t n_queued;            /* tasks in the deques and injected, atomic */
+    bool shutdown;              /* atomic */
+    EventCount event;           /* tasks queued, groups done or shutdown */
+    pthread_key_t worker_key;   /* the calling thread's Worker */
+};
+
+static Worker *CurrentWorker(TaskScheduler *scheduler)
+{
+    return pthread_getspecific(scheduler->worker_key);
+}
+
+static size_t RandomVictim(Worker *self, size_t n_workers)
+{
+    /* xorshift64 */
+    uint64_t x = self->random_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    self->random_state = x;
+    return x % n_workers;
+}
+
+/**
+ * @param self The calling worker, NULL if not a worker
+ */
+static bool FindTask(TaskScheduler *scheduler, Worker *self, Task **task)
+{
+    void *item = NULL;
+    bool found = (self != NULL && WSDequePop(self->deque, &item)) ||
+        ThreadedQueuePop(scheduler->injected, &item, 0);
+
+    if (!found && scheduler->n_workers > 0)
+    {
+        /* Try every other worker once, starting at a random one */
+        size_t start = (self != NULL) ?
+            RandomVictim(self, scheduler->n_workers) : 0;
+        for (size_t i = 0; i < scheduler->n_workers && !found; i++)
+        {
+            Worker *victim = &scheduler->workers[(start + i) % scheduler->n_workers];
+            found = (victim != self && WSDequeSteal(victim->deque, &item));
+        }
+    }
+
+    if (found)
+    {
+        __atomic_fetch_sub(&scheduler->n_queued, 1, __ATOMIC_RELAXED);
+        *task = item;
+    }
+    return found;
+}
+
+static void RunTask(TaskScheduler *scheduler, Task *task)
+{
+    task->fn(task->data);
+
+    TaskGroup *group = task->group;
+    free(task);
+
+    if (__atomic_sub_fetch(&group->pending, 1, __ATOMIC_RELEASE) == 0)
+    {
+        EventCountNotifyAll(&scheduler->event);
+    }
+}
+
+/**
+ * Find and run one task, or sleep until there may be something to do.
+ *
+ * @param done Stop condition checked before sleeping, NULL for none
+ */
+static void RunOrWait(TaskScheduler *scheduler, Worker *self,
+                      bool (*done) (void *), void *done_data)
+{
+    Task *task;
+    for (int i = 0; i < SPIN_ATTEMPTS; i++)
+    {
+        if (FindTask(scheduler, self, &task))
+        {
+            RunTask(scheduler, task);
+            return;
+        }
+        if ((done != NULL && done(done_data)) ||
+            __atomic_load_n(&scheduler->shutdown, __ATOMIC_ACQUIRE))
+        {
+            return;
+        }
+        sched_yield();
+    }
+
+    unsigned long key = EventCountPrepareWait(&scheduler->event);
+    if (__atomic_load_n(&scheduler->n_queued, __ATOMIC_RELAXED) > 0 ||
+        (done != NULL && done(done_data)) ||
+        __atomic_load_n(&scheduler->shutdown, __ATOMIC_ACQUIRE))
+    {
+        EventCountCancelWait(&scheduler->event);
+        return;
+    }
+    EventCountWait(&scheduler->event, key, NULL);
+}
+
+static void *WorkerMain(void *data)
+{
+    Worker *self = data;
+    TaskScheduler *scheduler = self->scheduler;
+    pthread_setspecific(scheduler->worker_key, self);
+
+    while (!__atomic_load_n(&scheduler->shutdown, __ATOMIC_ACQUIRE))
+    {
+        RunOrWait(scheduler, self, NULL, NULL);
+    }
+    return NULL;
+}
+
+TaskScheduler *TaskSchedulerNew(size_t n_workers)
+{
+    if (n_workers == 0)
+    {
+        n_workers = GetOnlineCPUCount();
+    }
+
+    TaskScheduler *scheduler = xcalloc(1, sizeof(TaskScheduler));
+    scheduler->injected = ThreadedQueueNew(0, NULL);
+    EventCountInit(&scheduler->event);
+    if (pthread_key_create(&scheduler->worker_key, NULL) != 0)
+    {
+        ProgrammingError("Failed to create the task scheduler's thread key");
+    }
+
+    scheduler->workers = xcalloc(n_workers, sizeof(Worker));
+    for (size_t i = 0; i < n_workers; i++)
+    {
+        Worker *worker = &scheduler->workers[i];
+        worker->scheduler = scheduler;
+        worker->deque = WSDequeNew(0);
+        worker->random_state = 0x9E3779B97F4A7C15ULL * (i + 1);
+    }
+
+    /* Only start the threads once all the deques exist, they steal from
+     * each other right away. The deques of workers that fail to start stay
+     * empty, which does no harm. */
+    scheduler->n_workers = n_workers;
+    while (scheduler->n_started < n_workers &&
+           pthread_create(&scheduler->workers[scheduler->n_started].thread,
+                          NULL, WorkerMain,
+                          &scheduler->workers[scheduler->n_started]) == 0)
+    {
+        scheduler->n_started++;
+    }
+
+    return scheduler;
+}
+
+void TaskSchedulerDestroy(TaskScheduler *scheduler)
+{
+    if (scheduler == NULL)
+    {
+        return;
+    }
+
+    __atomic_store_n(&scheduler->shutdown, true, __ATOMIC_RELEASE);
+    EventCountNotifyAll(&scheduler->event);
+
+    for (size_t i = 0; i < scheduler->n_started; i++)
+    {
+        pthread_join(scheduler->workers[i].thread, NULL);
+    }
+
+    for (size_t i = 0; i < scheduler->n_workers; i++)
+    {
+        WSDequeDestroy(scheduler->workers[i].deque);
+    }
+    free(scheduler->workers);
+
+    ThreadedQueueDestroy(scheduler->injected);
+    EventCountDestroy(&scheduler->event);
+    pthread_key_delete(scheduler->worker_key);
+    free(scheduler);
+}
+
+size_t TaskSchedulerWorkerCount(const TaskScheduler *scheduler)
+{
+    assert(scheduler != NULL);
+    return scheduler->n_started;
+}
+
+void TaskSpawn(TaskScheduler *scheduler, TaskGroup *group,
+               TaskFn *fn, void *data)
+{
+    assert(scheduler != NULL);
+    assert(group != NULL);
+    assert(fn != NULL);
+
+    Task *task = xmalloc(sizeof(Task));
+    task->fn = fn;
+    task->data = data;
+    task->group = group;
+
+    __atomic_fetch_add(&group->pending, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&scheduler->n_queued, 1, __ATOMIC_RELAXED);
+
+    Worker *self = CurrentWorker(scheduler);
+    if (self != NULL)
+    {
+        WSDequePush(self->deque, task);
+    }
+    else
+    {
+        ThreadedQueuePush(scheduler->injected, task);
+    }
+
+    EventCountNotifyAll(&scheduler->event);
+}
+
+static bool GroupDone(void *data)
+{
+    TaskGroup *group = data;
+    return __atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) == 0;
+}
+
+void TaskGroupWait(TaskScheduler *scheduler, TaskGroup *group)
+{
+    assert(scheduler != NULL);
+    assert(group != NULL);
+
+    Worker *self = CurrentWorker(scheduler);
+    while (!GroupDone(group))
+    {
+        RunOrWait(scheduler, self, GroupDone, group);
+    }
+}
@@ -0,0 +1,91 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_TASK_SCHEDULER_H
+#define CFENGINE_TASK_SCHEDULER_H
+
+#include <stddef.h>     // size_t
+
+/*
+ * Fork-join task scheduler for recursive, divide and conquer work.
+ *
+ * Every worker thread has its own work-stealing deque (WSDeque): tasks
+ * spawned by a task go to the bottom of its worker's deque and are run by
+ * it depth-first, while idle workers steal the oldest (biggest) tasks from
+ * random other workers. Workers with nothing to do sleep until new tasks
+ * are spawned. Tasks spawned from outside the workers go to a shared queue.
+ *
+ *     static void Walk(void *data)
+ *     {
+ *         Dir *dir = data;
+ *         TaskGroup group = { 0 };
+ *         for each subdirectory:
+ *             TaskSpawn(scheduler, &group, Walk, subdirectory);
+ *         ...process the files...
+ *         TaskGroupWait(scheduler, &group);
+ *     }
+ *
+ * TaskGroupWait() runs other tasks while waiting, so waiting inside a task
+ * doesn't block a worker.
+ */
+
+typedef struct TaskScheduler_ TaskScheduler;
+
+typedef void TaskFn(void *data);
+
+/**
+ * Tasks to wait for together, zero initialize before the first spawn.
+ */
+typedef struct
+{
+    size_t pending;             /* atomic */
+} TaskGroup;
+
+/**
+  @brief Start a scheduler.
+  @param [in] n_workers Number of worker threads, 0 for one per CPU.
+  */
+TaskScheduler *TaskSchedulerNew(size_t n_workers);
+
+/**
+  @brief Stop the worker threads and free the scheduler.
+  @warning All task groups must have been waited for.
+  */
+void TaskSchedulerDestroy(TaskScheduler *scheduler);
+
+size_t TaskSchedulerWorkerCount(const TaskScheduler *scheduler);
+
+/**
+  @brief Run fn(data) on some worker as part of the group.
+  @note Can be called from any thread, including from within tasks.
+  */
+void TaskSpawn(TaskScheduler *scheduler, TaskGroup *group,
+               TaskFn *fn, void *data);
+
+/**
+  @brief Wait until all the tasks of the group are done, running queued tasks
+         in the meantime.
+  */
+void TaskGroupWait(TaskScheduler *scheduler, TaskGroup *group);
+
+#endif
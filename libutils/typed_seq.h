@@ -0,0 +1,232 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_TYPED_SEQ_H
+#define CFENGINE_TYPED_SEQ_H
+
+#include <stdbool.h>
+#include <stddef.h>    // size_t
+#include <stdlib.h>    // qsort(), bsearch()
+#include <string.h>    // memmove()
+#include <sys/types.h> // ssize_t
+#include <assert.h>    // assert()
+#include <alloc.h>     // xmalloc(), xrealloc()
+
+/*
+ * Typed sequences storing the items inline.
+ *
+ * #Seq holds void * items, so a sequence of numbers or small structs needs
+ * an allocation per item and an indirection for every access.
+ * TYPED_SEQ_DEFINE(Prefix, T) generates a sequence type Prefix##Seq keeping
+ * the T items themselves in one contiguous array, with the same growth
+ * strategy and (where it makes sense) the same operations as #Seq.
+ *
+ * Items are copied in and out by value and are not destroyed, so T should be
+ * a plain value type (number, struct without owned memory, or a pointer the
+ * caller manages).
+ *
+ * The comparator given to Sort and BinaryIndexOf is a qsort()/bsearch()
+ * comparator, called with pointers to two items.
+ *
+ * Put TYPED_SEQ_DECLARE() in a header and TYPED_SEQ_DEFINE() in exactly one
+ * .c file, like with TYPED_MAP_DECLARE()/TYPED_MAP_DEFINE().
+ */
+
+#define TYPED_SEQ_DECLARE(Prefix, T)                                    \
+    typedef struct                                                      \
+    {                                                                   \
+        T *data;                                                        \
+        size_t length;                                                  \
+        size_t capacity;                                                \
+    } Prefix##Seq;                                                      \
+                                                                        \
+    static inline T Prefix##SeqAt(const Prefix##Seq *seq, size_t i)     \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        assert(i < seq->length);                                        \
+        return seq->data[i];                                            \
+    }                                                                   \
+                                                                        \
+    static inline void Prefix##SeqSet(Prefix##Seq *seq, size_t i, T item) \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        assert(i < seq->length);                                        \
+        seq->data[i] = item;                                            \
+    }                                                                   \
+                                                                        \
+    Prefix##Seq *Prefix##SeqNew(size_t initial_capacity);               \
+    void Prefix##SeqDestroy(Prefix##Seq *seq);                          \
+    size_t Prefix##SeqLength(const Prefix##Seq *seq);                   \
+    void Prefix##SeqReserve(Prefix##Seq *seq, size_t capacity);         \
+    void Prefix##SeqAppend(Prefix##Seq *seq, T item);                   \
+    void Prefix##SeqAppendArray(Prefix##Seq *seq, const T *items, size_t count); \
+    void Prefix##SeqInsert(Prefix##Seq *seq, size_t index, T item);     \
+    void Prefix##SeqRemoveRange(Prefix##Seq *seq, size_t start, size_t end); \
+    void Prefix##SeqRemove(Prefix##Seq *seq, size_t index);             \
+    void Prefix##SeqClear(Prefix##Seq *seq);                            \
+    void Prefix##SeqSort(Prefix##Seq *seq,                              \
+                         int (*compare)(const void *, const void *));   \
+    ssize_t Prefix##SeqBinaryIndexOf(const Prefix##Seq *seq, const T *key, \
+                                     int (*compare)(const void *, const void *)); \
+    Prefix##Seq *Prefix##SeqFilter(Prefix##Seq *seq, bool (*filter)(const T *item)); \
+
+#define TYPED_SEQ_DEFINE(Prefix, T)                                     \
+    Prefix##Seq *Prefix##SeqNew(size_t initial_capacity)                \
+    {                                                                   \
+        Prefix##Seq *seq = xmalloc(sizeof(Prefix##Seq));                \
+        if (initial_capacity == 0)                                      \
+        {                                                               \
+            initial_capacity = 1;                                       \
+        }                                                               \
+        seq->data = xmalloc(sizeof(T) * initial_capacity);              \
+        seq->length = 0;                                                \
+        seq->capacity = initial_capacity;                               \
+        return seq;                                                     \
+    }                                                                   \
+                                                                        \
+    void Prefix##SeqDestroy(Prefix##Seq *seq)                           \
+    {                                                                   \
+        if (seq != NULL)                                                \
+        {                                                               \
+            free(seq->data);                                            \
+            free(seq);                                                  \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    size_t Prefix##SeqLength(const Prefix##Seq *seq)                    \
+    {                                                                   \
+        return (seq != NULL) ? seq->length : 0;                         \
+    }                                                                   \
+                                                                        \
+    void Prefix##SeqReserve(Prefix##Seq *seq, size_t capacity)          \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        if (capacity > seq->capacity)                                   \
+        {                                                               \
+            seq->data = xrealloc(seq->data, sizeof(T) * capacity);      \
+            seq->capacity = capacity;                                   \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    /* Same growth as Seq: double the capacity when full. */            \
+    static inline void Prefix##SeqGrow_(Prefix##Seq *seq, size_t count) \
+    {                                                                   \
+        if (seq->length + count > seq->capacity)                        \
+        {                                                               \
+            size_t capacity = seq->capacity * 2;                        \
+            while (capacity < seq->length + count)                      \
+            {                                                           \
+                capacity *= 2;                                          \
+            }                                                           \
+            Prefix##SeqReserve(seq, capacity);                          \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    void Prefix##SeqAppend(Prefix##Seq *seq, T item)                    \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        Prefix##SeqGrow_(seq, 1);                                       \
+        seq->data[seq->length++] = item;                                \
+    }                                                                   \
+                                                                        \
+    void Prefix##SeqAppendArray(Prefix##Seq *seq, const T *items, size_t count) \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        assert(items != NULL || count == 0);                            \
+        Prefix##SeqGrow_(seq, count);                                   \
+        memcpy(seq->data + seq->length, items, sizeof(T) * count);      \
+        seq->length += count;                                           \
+    }                                                                   \
+                                                                        \
+    void Prefix##SeqInsert(Prefix##Seq *seq, size_t index, T item)      \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        assert(index <= seq->length);                                   \
+        Prefix##SeqGrow_(seq, 1);                                       \
+        memmove(seq->data + index + 1, seq->data + index,               \
+                sizeof(T) * (seq->length - index));                     \
+        seq->data[index] = item;                                        \
+        seq->length++;                                                  \
+    }                                                                   \
+                                                                        \
+    /* Inclusive range, like SeqRemoveRange() */                        \
+    void Prefix##SeqRemoveRange(Prefix##Seq *seq, size_t start, size_t end) \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        assert(start <= end);                                           \
+        assert(end < seq->length);                                      \
+        memmove(seq->data + start, seq->data + end + 1,                 \
+                sizeof(T) * (seq->length - end - 1));                   \
+        seq->length -= end - start + 1;                                 \
+    }                                                                   \
+                                                                        \
+    void Prefix##SeqRemove(Prefix##Seq *seq, size_t index)              \
+    {                                                                   \
+        Prefix##SeqRemoveRange(seq, index, index);                      \
+    }                                                                   \
+                                                                        \
+    void Prefix##SeqClear(Prefix##Seq *seq)                             \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        seq->length = 0;                                                \
+    }                                                                   \
+                                                                        \
+    void Prefix##SeqSort(Prefix##Seq *seq,                              \
+                         int (*compare)(const void *, const void *))    \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        if (seq->length > 1)                                            \
+        {                                                               \
+            qsort(seq->data, seq->length, sizeof(T), compare);          \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    ssize_t Prefix##SeqBinaryIndexOf(const Prefix##Seq *seq, const T *key, \
+                                     int (*compare)(const void *, const void *)) \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        if (seq->length == 0)                                           \
+        {                                                               \
+            return -1;                                                  \
+        }                                                               \
+        const T *found = bsearch(key, seq->data, seq->length, sizeof(T), compare); \
+        return (found != NULL) ? (found - seq->data) : -1;              \
+    }                                                                   \
+                                                                        \
+    /* Removes the items for which filter returns true, like SeqFilter() */ \
+    Prefix##Seq *Prefix##SeqFilter(Prefix##Seq *seq, bool (*filter)(const T *item)) \
+    {                                                                   \
+        assert(seq != NULL);                                            \
+        size_t kept = 0;                                                \
+        for (size_t i = 0; i < seq->length; i++)                        \
+        {                                                               \
+            if (!filter(&seq->data[i]))                                 \
+            {                                                           \
+                seq->data[kept++] = seq->data[i];                       \
+            }                                                           \
+        }                                                               \
+        seq->length = kept;                                             \
+        return seq;                                                     \
+    }                                                                   \
+
+#endif
@@ -0,0 +1,182 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#include <platform.h>
+#include <work_stealing_deque.h>
+#include <alloc.h>
+
+#define CACHE_LINE_SIZE 64
+
+typedef struct DequeBuffer_
+{
+    struct DequeBuffer_ *previous;  /* replaced buffers, freed with the deque */
+    int64_t mask;
+    void *items[];                  /* accessed atomically */
+} DequeBuffer;
+
+struct WSDeque_
+{
+    DequeBuffer *buffer;            /* atomic, replaced by the owner when growing */
+
+    char pad0[CACHE_LINE_SIZE];
+    int64_t top;                    /* next item to steal */
+    char pad1[CACHE_LINE_SIZE - sizeof(int64_t)];
+    int64_t bottom;                 /* next slot to push to, owner only writes */
+    char pad2[CACHE_LINE_SIZE - sizeof(int64_t)];
+};
+
+static DequeBuffer *BufferNew(int64_t size, DequeBuffer *previous)
+{
+    DequeBuffer *buffer = xmalloc(sizeof(DequeBuffer) + size * sizeof(void *));
+    buffer->previous = previous;
+    buffer->mask = size - 1;
+    return buffer;
+}
+
+static inline void *BufferGet(DequeBuffer *buffer, int64_t i)
+{
+    return __atomic_load_n(&buffer->items[i & buffer->mask], __ATOMIC_RELAXED);
+}
+
+static inline void BufferPut(DequeBuffer *buffer, int64_t i, void *item)
+{
+    __atomic_store_n(&buffer->items[i & buffer->mask], item, __ATOMIC_RELAXED);
+}
+
+WSDeque *WSDequeNew(size_t initial_capacity)
+{
+    int64_t size = 16;
+    while ((size_t) size < initial_capacity)
+    {
+        size *= 2;
+    }
+
+    WSDeque *deque = xcalloc(1, sizeof(WSDeque));
+    deque->buffer = BufferNew(size, NULL);
+    return deque;
+}
+
+void WSDequeDestroy(WSDeque *deque)
+{
+    if (deque != NULL)
+    {
+        DequeBuffer *buffer = deque->buffer;
+        while (buffer != NULL)
+        {
+            DequeBuffer *previous = buffer->previous;
+            free(buffer);
+            buffer = previous;
+        }
+        free(deque);
+    }
+}
+
+void WSDequePush(WSDeque *deque, void *item)
+{
+    assert(deque != NULL);
+
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    DequeBuffer *buffer = __atomic_load_n(&deque->buffer, __ATOMIC_RELAXED);
+
+    if (bottom - top > buffer->mask)
+    {
+        DequeBuffer *bigger = BufferNew(2 * (buffer->mask + 1), buffer);
+        for (int64_t i = top; i < bottom; i++)
+        {
+            BufferPut(bigger, i, BufferGet(buffer, i));
+        }
+        __atomic_store_n(&deque->buffer, bigger, __ATOMIC_RELEASE);
+        buffer = bigger;
+    }
+
+    BufferPut(buffer, bottom, item);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+}
+
+bool WSDequePop(WSDeque *deque, void **item)
+{
+    assert(deque != NULL);
+    assert(item != NULL);
+
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    DequeBuffer *buffer = __atomic_load_n(&deque->buffer, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top > bottom)
+    {
+        /* Empty */
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    *item = BufferGet(buffer, bottom);
+    if (top < bottom)
+    {
+        return true;
+    }
+
+    /* The last item, race against the thieves for it */
+    bool won = __atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return won;
+}
+
+bool WSDequeSteal(WSDeque *deque, void **item)
+{
+    assert(deque != NULL);
+    assert(item != NULL);
+
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= bottom)
+    {
+        return false;
+    }
+
+    DequeBuffer *buffer = __atomic_load_n(&deque->buffer, __ATOMIC_ACQUIRE);
+    void *stolen = BufferGet(buffer, top);
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    {
+        /* Lost the race to the owner or another thief */
+        return false;
+    }
+
+    *item = stolen;
+    return true;
+}
+
+size_t WSDequeCount(const WSDeque *deque)
+{
+    assert(deque != NULL);
+
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    return (bottom > top) ? (size_t) (bottom - top) : 0;
+}
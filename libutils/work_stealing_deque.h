@@ -0,0 +1,75 @@
+/*
+  Copyright 2024 Northern.tech AS
+
+  This file is part of CFEngine 3 - written and maintained by Northern.tech AS.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  To the extent this program is licensed as part of the Enterprise
+  versions of CFEngine, the applicable Commercial Open Source License
+  (COSL) may apply to this file if you as a licensee so wish it. See
+  included file COSL.txt.
+*/
+
+#ifndef CFENGINE_WORK_STEALING_DEQUE_H
+#define CFENGINE_WORK_STEALING_DEQUE_H
+
+#include <stdbool.h>
+#include <stddef.h>     // size_t
+
+/*
+ * Chase-Lev work-stealing deque (with the memory orderings of Le et al.,
+ * "Correct and Efficient Work-Stealing for Weak Memory Models").
+ *
+ * One thread, the owner, pushes and pops items at the bottom like a stack,
+ * without any atomic read-modify-write except when taking the last item.
+ * Any other thread may steal the oldest item from the top with a single
+ * compare-and-swap. Unlike ThreadedDeque there is no lock at all.
+ *
+ * The deque grows as needed. Replaced buffers can still be read by a
+ * concurrent thief, so they are only freed with the deque.
+ */
+
+typedef struct WSDeque_ WSDeque;
+
+WSDeque *WSDequeNew(size_t initial_capacity);
+
+/**
+  @brief Destroy the deque, the items left in it are not touched.
+  @warning No other thread may be using the deque.
+  */
+void WSDequeDestroy(WSDeque *deque);
+
+/**
+  @brief Push an item to the bottom. Owner only.
+  */
+void WSDequePush(WSDeque *deque, void *item);
+
+/**
+  @brief Pop the most recently pushed item from the bottom. Owner only.
+  @return false if the deque is empty.
+  */
+bool WSDequePop(WSDeque *deque, void **item);
+
+/**
+  @brief Steal the oldest item from the top. Any thread.
+  @return false if the deque is empty or another thread took the item first.
+  */
+bool WSDequeSteal(WSDeque *deque, void **item);
+
+/**
+  @brief Number of items in the deque, only a snapshot.
+  */
+size_t WSDequeCount(const WSDeque *deque);
+
+#endif
@@ -0,0 +1,91 @@
+#include <platform.h>
+
+#include <alloc.h>
+#include <b-tree.h>
+#include <rb-tree.h>
+
+/*
+ * Compares BTree with RBTree on 1M random keys. Not part of "make check",
+ * run with "make benchmarks".
+ */
+
+static double ElapsedMs(const struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e3 +
+        (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+int main()
+{
+    const size_t n_keys = 1000000;
+
+    /* Random order, keys stored directly in the pointers */
+    uintptr_t *keys = xmalloc(n_keys * sizeof(uintptr_t));
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        keys[i] = i + 1;
+    }
+    srand(1);
+    for (size_t i = n_keys - 1; i > 0; i--)
+    {
+        size_t j = ((size_t) rand() * RAND_MAX + rand()) % (i + 1);
+        uintptr_t tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+
+    struct timespec start;
+    double rb_put, rb_get, rb_remove, b_put, b_get, b_remove;
+    volatile uintptr_t sink = 0; /* keeps the lookups from being elided */
+
+    RBTree *rb_tree = RBTreeNew(NULL, NULL, NULL, NULL, NULL, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        RBTreePut(rb_tree, (void *) keys[i], (void *) keys[i]);
+    }
+    rb_put = ElapsedMs(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        sink += (uintptr_t) RBTreeGet(rb_tree, (void *) keys[i]);
+    }
+    rb_get = ElapsedMs(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        RBTreeRemove(rb_tree, (void *) keys[i]);
+    }
+    rb_remove = ElapsedMs(&start);
+    RBTreeDestroy(rb_tree);
+
+    BTree *b_tree = BTreeNew(NULL, NULL, NULL, NULL, NULL, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        BTreePut(b_tree, (void *) keys[i], (void *) keys[i]);
+    }
+    b_put = ElapsedMs(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        sink += (uintptr_t) BTreeGet(b_tree, (void *) keys[i]);
+    }
+    b_get = ElapsedMs(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        BTreeRemove(b_tree, (void *) keys[i]);
+    }
+    b_remove = ElapsedMs(&start);
+    BTreeDestroy(b_tree);
+
+    printf("1M random keys   put        get        remove\n");
+    printf("RBTree      %9.2f ms %9.2f ms %9.2f ms\n", rb_put, rb_get, rb_remove);
+    printf("BTree       %9.2f ms %9.2f ms %9.2f ms\n", b_put, b_get, b_remove);
+
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,234 @@
+#include <test.h>
+#include <b-tree.h>
+#include <rb-tree.h>
+
+#include <alloc.h>
+
+#include <stdlib.h>
+
+static void *_IntCopy(const void *_a)
+{
+    return xmemdup(_a, sizeof(int));
+}
+
+static int _IntCompare(const void *_a, const void *_b)
+{
+    const int *a = _a, *b = _b;
+    return *a - *b;
+}
+
+static BTree *IntTreeNew_(void)
+{
+    return BTreeNew(_IntCopy, _IntCompare, free, _IntCopy, _IntCompare, free);
+}
+
+static void test_new_destroy(void)
+{
+    BTree *t = IntTreeNew_();
+    BTreeDestroy(t);
+}
+
+static void test_put_overwrite(void)
+{
+    BTree *t = IntTreeNew_();
+
+    int a = 42;
+    assert_false(BTreePut(t, &a, &a));
+    int *r = BTreeGet(t, &a);
+    assert_int_equal(a, *r);
+
+    int b = 43;
+    assert_true(BTreePut(t, &a, &b));
+    r = BTreeGet(t, &a);
+    assert_int_equal(b, *r);
+    assert_int_equal(1, BTreeSize(t));
+
+    BTreeDestroy(t);
+}
+
+static void test_put_remove_inorder(void)
+{
+    BTree *t = IntTreeNew_();
+    for (int i = 0; i < 20000; i++)
+    {
+        assert_false(BTreePut(t, &i, &i));
+    }
+    assert_int_equal(20000, BTreeSize(t));
+
+    for (int i = 0; i < 20000; i++)
+    {
+        int *r = BTreeGet(t, &i);
+        assert_int_equal(i, *r);
+    }
+
+    for (int i = 0; i < 20000; i++)
+    {
+        assert_true(BTreeRemove(t, &i));
+        assert_false(BTreeRemove(t, &i));
+        assert_true(BTreeGet(t, &i) == NULL);
+    }
+    assert_int_equal(0, BTreeSize(t));
+
+    BTreeDestroy(t);
+}
+
+static void test_iterate_empty(void)
+{
+    BTree *t = IntTreeNew_();
+
+    BTreeIterator *it = BTreeIteratorNew(t);
+    assert_false(BTreeIteratorNext(it, NULL, NULL));
+    BTreeIteratorDestroy(it);
+
+    BTreeDestroy(t);
+}
+
+static void test_iterate(void)
+{
+    BTree *t = IntTreeNew_();
+
+    /* Descending, to exercise splits on the left */
+    for (int i = 2999; i >= 0; i--)
+    {
+        BTreePut(t, &i, &i);
+    }
+
+    assert_int_equal(3000, BTreeSize(t));
+
+    BTreeIterator *it = BTreeIteratorNew(t);
+    for (int i = 0; i < 3000; i++)
+    {
+        int *k = NULL;
+        int *v = NULL;
+        assert_true(BTreeIteratorNext(it, (void **)&k, (void **)&v));
+        assert_int_equal(i, *k);
+        assert_int_equal(i, *v);
+    }
+
+    assert_false(BTreeIteratorNext(it, NULL, NULL));
+    BTreeIteratorDestroy(it);
+
+    BTreeDestroy(t);
+}
+
+/* Compare against RBTree after every few random operations. */
+static void test_put_remove_random(void)
+{
+    BTree *t = IntTreeNew_();
+    RBTree *reference = RBTreeNew(_IntCopy, _IntCompare, free,
+                                  _IntCopy, _IntCompare, free);
+
+    srand(0);
+    for (int op = 0; op < 100000; op++)
+    {
+        int k = rand() % 2000;
+        if (rand() % 3 == 0)
+        {
+            assert_int_equal(RBTreeRemove(reference, &k), BTreeRemove(t, &k));
+        }
+        else
+        {
+            int v = op;
+            assert_int_equal(RBTreePut(reference, &k, &v), BTreePut(t, &k, &v));
+        }
+
+        if (op % 1000 == 0)
+        {
+            assert_int_equal(RBTreeSize(reference), BTreeSize(t));
+
+            RBTreeIterator *rb_it = RBTreeIteratorNew(reference);
+            BTreeIterator *it = BTreeIteratorNew(t);
+            int *rb_k, *rb_v, *b_k, *b_v;
+            while (RBTreeIteratorNext(rb_it, (void **)&rb_k, (void **)&rb_v))
+            {
+                assert_true(BTreeIteratorNext(it, (void **)&b_k, (void **)&b_v));
+                assert_int_equal(*rb_k, *b_k);
+                assert_int_equal(*rb_v, *b_v);
+            }
+            assert_false(BTreeIteratorNext(it, NULL, NULL));
+            BTreeIteratorDestroy(it);
+            RBTreeIteratorDestroy(rb_it);
+        }
+    }
+
+    for (int k = 0; k < 2000; k++)
+    {
+        int *r = BTreeGet(t, &k);
+        int *rb_r = RBTreeGet(reference, &k);
+        assert_true((r == NULL) == (rb_r == NULL));
+        if (r != NULL)
+        {
+            assert_int_equal(*rb_r, *r);
+        }
+    }
+
+    RBTreeDestroy(reference);
+    BTreeDestroy(t);
+}
+
+static void test_clear(void)
+{
+    BTree *t = IntTreeNew_();
+    for (int i = 0; i < 20000; i++)
+    {
+        BTreePut(t, &i, &i);
+    }
+
+    int k = 5;
+
+    assert_true(BTreeGet(t, &k) != NULL);
+    assert_int_equal(20000, BTreeSize(t));
+
+    BTreeClear(t);
+
+    assert_true(BTreeGet(t, &k) == NULL);
+    assert_int_equal(0, BTreeSize(t));
+
+    for (int i = 0; i < 20000; i++)
+    {
+        BTreePut(t, &i, &i);
+    }
+
+    assert_true(BTreeGet(t, &k) != NULL);
+    assert_int_equal(20000, BTreeSize(t));
+
+    BTreeDestroy(t);
+}
+
+static void test_equal(void)
+{
+    BTree *a = IntTreeNew_();
+    BTree *b = IntTreeNew_();
+    for (int i = 0; i < 20000; i++)
+    {
+        BTreePut(a, &i, &i);
+        BTreePut(b, &i, &i);
+    }
+
+    assert_true(BTreeEqual(a, b));
+
+    int k = 7, v = 8;
+    BTreePut(b, &k, &v);
+    assert_false(BTreeEqual(a, b));
+
+    BTreeDestroy(a);
+    BTreeDestroy(b);
+}
+
+int main()
+{
+    const UnitTest tests[] =
+    {
+        unit_test(test_new_destroy),
+        unit_test(test_put_overwrite),
+        unit_test(test_put_remove_inorder),
+        unit_test(test_iterate_empty),
+        unit_test(test_iterate),
+        unit_test(test_put_remove_random),
+        unit_test(test_clear),
+        unit_test(test_equal),
+    };
+
+    PRINT_TEST_BANNER();
+    return run_tests(tests);
+}
@@ -0,0 +1,95 @@
+#include <test.h>
+
+#include <bloom_filter.c>
+#include <string_lib.h>
+#include <alloc.h>
+
+static void test_no_false_negatives(void)
+{
+    BloomFilter *filter = BloomFilterNew(StringHash_untyped, 10000, 0.01);
+
+    char key[32];
+    for (int i = 0; i < 10000; i++)
+    {
+        snprintf(key, sizeof(key), "host%d.example.com", i);
+        BloomFilterAdd(filter, key);
+    }
+    for (int i = 0; i < 10000; i++)
+    {
+        snprintf(key, sizeof(key), "host%d.example.com", i);
+        assert_true(BloomFilterMayContain(filter, key));
+    }
+
+    BloomFilterClear(filter);
+    assert_false(BloomFilterMayContain(filter, "host0.example.com"));
+
+    BloomFilterDestroy(filter);
+}
+
+static void test_false_positive_rate(void)
+{
+    /* The smaller rates need more than 7 hashes */
+    const double rates[] = { 0.1, 0.01, 0.001, 1e-4, 1e-5 };
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+    {
+        BloomFilter *filter = BloomFilterNew(StringHash_untyped, 50000, rates[r]);
+
+        char key[32];
+        for (int i = 0; i < 50000; i++)
+        {
+            snprintf(key, sizeof(key), "in%d", i);
+            BloomFilterAdd(filter, key);
+        }
+
+        size_t false_positives = 0;
+        /* Enough lookups to expect 20 false positives */
+        const size_t lookups = MAX(200000, (size_t) (20 / rates[r]));
+        for (size_t i = 0; i < lookups; i++)
+        {
+            snprintf(key, sizeof(key), "out%zu", i);
+            if (BloomFilterMayContain(filter, key))
+            {
+                false_positives++;
+            }
+        }
+
+        /* Blocked filters are a bit worse than the textbook rate. */
+        const double rate = (double) false_positives / lookups;
+        assert_true(rate < rates[r] * 2);
+
+        BloomFilterDestroy(filter);
+    }
+}
+
+static void test_tiny(void)
+{
+    BloomFilter *filter = BloomFilterNew(StringHash_untyped, 0, 0.5);
+    BloomFilterAdd(filter, "a");
+    assert_true(BloomFilterMayContain(filter, "a"));
+    BloomFilterDestroy(filter);
+}
+
+static void test_block_alignment(void)
+{
+    /* Each block must sit in a single cache line */
+    for (size_t n = 1; n < 100000; n *= 7)
+    {
+        BloomFilter *filter = BloomFilterNew(StringHash_untyped, n, 0.01);
+        assert_int_equal((uintptr_t) filter->bits % 64, 0);
+        BloomFilterDestroy(filter);
+    }
+}
+
+int main()
+{
+    PRINT_TEST_BANNER();
+    const UnitTest tests[] =
+    {
+        unit_test(test_no_false_negatives),
+        unit_test(test_false_positive_rate),
+        unit_test(test_tiny),
+        unit_test(test_block_alignment),
+    };
+
+    return run_tests(tests);
+}
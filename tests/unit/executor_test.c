@@ -0,0 +1,354 @@
+#include <test.h>
+
+#include <cleanup.h>
+#include <executor.h>
+#include <mutex.h>
+
+/* Keeps jobs running until opened */
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool open;
+    size_t n_waiting;
+} Gate;
+
+static Gate GATE = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void GateClose(void)
+{
+    pthread_mutex_lock(&GATE.lock);
+    GATE.open = false;
+    pthread_mutex_unlock(&GATE.lock);
+}
+
+static void GateOpen(void)
+{
+    pthread_mutex_lock(&GATE.lock);
+    GATE.open = true;
+    pthread_cond_broadcast(&GATE.cond);
+    pthread_mutex_unlock(&GATE.lock);
+}
+
+/* Wait until n jobs are stuck at the gate */
+static void GateWaitFor(size_t n)
+{
+    pthread_mutex_lock(&GATE.lock);
+    while (GATE.n_waiting < n)
+    {
+        pthread_mutex_unlock(&GATE.lock);
+        usleep(1000);
+        pthread_mutex_lock(&GATE.lock);
+    }
+    pthread_mutex_unlock(&GATE.lock);
+}
+
+static void *GateJob(void *data)
+{
+    pthread_mutex_lock(&GATE.lock);
+    GATE.n_waiting++;
+    while (!GATE.open)
+    {
+        pthread_cond_wait(&GATE.cond, &GATE.lock);
+    }
+    GATE.n_waiting--;
+    pthread_mutex_unlock(&GATE.lock);
+    return data;
+}
+
+static void *DoubleJob(void *data)
+{
+    return (void *) (2 * (size_t) data);
+}
+
+static void *CountJob(void *data)
+{
+    __atomic_fetch_add((size_t *) data, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void test_submit_get(void)
+{
+    Executor *executor = ExecutorNew(2, 2, 0);
+    Future *futures[100];
+    for (size_t i = 0; i < 100; i++)
+    {
+        futures[i] = ExecutorSubmit(executor, DoubleJob, (void *) i);
+        assert_true(futures[i] != NULL);
+    }
+    for (size_t i = 0; i < 100; i++)
+    {
+        assert_int_equal((size_t) FutureGet(futures[i]), 2 * i);
+        assert_int_equal(FutureGetState(futures[i]), FUTURE_DONE);
+        FutureDestroy(futures[i]);
+    }
+
+    ExecutorStats stats = ExecutorGetStats(executor);
+    assert_int_equal(stats.workers, 2);
+    assert_int_equal(stats.submitted, 100);
+    assert_int_equal(stats.completed, 100);
+    assert_int_equal(stats.queued, 0);
+    assert_int_equal(stats.running, 0);
+    assert_true(stats.queued_max >= 1);
+    assert_true(stats.wait_mean >= 0.0 && stats.wait_mean <= stats.wait_max);
+    assert_true(stats.run_mean >= 0.0 && stats.run_mean <= stats.run_max);
+
+    ExecutorDestroy(executor);
+}
+
+static void test_wait_all(void)
+{
+    Executor *executor = ExecutorNew(3, 3, 0);
+    size_t count = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        /* Fire and forget */
+        FutureDestroy(ExecutorSubmit(executor, CountJob, &count));
+    }
+    assert_true(ExecutorWaitAll(executor, THREAD_BLOCK_INDEFINITELY));
+    assert_int_equal(count, 1000);
+    assert_int_equal(ExecutorGetStats(executor).completed, 1000);
+
+    /* Nothing to wait for */
+    assert_true(ExecutorWaitAll(executor, 0));
+
+    ExecutorDestroy(executor);
+}
+
+static void test_cancel(void)
+{
+    Executor *executor = ExecutorNew(1, 1, 0);
+    GateClose();
+
+    Future *running = ExecutorSubmit(executor, GateJob, NULL);
+    GateWaitFor(1);
+
+    size_t count = 0;
+    Future *queued[10];
+    for (int i = 0; i < 10; i++)
+    {
+        queued[i] = ExecutorSubmit(executor, CountJob, &count);
+    }
+    assert_int_equal(ExecutorGetStats(executor).queued, 10);
+    assert_int_equal(ExecutorGetStats(executor).running, 1);
+
+    assert_false(FutureWait(running, 0));
+    assert_false(ExecutorWaitAll(executor, 0));
+
+    /* Only queued jobs can be cancelled */
+    assert_false(FutureCancel(running));
+    assert_int_equal(FutureGetState(running), FUTURE_RUNNING);
+    assert_true(FutureCancel(queued[3]));
+    assert_true(FutureCancel(queued[3]));
+    assert_int_equal(FutureGetState(queued[3]), FUTURE_CANCELLED);
+    assert_true(FutureWait(queued[3], 0));
+    assert_true(FutureGet(queued[3]) == NULL);
+
+    /* Cancelled and still queued futures may be destroyed right away, the
+     * latter stays queued */
+    FutureDestroy(queued[3]);
+    FutureDestroy(queued[4]);
+
+    assert_int_equal(ExecutorCancelAll(executor), 9);
+    for (int i = 0; i < 10; i++)
+    {
+        if (i != 3 && i != 4)
+        {
+            assert_int_equal(FutureGetState(queued[i]), FUTURE_CANCELLED);
+            FutureDestroy(queued[i]);
+        }
+    }
+
+    GateOpen();
+    assert_true(ExecutorWaitAll(executor, THREAD_BLOCK_INDEFINITELY));
+    assert_int_equal(FutureGetState(running), FUTURE_DONE);
+    assert_false(FutureCancel(running));
+    FutureDestroy(running);
+
+    assert_int_equal(count, 0);
+    ExecutorStats stats = ExecutorGetStats(executor);
+    assert_int_equal(stats.submitted, 11);
+    assert_int_equal(stats.completed, 1);
+    assert_int_equal(stats.cancelled, 10);
+
+    ExecutorDestroy(executor);
+}
+
+static void test_elastic(void)
+{
+    Executor *executor = ExecutorNew(0, 4, 1);
+    assert_int_equal(ExecutorGetStats(executor).workers, 0);
+    GateClose();
+
+    /* Threads are started as the jobs queue up, up to the maximum */
+    for (int i = 0; i < 6; i++)
+    {
+        FutureDestroy(ExecutorSubmit(executor, GateJob, NULL));
+    }
+    GateWaitFor(4);
+    ExecutorStats stats = ExecutorGetStats(executor);
+    assert_int_equal(stats.workers, 4);
+    assert_int_equal(stats.running, 4);
+    assert_int_equal(stats.queued, 2);
+
+    GateOpen();
+    assert_true(ExecutorWaitAll(executor, THREAD_BLOCK_INDEFINITELY));
+
+    /* Idle threads exit after the timeout */
+    for (int i = 0; i < 50 && ExecutorGetStats(executor).workers > 0; i++)
+    {
+        usleep(100000);
+    }
+    assert_int_equal(ExecutorGetStats(executor).workers, 0);
+
+    /* And come back when needed */
+    size_t count = 0;
+    Future *future = ExecutorSubmit(executor, CountJob, &count);
+    FutureGet(future);
+    FutureDestroy(future);
+    assert_int_equal(count, 1);
+
+    ExecutorDestroy(executor);
+}
+
+static void *ShutdownJob(void *data)
+{
+    ExecutorShutdown(data, false);
+    return data;
+}
+
+static void test_shutdown(void)
+{
+    Executor *executor = ExecutorNew(2, 2, 0);
+    size_t count = 0;
+
+    /* Jobs queued before shutdown still run */
+    GateClose();
+    FutureDestroy(ExecutorSubmit(executor, GateJob, NULL));
+    FutureDestroy(ExecutorSubmit(executor, GateJob, NULL));
+    GateWaitFor(2);
+    for (int i = 0; i < 10; i++)
+    {
+        FutureDestroy(ExecutorSubmit(executor, CountJob, &count));
+    }
+    GateOpen();
+    ExecutorShutdown(executor, false);
+    assert_int_equal(count, 10);
+    assert_int_equal(ExecutorGetStats(executor).workers, 0);
+
+    assert_true(ExecutorSubmit(executor, CountJob, &count) == NULL);
+    ExecutorShutdown(executor, true);
+    ExecutorDestroy(executor);
+
+    /* From within a job */
+    executor = ExecutorNew(1, 1, 0);
+    Future *future = ExecutorSubmit(executor, ShutdownJob, executor);
+    assert_true(FutureGet(future) == executor);
+    FutureDestroy(future);
+    assert_true(ExecutorSubmit(executor, CountJob, &count) == NULL);
+    ExecutorDestroy(executor);
+}
+
+static void *OpenWhenCancelled(void *data)
+{
+    while (FutureGetState(data) != FUTURE_CANCELLED)
+    {
+        usleep(1000);
+    }
+    GateOpen();
+    return NULL;
+}
+
+static void test_cleanup(void)
+{
+    Executor *executor = ExecutorNew(1, 1, 0);
+    GateClose();
+
+    Future *running = ExecutorSubmit(executor, GateJob, NULL);
+    GateWaitFor(1);
+    size_t count = 0;
+    Future *queued = ExecutorSubmit(executor, CountJob, &count);
+
+    /* The cleanup waits for the running job, open the gate meanwhile */
+    pthread_t opener;
+    assert_int_equal(pthread_create(&opener, NULL, OpenWhenCancelled,
+                                    queued), 0);
+    CallCleanupFunctions();
+    pthread_join(opener, NULL);
+
+    assert_int_equal(FutureGetState(running), FUTURE_DONE);
+    assert_int_equal(FutureGetState(queued), FUTURE_CANCELLED);
+    assert_int_equal(count, 0);
+    assert_true(ExecutorSubmit(executor, CountJob, &count) == NULL);
+
+    FutureDestroy(running);
+    FutureDestroy(queued);
+    ExecutorDestroy(executor);
+
+    /* Executors created after a cleanup run are shut down by the next one */
+    executor = ExecutorNew(1, 1, 0);
+    CallCleanupFunctions();
+    assert_true(ExecutorSubmit(executor, CountJob, &count) == NULL);
+    ExecutorDestroy(executor);
+}
+
+/* Waits for the cleanup to shut its own executor down, then creates and
+ * destroys executors while the cleanup is waiting for it */
+static void *ExecutorsDuringCleanupJob(void *data)
+{
+    Executor *self = data;
+    size_t count = 0;
+    Future *probe;
+    while ((probe = ExecutorSubmit(self, CountJob, &count)) != NULL)
+    {
+        FutureCancel(probe);
+        FutureDestroy(probe);
+        usleep(1000);
+    }
+
+    ExecutorDestroy(ExecutorNew(0, 1, 0));
+    return ExecutorNew(0, 1, 0);
+}
+
+static void test_cleanup_with_running_job(void)
+{
+    Executor *executor = ExecutorNew(1, 1, 0);
+    Future *future = ExecutorSubmit(executor, ExecutorsDuringCleanupJob,
+                                    executor);
+    while (FutureGetState(future) != FUTURE_RUNNING)
+    {
+        usleep(1000);
+    }
+
+    CallCleanupFunctions();
+    assert_int_equal(FutureGetState(future), FUTURE_DONE);
+
+    /* Created by the job during the cleanup, and shut down by it too */
+    Executor *created = FutureGet(future);
+    size_t count = 0;
+    assert_true(ExecutorSubmit(created, CountJob, &count) == NULL);
+
+    FutureDestroy(future);
+    ExecutorDestroy(created);
+    ExecutorDestroy(executor);
+}
+
+int main()
+{
+    PRINT_TEST_BANNER();
+    const UnitTest tests[] =
+    {
+        unit_test(test_submit_get),
+        unit_test(test_wait_all),
+        unit_test(test_cancel),
+        unit_test(test_elastic),
+        unit_test(test_shutdown),
+        unit_test(test_cleanup),
+        unit_test(test_cleanup_with_running_job),
+    };
+
+    return run_tests(tests);
+}
@@ -2,7 +2,9 @@
 
 #include <unistd.h>
 #include <string.h>
+#include <math.h>
 #include <string_lib.h>
+#include <alloc.h>
 #include <hash.h>
 #include <openssl/rsa.h>
 #include <openssl/evp.h>
@@ -263,6 +265,97 @@ static void test_StringCopyTruncateAndHashIfNecessary(void)
     assert_true(StringEqual(buf, "#MD5=9e107d9d372bb6826bd81d3542a419d6"));
 }
 
+/*
+ * StringHash() tests: these don't need the OpenSSL fixtures above.
+ */
+
+static void test_StringHashN(void)
+{
+    const char *strs[] = {
+        "", "a", "ab", "abc", "abcd", "abcdefg", "abcdefgh", "abcdefghijklmno",
+        "abcdefghijklmnop", "abcdefghijklmnopq",
+        "/var/cfengine/inputs/promises.cf",
+        "The quick brown fox jumps over the lazy dog, again and again and again",
+    };
+
+    for (size_t i = 0; i < sizeof(strs) / sizeof(strs[0]); i++)
+    {
+        const size_t len = strlen(strs[i]);
+        assert_int_equal(StringHash(strs[i], 0), StringHashN(strs[i], len, 0));
+        assert_int_equal(StringHash(strs[i], 42), StringHashN(strs[i], len, 42));
+        assert_true(StringHash(strs[i], 0) != StringHash(strs[i], 1));
+
+        /* Every prefix hashes differently from the whole string. */
+        for (size_t j = 0; j < len; j++)
+        {
+            assert_true(StringHashN(strs[i], j, 0) != StringHash(strs[i], 0));
+        }
+    }
+
+    /* Length is part of the hash, embedded NUL bytes are significant. */
+    const char nuls[] = "ab\0\0\0";
+    assert_true(StringHashN(nuls, 2, 0) != StringHashN(nuls, 3, 0));
+    assert_true(StringHashN(nuls, 3, 0) != StringHashN(nuls, 4, 0));
+}
+
+/* Distribution of typical (very similar) keys over the buckets, using the
+ * low bits like HashMap does. */
+static void test_StringHash_distribution(void)
+{
+    const size_t n_buckets = 4096;
+    const size_t n_keys = 100000;
+    const char *const formats[] = {
+        "%zu", "key_%zu", "/var/cfengine/inputs/services/file%zu.cf",
+        "host%zu.example.com",
+    };
+
+    size_t *buckets = xcalloc(n_buckets, sizeof(size_t));
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        memset(buckets, 0, n_buckets * sizeof(size_t));
+        for (size_t i = 0; i < n_keys; i++)
+        {
+            char key[128];
+            snprintf(key, sizeof(key), formats[f], i);
+            buckets[StringHash(key, 0) & (n_buckets - 1)]++;
+        }
+
+        /* Pearson's chi-squared against the uniform distribution; for a good
+         * hash it is n_buckets - 1 with standard deviation sqrt(2 * n_buckets) */
+        const double expected = (double) n_keys / n_buckets;
+        double chi2 = 0.0;
+        for (size_t i = 0; i < n_buckets; i++)
+        {
+            const double d = buckets[i] - expected;
+            chi2 += (d * d) / expected;
+        }
+        assert_true(chi2 < n_buckets + 6 * sqrt(2.0 * n_buckets));
+    }
+    free(buckets);
+
+    /* Avalanche: flipping any input bit flips about half of the output bits. */
+    char key[] = "/etc/passwd:root:x:0:0";
+    const size_t len = strlen(key);
+    size_t flipped = 0, samples = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            const unsigned int orig = StringHashN(key, len, 0);
+            key[i] ^= (1 << bit);
+            const unsigned int h = StringHashN(key, len, 0);
+            key[i] ^= (1 << bit);
+            for (unsigned int diff = orig ^ h; diff != 0; diff &= diff - 1)
+            {
+                flipped++;
+            }
+            samples++;
+        }
+    }
+    const double avg = (double) flipped / samples;
+    assert_true(avg > 14.0 && avg < 18.0);
+}
+
 /*
  * Main routine
  * Notice the calls to both setup and teardown.
@@ -279,6 +372,8 @@ int main()
         unit_test(test_HashCopy),
         unit_test(test_HashesMatch),
         unit_test(test_StringCopyTruncateAndHashIfNecessary),
+        unit_test(test_StringHashN),
+        unit_test(test_StringHash_distribution),
     };
     int result = run_tests(tests);
     tests_teardown();
@@ -29,6 +29,15 @@ void testDestroyer(void *element) {
     free (s);
 }
 
+static void noopDestroyer(ARG_UNUSED void *element)
+{
+}
+
+static void testDestroyerQuiet(void *element)
+{
+    free(element);
+}
+
 static void test_destroyer(void)
 {
     List *list = NULL;
@@ -776,6 +785,142 @@ static void test_mutableIterator(void)
     assert_int_equal(0, ListDestroy(&list));
 }
 
+/* Enough elements to span several node chunks, with node reuse. */
+static void test_longList(void)
+{
+    List *list = ListNew(NULL, NULL, noopDestroyer);
+    for (intptr_t i = 1; i <= 5000; i++)
+    {
+        assert_int_equal(0, ListAppend(list, (void *) (5000 + i)));
+        assert_int_equal(0, ListPrepend(list, (void *) (5001 - i)));
+    }
+    assert_int_equal(10000, ListCount(list));
+
+    // Replace every multiple of 3 by its negation, through the mutable iterator
+    ListMutableIterator *mutable = ListMutableIteratorGet(list);
+    assert_true(mutable != NULL);
+    int r = ListMutableIteratorFirst(mutable);
+    while (r == 0)
+    {
+        intptr_t value = (intptr_t) ListMutableIteratorData(mutable);
+        if (value % 3 == 0)
+        {
+            assert_int_equal(0, ListMutableIteratorPrepend(mutable, (void *) -value));
+            // Moves to the next element, the last one is not a multiple of 3
+            assert_int_equal(0, ListMutableIteratorRemove(mutable));
+        }
+        else
+        {
+            r = ListMutableIteratorNext(mutable);
+        }
+    }
+    assert_int_equal(0, ListMutableIteratorRelease(&mutable));
+    assert_int_equal(10000, ListCount(list));
+
+    // Reuses the removed nodes
+    for (intptr_t i = 10001; i <= 12000; i++)
+    {
+        assert_int_equal(0, ListAppend(list, (void *) i));
+    }
+
+    ListIterator *iterator = ListIteratorGet(list);
+    intptr_t expected = 1;
+    for (r = ListIteratorFirst(iterator); r == 0; r = ListIteratorNext(iterator))
+    {
+        intptr_t value = (intptr_t) ListIteratorData(iterator);
+        if (expected <= 10000 && expected % 3 == 0)
+        {
+            assert_int_equal(-expected, value);
+        }
+        else
+        {
+            assert_int_equal(expected, value);
+        }
+        expected++;
+    }
+    assert_int_equal(12001, expected);
+    assert_int_equal(0, ListIteratorDestroy(&iterator));
+
+    assert_int_equal(0, ListDestroy(&list));
+}
+
+static void test_longListCopyOnWrite(void)
+{
+    List *list = ListNew(compareFunction, copyFunction, testDestroyerQuiet);
+    char buffer[32];
+    for (int i = 0; i < 3000; i++)
+    {
+        snprintf(buffer, sizeof(buffer), "%d", i);
+        assert_int_equal(0, ListAppend(list, xstrdup(buffer)));
+    }
+
+    List *copy = NULL;
+    assert_int_equal(0, ListCopy(list, &copy));
+    assert_int_equal(0, ListRemove(copy, "1500"));
+    assert_int_equal(0, ListAppend(copy, xstrdup("3000")));
+    assert_int_equal(3000, ListCount(list));
+    assert_int_equal(3000, ListCount(copy));
+
+    ListIterator *iterator = ListIteratorGet(list);
+    int i = 0;
+    int r = 0;
+    for (r = ListIteratorFirst(iterator); r == 0; r = ListIteratorNext(iterator))
+    {
+        snprintf(buffer, sizeof(buffer), "%d", i);
+        assert_string_equal(buffer, ListIteratorData(iterator));
+        i++;
+    }
+    assert_int_equal(3000, i);
+    assert_int_equal(0, ListIteratorDestroy(&iterator));
+
+    assert_int_equal(0, ListDestroy(&list));
+    assert_int_equal(0, ListDestroy(&copy));
+}
+
+#define NUM_THREADS 8
+
+static void *CopyOnWriteThread(void *arg)
+{
+    List *origin = arg;
+    for (int round = 0; round < 1000; round++)
+    {
+        List *copy = NULL;
+        assert_int_equal(0, ListCopy(origin, &copy));
+        if (round % 2 == 0)
+        {
+            /* Detaches from origin */
+            assert_int_equal(0, ListAppend(copy, xstrdup("appended")));
+            assert_int_equal(11, ListCount(copy));
+        }
+        assert_int_equal(0, ListDestroy(&copy));
+    }
+    return NULL;
+}
+
+static void test_copyListThreads(void)
+{
+    List *list = ListNew(compareFunction, copyFunction, testDestroyer);
+    for (int i = 0; i < 10; i++)
+    {
+        assert_int_equal(0, ListAppend(list, xstrdup("element")));
+    }
+
+    pthread_t threads[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++)
+    {
+        assert_int_equal(0, pthread_create(&threads[i], NULL,
+                                           CopyOnWriteThread, list));
+    }
+    for (int i = 0; i < NUM_THREADS; i++)
+    {
+        assert_int_equal(0, pthread_join(threads[i], NULL));
+    }
+
+    assert_int_equal(10, ListCount(list));
+    assert_false(RefCountIsShared(list->ref_count));
+    assert_int_equal(0, ListDestroy(&list));
+}
+
 int main()
 {
     PRINT_TEST_BANNER();
@@ -788,6 +933,9 @@ int main()
         , unit_test(test_appendToList)
         , unit_test(test_removeFromList)
         , unit_test(test_copyList)
+        , unit_test(test_copyListThreads)
+        , unit_test(test_longList)
+        , unit_test(test_longListCopyOnWrite)
         , unit_test(test_iterator)
         , unit_test(test_mutableIterator)
     };
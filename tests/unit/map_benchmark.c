@@ -0,0 +1,49 @@
+#include <platform.h>
+
+#include <hash_map_priv.h>
+
+/*
+ * Insert/remove churn on a HashMap, like session tables and per-run caches
+ * do. Not part of "make check", run with "make benchmarks".
+ */
+
+static unsigned int IntPtrHash(const void *key, ARG_UNUSED unsigned int seed)
+{
+    return (unsigned int) ((uintptr_t) key * 2654435761U);
+}
+
+static bool IntPtrEqual(const void *key1, const void *key2)
+{
+    return key1 == key2;
+}
+
+int main()
+{
+    const size_t n_keys = 100000;
+    const size_t window = 10000;
+
+    HashMap *hashmap = HashMapNew(IntPtrHash, IntPtrEqual, NULL, NULL, 128);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < 20; round++)
+    {
+        /* Sliding window: insert key i, remove key i - window */
+        for (uintptr_t i = 1; i <= n_keys; i++)
+        {
+            HashMapInsert(hashmap, (void *) i, (void *) i);
+            if (i > window)
+            {
+                HashMapRemove(hashmap, (void *) (i - window));
+            }
+        }
+        HashMapClear(hashmap);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("HashMap churn (2M inserts, 1.8M removals): %.2f ms\n",
+           (end.tv_sec - start.tv_sec) * 1e3 +
+           (end.tv_nsec - start.tv_nsec) / 1e6);
+
+    HashMapDestroy(hashmap);
+    return 0;
+}
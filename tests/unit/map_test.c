@@ -3,6 +3,9 @@
 #include <array_map_priv.h>
 #include <hash_map_priv.h>
 #include <map.h>
+#include <flat_map.h>
+#include <int_map.h>
+#include <ordered_map.h>
 #include <string_lib.h>
 
 #include <alloc.h>
@@ -807,6 +810,337 @@ static void test_hash_map_key_referenced_in_value(void)
 }
 
 
+TYPED_FLAT_MAP_DECLARE(Int, int64_t, int)
+TYPED_FLAT_MAP_DEFINE(Int, int64_t, int, Int64Hash, Int64Equal,
+                      FLAT_MAP_NOP_DESTROY, FLAT_MAP_NOP_DESTROY)
+
+TYPED_FLAT_MAP_DECLARE(String, char *, char *)
+TYPED_FLAT_MAP_DEFINE(String, char *, char *, StringHash, StringEqual,
+                      free, free)
+
+/* Every key lands in the same home slot, which exercises the probing and the
+ * backward shift deletion. */
+#define ConstInt64Hash(key, seed) ((void) (key), (void) (seed), 0U)
+
+TYPED_FLAT_MAP_DECLARE(Colliding, int64_t, int64_t)
+TYPED_FLAT_MAP_DEFINE(Colliding, int64_t, int64_t, ConstInt64Hash, Int64Equal,
+                      FLAT_MAP_NOP_DESTROY, FLAT_MAP_NOP_DESTROY)
+
+static void test_flat_map_int(void)
+{
+    IntFlatMap *map = IntFlatMapNew();
+    assert_int_equal(IntFlatMapSize(map), 0);
+    assert_true(IntFlatMapGet(map, 1) == NULL);
+
+    for (int64_t i = 0; i < 10000; i++)
+    {
+        assert_false(IntFlatMapInsert(map, i * 3, (int) i));
+    }
+    assert_int_equal(IntFlatMapSize(map), 10000);
+
+    for (int64_t i = 0; i < 30000; i++)
+    {
+        int *value = IntFlatMapGet(map, i);
+        if (i % 3 == 0)
+        {
+            assert_true(value != NULL);
+            assert_int_equal(*value, i / 3);
+        }
+        else
+        {
+            assert_true(value == NULL);
+            assert_false(IntFlatMapHasKey(map, i));
+        }
+    }
+
+    /* Replace */
+    assert_true(IntFlatMapInsert(map, 3, -1));
+    assert_int_equal(*IntFlatMapGet(map, 3), -1);
+    assert_int_equal(IntFlatMapSize(map), 10000);
+
+    /* Remove every other key */
+    for (int64_t i = 0; i < 10000; i += 2)
+    {
+        assert_true(IntFlatMapRemove(map, i * 3));
+        assert_false(IntFlatMapRemove(map, i * 3));
+    }
+    assert_int_equal(IntFlatMapSize(map), 5000);
+    for (int64_t i = 0; i < 10000; i++)
+    {
+        assert_int_equal(IntFlatMapHasKey(map, i * 3), (i % 2) == 1);
+    }
+
+    size_t count = 0;
+    IntFlatMapIterator iter = IntFlatMapIteratorInit(map);
+    IntFlatMapEntry *entry;
+    while ((entry = IntFlatMapIteratorNext(&iter)) != NULL)
+    {
+        assert_true(entry->key % 6 == 3);
+        count++;
+    }
+    assert_int_equal(count, 5000);
+
+    IntFlatMapClear(map);
+    assert_int_equal(IntFlatMapSize(map), 0);
+    assert_false(IntFlatMapHasKey(map, 3));
+
+    IntFlatMapDestroy(map);
+}
+
+static void test_flat_map_string(void)
+{
+    StringFlatMap *map = StringFlatMapNewWithSize(1000);
+    for (int i = 0; i < 1000; i++)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "key%d", i);
+        assert_false(StringFlatMapInsert(map, xstrdup(key), xstrdup(key + 3)));
+    }
+    assert_int_equal(StringFlatMapSize(map), 1000);
+
+    /* Replacing destroys the old key and value. */
+    assert_true(StringFlatMapInsert(map, xstrdup("key7"), xstrdup("seven")));
+    assert_string_equal(*StringFlatMapGet(map, "key7"), "seven");
+    assert_string_equal(*StringFlatMapGet(map, "key999"), "999");
+    assert_true(StringFlatMapGet(map, "key1000") == NULL);
+
+    assert_true(StringFlatMapRemove(map, "key7"));
+    assert_false(StringFlatMapHasKey(map, "key7"));
+    assert_int_equal(StringFlatMapSize(map), 999);
+
+    StringFlatMapDestroy(map);
+}
+
+static void test_flat_map_colliding(void)
+{
+    CollidingFlatMap *map = CollidingFlatMapNew();
+    bool present[200] = { false };
+
+    /* Pseudo-random inserts and removals, checked against a plain array. */
+    unsigned int state = 12345;
+    for (int round = 0; round < 5000; round++)
+    {
+        state = state * 1103515245 + 12345;
+        const int64_t key = (state >> 16) % 200;
+        if ((state >> 8) & 1)
+        {
+            assert_int_equal(CollidingFlatMapInsert(map, key, key * 2),
+                             present[key]);
+            present[key] = true;
+        }
+        else
+        {
+            assert_int_equal(CollidingFlatMapRemove(map, key), present[key]);
+            present[key] = false;
+        }
+
+        size_t expected = 0;
+        for (int64_t i = 0; i < 200; i++)
+        {
+            const int64_t *value = CollidingFlatMapGet(map, i);
+            assert_int_equal(value != NULL, present[i]);
+            if (value != NULL)
+            {
+                assert_int_equal(*value, i * 2);
+                expected++;
+            }
+        }
+        assert_int_equal(CollidingFlatMapSize(map), expected);
+    }
+
+    CollidingFlatMapDestroy(map);
+}
+
+static void test_int_map(void)
+{
+    IntMap *map = IntMapNew(free);
+    assert_int_equal(IntMapSize(map), 0);
+    assert_true(IntMapGet(map, 0) == NULL);
+
+    /* Negative and huge keys, spread far apart. */
+    for (int64_t i = -5000; i < 5000; i++)
+    {
+        const int64_t key = i * INT64_C(1000000007);
+        assert_false(IntMapInsert(map, key, xstrdup("value")));
+    }
+    assert_int_equal(IntMapSize(map), 10000);
+    assert_true(IntMapHasKey(map, -5000 * INT64_C(1000000007)));
+    assert_false(IntMapHasKey(map, 1));
+
+    /* Replacing frees the old value. */
+    assert_true(IntMapInsert(map, 0, xstrdup("zero")));
+    assert_string_equal(IntMapGet(map, 0), "zero");
+    assert_int_equal(IntMapSize(map), 10000);
+
+    assert_true(IntMapRemove(map, 0));
+    assert_false(IntMapRemove(map, 0));
+    assert_true(IntMapGet(map, 0) == NULL);
+
+    size_t count = 0;
+    IntMapIterator i = IntMapIteratorInit(map);
+    int64_t key;
+    void *value;
+    while (IntMapIteratorNext(&i, &key, &value))
+    {
+        assert_true(key % INT64_C(1000000007) == 0);
+        assert_string_equal(value, "value");
+        count++;
+    }
+    assert_int_equal(count, 9999);
+
+    IntMapClear(map);
+    assert_int_equal(IntMapSize(map), 0);
+    IntMapDestroy(map);
+}
+
+static void test_hashmap_reserve(void)
+{
+    HashMap *hashmap = HashMapNew(StringHash_untyped, StringEqual_untyped,
+                                  free, free, HASH_MAP_INIT_SIZE);
+    HashMapReserve(hashmap, 10000);
+    const size_t reserved = hashmap->size;
+    assert_true(reserved * HASH_MAP_MAX_LOAD_FACTOR >= 10000);
+
+    for (int i = 0; i < 10000; i++)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "%d", i);
+        assert_false(HashMapInsert(hashmap, xstrdup(key), xstrdup(key)));
+    }
+    /* No resizing happened */
+    assert_int_equal(hashmap->size, reserved);
+
+    /* Reserving less than what we have is a no-op */
+    HashMapReserve(hashmap, 10);
+    assert_int_equal(hashmap->size, reserved);
+
+    /* Never shrinks below the reserved size */
+    for (int i = 0; i < 10000; i++)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "%d", i);
+        assert_true(HashMapRemove(hashmap, key));
+    }
+    assert_int_equal(hashmap->size, reserved);
+
+    HashMapDestroy(hashmap);
+}
+
+static void test_map_reserve_and_batch(void)
+{
+    Map *map = MapNewWithCapacity(StringHash_untyped, StringEqual_untyped,
+                                  free, free, 3);
+    assert_int_equal(MapSize(map), 0);
+
+    MapKeyValue items[100];
+    for (int i = 0; i < 100; i++)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "%d", i % 90);
+        items[i].key = xstrdup(key);
+        items[i].value = xstrdup(key);
+    }
+    /* 10 duplicate keys */
+    assert_int_equal(MapInsertBatch(map, items, 100), 90);
+    assert_int_equal(MapSize(map), 90);
+    assert_string_equal(MapGet(map, "89"), "89");
+    assert_true(MapGet(map, "90") == NULL);
+
+    MapReserve(map, 1000);
+    assert_int_equal(MapSize(map), 90);
+    assert_true(MapHasKey(map, "0"));
+    MapDestroy(map);
+
+    StringMap *smap = StringMapNew();
+    StringMapReserve(smap, 5000);
+    for (int i = 0; i < 5000; i++)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "%d", i);
+        assert_false(StringMapInsert(smap, xstrdup(key), xstrdup(key)));
+    }
+    assert_int_equal(StringMapSize(smap), 5000);
+    StringMapDestroy(smap);
+}
+
+static void test_ordered_map(void)
+{
+    OrderedMap *map = OrderedMapNew(StringHash_untyped, StringEqual_untyped,
+                                    free, free);
+    assert_int_equal(OrderedMapSize(map), 0);
+
+    /* Insert in reverse order, which is not the hash order. */
+    for (int i = 999; i >= 0; i--)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "%d", i);
+        assert_false(OrderedMapInsert(map, xstrdup(key), xstrdup(key)));
+    }
+    assert_int_equal(OrderedMapSize(map), 1000);
+
+    /* Replacing keeps the position. */
+    assert_true(OrderedMapInsert(map, xstrdup("500"), xstrdup("five hundred")));
+    assert_string_equal(OrderedMapGet(map, "500"), "five hundred");
+
+    /* Remove the even ones, then re-insert "0" which goes to the end. */
+    for (int i = 0; i < 1000; i += 2)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "%d", i);
+        assert_true(OrderedMapRemove(map, key));
+        assert_false(OrderedMapRemove(map, key));
+        assert_false(OrderedMapHasKey(map, key));
+    }
+    assert_false(OrderedMapInsert(map, xstrdup("0"), xstrdup("zero")));
+    assert_int_equal(OrderedMapSize(map), 501);
+
+    OrderedMapIterator i = OrderedMapIteratorInit(map);
+    MapKeyValue *item;
+    int expected = 999;
+    while ((item = OrderedMapIteratorNext(&i)) != NULL)
+    {
+        if (expected < 0)
+        {
+            assert_string_equal(item->key, "0");
+            assert_string_equal(item->value, "zero");
+            expected = -10;
+            continue;
+        }
+        assert_int_equal(atoi(item->key), expected);
+        expected -= 2;
+    }
+    assert_int_equal(expected, -10);
+
+    OrderedMapClear(map);
+    assert_int_equal(OrderedMapSize(map), 0);
+    assert_true(OrderedMapGet(map, "1") == NULL);
+    i = OrderedMapIteratorInit(map);
+    assert_true(OrderedMapIteratorNext(&i) == NULL);
+
+    OrderedMapDestroy(map);
+}
+
+static void test_ordered_map_churn(void)
+{
+    /* Degenerate hash function and lots of removals re-using the index. */
+    OrderedMap *map = OrderedMapNew(ConstHash, StringEqual_untyped, free, NULL);
+    for (int round = 0; round < 2000; round++)
+    {
+        char key[16];
+        snprintf(key, sizeof(key), "%d", round % 37);
+        if (OrderedMapHasKey(map, key))
+        {
+            assert_true(OrderedMapRemove(map, key));
+        }
+        else
+        {
+            assert_false(OrderedMapInsert(map, xstrdup(key), map));
+        }
+    }
+    assert_true(OrderedMapSize(map) <= 37);
+    OrderedMapDestroy(map);
+}
+
 int main()
 {
     PRINT_TEST_BANNER();
@@ -835,6 +1169,14 @@ int main()
         unit_test(test_array_map_iterator),
         unit_test(test_hash_map_key_referenced_in_value),
         unit_test(test_iterate_jumbo),
+        unit_test(test_hashmap_reserve),
+        unit_test(test_map_reserve_and_batch),
+        unit_test(test_flat_map_int),
+        unit_test(test_flat_map_string),
+        unit_test(test_flat_map_colliding),
+        unit_test(test_int_map),
+        unit_test(test_ordered_map),
+        unit_test(test_ordered_map_churn),
 #ifndef _AIX
         unit_test(test_insert_jumbo_more),
 #endif
@@ -0,0 +1,170 @@
+#include <test.h>
+
+#include <alloc.h>
+#include <mutex.h>
+#include <mpmc_queue.h>
+#include <time.h>
+
+static void test_push_pop(void)
+{
+    MPMCQueue *queue = MPMCQueueNew(3, free);
+    assert_int_equal(MPMCQueueCapacity(queue), 4);
+    assert_int_equal(MPMCQueueCount(queue), 0);
+
+    void *item;
+    assert_false(MPMCQueueTryPop(queue, &item));
+    assert_false(MPMCQueuePop(queue, &item, 0));
+
+    /* Several laps around the ring */
+    for (int lap = 0; lap < 3; lap++)
+    {
+        assert_true(MPMCQueueTryPush(queue, xstrdup("1")));
+        assert_true(MPMCQueueTryPush(queue, xstrdup("2")));
+        assert_true(MPMCQueuePush(queue, xstrdup("3"), 0));
+        assert_true(MPMCQueuePush(queue, xstrdup("4"), 0));
+        assert_int_equal(MPMCQueueCount(queue), 4);
+
+        char *extra = xstrdup("5");
+        assert_false(MPMCQueueTryPush(queue, extra));
+        assert_false(MPMCQueuePush(queue, extra, 0));
+        free(extra);
+
+        for (int i = 1; i <= 4; i++)
+        {
+            char *str;
+            assert_true(MPMCQueuePop(queue, (void **) &str, 0));
+            assert_int_equal(atoi(str), i);
+            free(str);
+        }
+        assert_int_equal(MPMCQueueCount(queue), 0);
+    }
+
+    /* Left over items are destroyed with the queue */
+    MPMCQueueTryPush(queue, xstrdup("left"));
+    MPMCQueueDestroy(queue);
+}
+
+static void test_pop_timeout(void)
+{
+    MPMCQueue *queue = MPMCQueueNew(2, NULL);
+
+    void *item;
+    time_t start = time(NULL);
+    assert_false(MPMCQueuePop(queue, &item, 1));
+    assert_true(time(NULL) - start >= 1);
+
+    assert_true(MPMCQueuePush(queue, queue, 1));
+    assert_true(MPMCQueuePush(queue, queue, 1));
+    assert_false(MPMCQueuePush(queue, queue, 1));
+
+    MPMCQueueDestroy(queue);
+}
+
+#define N_PRODUCERS 4
+#define N_CONSUMERS 4
+#define N_ITEMS_PER_PRODUCER 50000
+
+typedef struct
+{
+    MPMCQueue *queue;
+    size_t first;
+} ProducerArgs;
+
+typedef struct
+{
+    MPMCQueue *queue;
+    unsigned char *seen;
+    size_t popped;
+} ConsumerArgs;
+
+static void *Producer(void *data)
+{
+    ProducerArgs *args = data;
+    for (size_t i = 0; i < N_ITEMS_PER_PRODUCER; i++)
+    {
+        /* +1 as NULL is the end marker */
+        MPMCQueuePush(args->queue, (void *) (args->first + i + 1),
+                      THREAD_BLOCK_INDEFINITELY);
+    }
+    return NULL;
+}
+
+static void *Consumer(void *data)
+{
+    ConsumerArgs *args = data;
+    for (;;)
+    {
+        void *item;
+        MPMCQueuePop(args->queue, &item, THREAD_BLOCK_INDEFINITELY);
+        if (item == NULL)
+        {
+            return NULL;
+        }
+        __atomic_fetch_add(&args->seen[(size_t) item - 1], 1, __ATOMIC_RELAXED);
+        args->popped++;
+    }
+}
+
+static void test_concurrent(void)
+{
+    /* Small capacity, so that both producers and consumers have to wait */
+    MPMCQueue *queue = MPMCQueueNew(8, NULL);
+    unsigned char *seen = xcalloc(N_PRODUCERS * N_ITEMS_PER_PRODUCER, 1);
+
+    pthread_t producers[N_PRODUCERS];
+    ProducerArgs producer_args[N_PRODUCERS];
+    pthread_t consumers[N_CONSUMERS];
+    ConsumerArgs consumer_args[N_CONSUMERS];
+
+    for (int i = 0; i < N_CONSUMERS; i++)
+    {
+        consumer_args[i] = (ConsumerArgs) { queue, seen, 0 };
+        assert_int_equal(pthread_create(&consumers[i], NULL, Consumer,
+                                        &consumer_args[i]), 0);
+    }
+    for (int i = 0; i < N_PRODUCERS; i++)
+    {
+        producer_args[i] = (ProducerArgs) { queue, i * N_ITEMS_PER_PRODUCER };
+        assert_int_equal(pthread_create(&producers[i], NULL, Producer,
+                                        &producer_args[i]), 0);
+    }
+
+    for (int i = 0; i < N_PRODUCERS; i++)
+    {
+        pthread_join(producers[i], NULL);
+    }
+    for (int i = 0; i < N_CONSUMERS; i++)
+    {
+        MPMCQueuePush(queue, NULL, THREAD_BLOCK_INDEFINITELY);
+    }
+
+    size_t popped = 0;
+    for (int i = 0; i < N_CONSUMERS; i++)
+    {
+        pthread_join(consumers[i], NULL);
+        popped += consumer_args[i].popped;
+    }
+
+    assert_int_equal(popped, N_PRODUCERS * N_ITEMS_PER_PRODUCER);
+    for (size_t i = 0; i < N_PRODUCERS * N_ITEMS_PER_PRODUCER; i++)
+    {
+        assert_int_equal(seen[i], 1);
+    }
+    assert_int_equal(MPMCQueueCount(queue), 0);
+
+    free(seen);
+    MPMCQueueDestroy(queue);
+}
+
+int main()
+{
+    PRINT_TEST_BANNER();
+    const UnitTest tests[] =
+    {
+        unit_test(test_push_pop),
+        unit_test(test_pop_timeout),
+        unit_test(test_concurrent),
+    };
+
+    return run_tests(tests);
+}
@@ -0,0 +1,339 @@
+#include <test.h>
+
+#include <parallel.c>
+
+#define N_ITEMS 10000
+
+static void CountRange(size_t from, size_t to, void *data)
+{
+    int *counts = data;
+    for (size_t i = from; i < to; i++)
+    {
+        __atomic_fetch_add(&counts[i], 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void test_parallel_for(void)
+{
+    const size_t chunk_sizes[] = { 0, 1, 7, 100, N_ITEMS, 2 * N_ITEMS };
+    int *counts = xcalloc(N_ITEMS, sizeof(int));
+
+    for (size_t c = 0; c < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); c++)
+    {
+        memset(counts, 0, N_ITEMS * sizeof(int));
+        ParallelFor(10, N_ITEMS, chunk_sizes[c], CountRange, counts);
+
+        for (size_t i = 0; i < N_ITEMS; i++)
+        {
+            assert_int_equal(counts[i], (i < 10) ? 0 : 1);
+        }
+    }
+
+    /* Empty range, the callback must not be called */
+    ParallelFor(5, 5, 0, CountRange, NULL);
+
+    free(counts);
+}
+
+static void NestedRange(size_t from, size_t to, void *data)
+{
+    int *counts = data;
+    for (size_t i = from; i < to; i++)
+    {
+        /* Runs on the calling thread since the pool is busy */
+        ParallelFor(i * 10, (i + 1) * 10, 0, CountRange, counts);
+    }
+}
+
+static void test_parallel_for_nested(void)
+{
+    int *counts = xcalloc(N_ITEMS, sizeof(int));
+
+    ParallelFor(0, N_ITEMS / 10, 3, NestedRange, counts);
+    for (size_t i = 0; i < N_ITEMS; i++)
+    {
+        assert_int_equal(counts[i], 1);
+    }
+
+    free(counts);
+}
+
+static void ShutdownRange(size_t from, size_t to, void *data)
+{
+    if (from == 0)
+    {
+        /* As if the loop body called FatalError(), must not deadlock */
+        PoolShutdown();
+    }
+    CountRange(from, to, data);
+}
+
+static void test_parallel_for_cleanup_in_loop(void)
+{
+    int *counts = xcalloc(N_ITEMS, sizeof(int));
+
+    ParallelFor(0, N_ITEMS, 100, ShutdownRange, counts);
+    for (size_t i = 0; i < N_ITEMS; i++)
+    {
+        assert_int_equal(counts[i], 1);
+    }
+
+    /* The pool is still there */
+    assert_int_equal(ParallelThreadCount(), 4);
+
+    free(counts);
+}
+
+static void test_parallel_for_after_fork(void)
+{
+    int *counts = xcalloc(N_ITEMS, sizeof(int));
+    ParallelFor(0, N_ITEMS, 0, CountRange, counts);
+
+    pid_t pid = fork();
+    assert_true(pid >= 0);
+    if (pid == 0)
+    {
+        /* The workers are gone in the child, the loop must still finish */
+        alarm(10);
+        memset(counts, 0, N_ITEMS * sizeof(int));
+        ParallelFor(0, N_ITEMS, 0, CountRange, counts);
+        for (size_t i = 0; i < N_ITEMS; i++)
+        {
+            if (counts[i] != 1)
+            {
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+
+    int status;
+    assert_int_equal(waitpid(pid, &status, 0), pid);
+    assert_true(WIFEXITED(status));
+    assert_int_equal(WEXITSTATUS(status), 0);
+
+    free(counts);
+}
+
+static Seq *NumberSeq(size_t n)
+{
+    Seq *seq = SeqNew(n, free);
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t *item = xmalloc(sizeof(size_t));
+        *item = i;
+        SeqAppend(seq, item);
+    }
+    return seq;
+}
+
+static void *Square(void *item, void *data)
+{
+    assert_true(data == (void *) Square);
+
+    size_t *result = xmalloc(sizeof(size_t));
+    *result = *(size_t *) item * *(size_t *) item;
+    return result;
+}
+
+static void test_seq_parallel_map(void)
+{
+    Seq *seq = NumberSeq(N_ITEMS);
+    Seq *squares = SeqParallelMap(seq, Square, (void *) Square, free);
+
+    assert_int_equal(SeqLength(squares), N_ITEMS);
+    for (size_t i = 0; i < N_ITEMS; i++)
+    {
+        assert_int_equal(*(size_t *) SeqAt(squares, i), i * i);
+    }
+
+    SeqDestroy(squares);
+
+    Seq *empty = SeqNew(1, NULL);
+    squares = SeqParallelMap(empty, Square, (void *) Square, free);
+    assert_int_equal(SeqLength(squares), 0);
+    SeqDestroy(squares);
+    SeqDestroy(empty);
+
+    SeqDestroy(seq);
+}
+
+static bool IsOdd(void *item)
+{
+    return (*(size_t *) item % 2) == 1;
+}
+
+static void test_seq_parallel_filter(void)
+{
+    Seq *seq = NumberSeq(N_ITEMS);
+
+    assert_true(SeqParallelFilter(seq, IsOdd) == seq);
+    assert_int_equal(SeqLength(seq), N_ITEMS / 2);
+    for (size_t i = 0; i < N_ITEMS / 2; i++)
+    {
+        assert_int_equal(*(size_t *) SeqAt(seq, i), 2 * i);
+    }
+
+    SeqDestroy(seq);
+}
+
+static void *SumReduce(void *accumulator, void *item, ARG_UNUSED void *data)
+{
+    if (accumulator == NULL)
+    {
+        accumulator = xcalloc(1, sizeof(size_t));
+    }
+    *(size_t *) accumulator += *(size_t *) item;
+    return accumulator;
+}
+
+static void *SumCombine(void *left, void *right, ARG_UNUSED void *data)
+{
+    *(size_t *) left += *(size_t *) right;
+    free(right);
+    return left;
+}
+
+/* Not commutative, checks the chunks are combined in order */
+static void *ListReduce(void *accumulator, void *item, ARG_UNUSED void *data)
+{
+    if (accumulator == NULL)
+    {
+        accumulator = SeqNew(16, NULL);
+    }
+    SeqAppend(accumulator, item);
+    return accumulator;
+}
+
+static void *ListCombine(void *left, void *right, ARG_UNUSED void *data)
+{
+    SeqAppendSeq(left, right);
+    SeqSoftDestroy(right);
+    return left;
+}
+
+static void test_seq_parallel_reduce(void)
+{
+    Seq *seq = NumberSeq(N_ITEMS);
+
+    size_t *sum = SeqParallelReduce(seq, SumReduce, SumCombine, NULL);
+    assert_int_equal(*sum, (size_t) N_ITEMS * (N_ITEMS - 1) / 2);
+    free(sum);
+
+    Seq *list = SeqParallelReduce(seq, ListReduce, ListCombine, NULL);
+    assert_int_equal(SeqLength(list), N_ITEMS);
+    for (size_t i = 0; i < N_ITEMS; i++)
+    {
+        assert_true(SeqAt(list, i) == SeqAt(seq, i));
+    }
+    SeqSoftDestroy(list);
+
+    Seq *empty = SeqNew(1, NULL);
+    assert_true(SeqParallelReduce(empty, SumReduce, SumCombine, NULL) == NULL);
+    SeqDestroy(empty);
+
+    SeqDestroy(seq);
+}
+
+typedef struct
+{
+    size_t key;
+    size_t position;
+} SortItem;
+
+static int CompareSortItems(const void *a, const void *b, void *user_data)
+{
+    /* Called from several threads, so only check user_data is passed */
+    assert_true(user_data == (void *) CompareSortItems);
+
+    const SortItem *item_a = a;
+    const SortItem *item_b = b;
+    return (item_a->key > item_b->key) - (item_a->key < item_b->key);
+}
+
+static void test_sort_parallel(void)
+{
+    const size_t chunk_counts[] = { 2, 3, 4, 7, 16 };
+    const size_t max_n = 100000;
+    SortItem *items = xcalloc(max_n, sizeof(SortItem));
+
+    for (size_t c = 0; c < sizeof(chunk_counts) / sizeof(chunk_counts[0]); c++)
+    {
+        for (int pattern = 0; pattern < 4; pattern++)
+        {
+            for (size_t n = chunk_counts[c]; n <= max_n; n = n * 5 + 3)
+            {
+                Seq *seq = SeqNew(n, NULL);
+                for (size_t i = 0; i < n; i++)
+                {
+                    const size_t keys[] = { i, n - i, 42, rand() % 1000 };
+                    items[i] = (SortItem) { keys[pattern], i };
+                    SeqAppend(seq, &items[i]);
+                }
+
+                /* Force the chunk count, the machine may have one CPU */
+                SortParallel(seq, CompareSortItems, CompareSortItems,
+                             chunk_counts[c]);
+
+                bool *seen = xcalloc(n, sizeof(bool));
+                for (size_t i = 0; i < n; i++)
+                {
+                    const SortItem *item = SeqAt(seq, i);
+                    assert_false(seen[item->position]);
+                    seen[item->position] = true;
+                    if (i > 0)
+                    {
+                        const SortItem *prev = SeqAt(seq, i - 1);
+                        assert_true(prev->key <= item->key);
+                    }
+                }
+                free(seen);
+                SeqDestroy(seq);
+            }
+        }
+    }
+
+    /* Through the public function, big enough to use the pool */
+    const size_t n = 4 * SORT_MIN_CHUNK;
+    SortItem *many = xmalloc(n * sizeof(SortItem));
+    Seq *seq = SeqNew(n, NULL);
+    for (size_t i = 0; i < n; i++)
+    {
+        many[i] = (SortItem) { rand(), i };
+        SeqAppend(seq, &many[i]);
+    }
+    SeqSortParallel(seq, CompareSortItems, CompareSortItems);
+    for (size_t i = 1; i < n; i++)
+    {
+        const SortItem *prev = SeqAt(seq, i - 1);
+        assert_true(prev->key <= ((const SortItem *) SeqAt(seq, i))->key);
+    }
+    SeqDestroy(seq);
+    free(many);
+
+    free(items);
+}
+
+int main()
+{
+    /* Use several workers even on a single CPU machine */
+    PoolStart(3);
+    assert_int_equal(ParallelThreadCount(), 4);
+
+    PRINT_TEST_BANNER();
+    const UnitTest tests[] =
+    {
+        unit_test(test_parallel_for),
+        unit_test(test_parallel_for_nested),
+        unit_test(test_parallel_for_cleanup_in_loop),
+        unit_test(test_parallel_for_after_fork),
+        unit_test(test_seq_parallel_map),
+        unit_test(test_seq_parallel_filter),
+        unit_test(test_seq_parallel_reduce),
+        unit_test(test_sort_parallel),
+    };
+
+    int ret = run_tests(tests);
+    CallCleanupFunctions();
+    return ret;
+}
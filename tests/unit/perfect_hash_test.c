@@ -0,0 +1,126 @@
+#include <test.h>
+
+#include <perfect_hash.h>
+#include <logging.h>
+#include <json-utils.h>
+#include <string_lib.h>
+#include <alloc.h>
+
+static void test_lookup(void)
+{
+    const char *const keys[] = {
+        "md5", "sha224", "sha256", NULL, "sha384", "sha512", "", "sha1",
+    };
+    const size_t n_keys = sizeof(keys) / sizeof(keys[0]);
+    StringPerfectHash *table = StringPerfectHashNew(keys, n_keys, false);
+
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        if (keys[i] != NULL)
+        {
+            assert_int_equal(StringPerfectHashLookup(table, keys[i]), i);
+        }
+    }
+    assert_true(StringPerfectHashLookup(table, "MD5") == -1);
+    assert_true(StringPerfectHashLookup(table, "sha") == -1);
+    assert_true(StringPerfectHashLookup(table, "sha2560") == -1);
+    assert_true(StringPerfectHashLookup(table, "a very long string") == -1);
+
+    StringPerfectHashDestroy(table);
+}
+
+static void test_ignore_case_and_duplicates(void)
+{
+    const char *const keys[] = { "Yaml", "CSV", "json", "yaml", "env" };
+    StringPerfectHash *table = StringPerfectHashNew(keys, 5, true);
+
+    /* First of the duplicates wins. */
+    assert_int_equal(StringPerfectHashLookup(table, "yaml"), 0);
+    assert_int_equal(StringPerfectHashLookup(table, "YAML"), 0);
+    assert_int_equal(StringPerfectHashLookup(table, "csv"), 1);
+    assert_int_equal(StringPerfectHashLookup(table, "JsOn"), 2);
+    assert_int_equal(StringPerfectHashLookup(table, "env"), 4);
+    assert_true(StringPerfectHashLookup(table, "xml") == -1);
+
+    StringPerfectHashDestroy(table);
+}
+
+static void test_empty(void)
+{
+    StringPerfectHash *table = StringPerfectHashNew(NULL, 0, false);
+    assert_true(StringPerfectHashLookup(table, "") == -1);
+    assert_true(StringPerfectHashLookup(table, "a") == -1);
+    StringPerfectHashDestroy(table);
+}
+
+static void test_large(void)
+{
+    const size_t n_keys = 5000;
+    char **keys = xmalloc(n_keys * sizeof(char *));
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        xasprintf(&keys[i], "key_%zu", i);
+    }
+
+    StringPerfectHash *table =
+        StringPerfectHashNew((const char *const *) keys, n_keys, false);
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        assert_int_equal(StringPerfectHashLookup(table, keys[i]), i);
+    }
+    assert_true(StringPerfectHashLookup(table, "key_5000") == -1);
+    StringPerfectHashDestroy(table);
+
+    for (size_t i = 0; i < n_keys; i++)
+    {
+        free(keys[i]);
+    }
+    free(keys);
+}
+
+/* Users of the perfect hash tables */
+
+static void test_log_level_from_string(void)
+{
+    assert_int_equal(LogLevelFromString(NULL), LOG_LEVEL_NOTHING);
+    assert_int_equal(LogLevelFromString(""), LOG_LEVEL_NOTHING);
+    assert_int_equal(LogLevelFromString("i"), LOG_LEVEL_INFO);
+    assert_int_equal(LogLevelFromString("inform"), LOG_LEVEL_INFO);
+    assert_int_equal(LogLevelFromString("INFORMATION"), LOG_LEVEL_INFO);
+    assert_int_equal(LogLevelFromString("informations"), LOG_LEVEL_NOTHING);
+    assert_int_equal(LogLevelFromString("crit"), LOG_LEVEL_CRIT);
+    assert_int_equal(LogLevelFromString("Error"), LOG_LEVEL_ERR);
+    assert_int_equal(LogLevelFromString("warn"), LOG_LEVEL_WARNING);
+    assert_int_equal(LogLevelFromString("n"), LOG_LEVEL_NOTICE);
+    assert_int_equal(LogLevelFromString("no"), LOG_LEVEL_NOTICE);
+    assert_int_equal(LogLevelFromString("non"), LOG_LEVEL_NONE);
+    assert_int_equal(LogLevelFromString("verbose"), LOG_LEVEL_VERBOSE);
+    assert_int_equal(LogLevelFromString("d"), LOG_LEVEL_DEBUG);
+    assert_int_equal(LogLevelFromString("x"), LOG_LEVEL_NOTHING);
+}
+
+static void test_data_file_type_from_string(void)
+{
+    assert_int_equal(GetDataFileTypeFromString("yaml"), DATAFILETYPE_YAML);
+    assert_int_equal(GetDataFileTypeFromString("CSV"), DATAFILETYPE_CSV);
+    assert_int_equal(GetDataFileTypeFromString("Env"), DATAFILETYPE_ENV);
+    assert_int_equal(GetDataFileTypeFromString("json"), DATAFILETYPE_JSON);
+    assert_int_equal(GetDataFileTypeFromString("jso"), DATAFILETYPE_UNKNOWN);
+    assert_int_equal(GetDataFileTypeFromString(""), DATAFILETYPE_UNKNOWN);
+}
+
+int main()
+{
+    PRINT_TEST_BANNER();
+    const UnitTest tests[] =
+    {
+        unit_test(test_lookup),
+        unit_test(test_ignore_case_and_duplicates),
+        unit_test(test_empty),
+        unit_test(test_large),
+        unit_test(test_log_level_from_string),
+        unit_test(test_data_file_type_from_string),
+    };
+
+    return run_tests(tests);
+}
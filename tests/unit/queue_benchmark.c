@@ -0,0 +1,208 @@
+#include <platform.h>
+
+#include <mutex.h>
+#include <mpmc_queue.h>
+#include <spsc_queue.h>
+#include <threaded_queue.h>
+
+/*
+ * Transfers through the lock-free queues compared to ThreadedQueue. Not
+ * part of "make check", run with "make benchmarks".
+ */
+
+/* Many-to-many transfer through ThreadedQueue and MPMCQueue */
+
+#define BENCH_THREADS 4
+#define BENCH_ITEMS_PER_THREAD 200000
+
+typedef struct
+{
+    ThreadedQueue *threaded_queue;
+    MPMCQueue *mpmc_queue;
+} BenchQueues;
+
+static void *BenchProducer(void *data)
+{
+    BenchQueues *queues = data;
+    for (size_t i = 1; i <= BENCH_ITEMS_PER_THREAD; i++)
+    {
+        if (queues->mpmc_queue != NULL)
+        {
+            MPMCQueuePush(queues->mpmc_queue, (void *) i,
+                          THREAD_BLOCK_INDEFINITELY);
+        }
+        else
+        {
+            ThreadedQueuePush(queues->threaded_queue, (void *) i);
+        }
+    }
+    return NULL;
+}
+
+static void *BenchConsumer(void *data)
+{
+    BenchQueues *queues = data;
+    for (size_t i = 1; i <= BENCH_ITEMS_PER_THREAD; i++)
+    {
+        void *item;
+        if (queues->mpmc_queue != NULL)
+        {
+            MPMCQueuePop(queues->mpmc_queue, &item, THREAD_BLOCK_INDEFINITELY);
+        }
+        else
+        {
+            ThreadedQueuePop(queues->threaded_queue, &item,
+                             THREAD_BLOCK_INDEFINITELY);
+        }
+    }
+    return NULL;
+}
+
+static double RunBenchmark(BenchQueues *queues)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pthread_t threads[2 * BENCH_THREADS];
+    for (int i = 0; i < BENCH_THREADS; i++)
+    {
+        pthread_create(&threads[2 * i], NULL, BenchConsumer, queues);
+        pthread_create(&threads[2 * i + 1], NULL, BenchProducer, queues);
+    }
+    for (int i = 0; i < 2 * BENCH_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1e3 +
+        (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static void BenchmarkContention(void)
+{
+    BenchQueues queues = { ThreadedQueueNew(1024, NULL), NULL };
+    double threaded_ms = RunBenchmark(&queues);
+    ThreadedQueueDestroy(queues.threaded_queue);
+
+    queues = (BenchQueues) { NULL, MPMCQueueNew(1024, NULL) };
+    double mpmc_ms = RunBenchmark(&queues);
+    MPMCQueueDestroy(queues.mpmc_queue);
+
+    printf("%d producers / %d consumers, %d items: "
+           "ThreadedQueue %.0f ms, MPMCQueue %.0f ms\n",
+           BENCH_THREADS, BENCH_THREADS, BENCH_THREADS * BENCH_ITEMS_PER_THREAD,
+           threaded_ms, mpmc_ms);
+}
+
+/* One-to-one transfer through SPSCQueue, single and batched, and
+ * ThreadedQueue */
+
+#define N_ITEMS 2000000
+#define BATCH 64
+
+typedef struct
+{
+    SPSCQueue *queue;
+    bool batch;
+} TransferArgs;
+
+static void *SPSCProducer(void *data)
+{
+    TransferArgs *args = data;
+    if (args->batch)
+    {
+        void *items[BATCH];
+        for (size_t i = 0; i < N_ITEMS; i += BATCH)
+        {
+            for (size_t j = 0; j < BATCH; j++)
+            {
+                items[j] = (void *) (i + j);
+            }
+            SPSCQueuePushN(args->queue, items, BATCH, THREAD_BLOCK_INDEFINITELY);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < N_ITEMS; i++)
+        {
+            SPSCQueuePush(args->queue, (void *) i, THREAD_BLOCK_INDEFINITELY);
+        }
+    }
+    return NULL;
+}
+
+/* @return milliseconds taken */
+static double TransferSPSC(bool batch)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    TransferArgs args = { SPSCQueueNew(1024, NULL), batch };
+    pthread_t producer;
+    pthread_create(&producer, NULL, SPSCProducer, &args);
+
+    size_t popped = 0;
+    while (popped < N_ITEMS)
+    {
+        void *items[BATCH];
+        popped += SPSCQueuePopN(args.queue, items, batch ? BATCH : 1,
+                                THREAD_BLOCK_INDEFINITELY);
+    }
+
+    pthread_join(producer, NULL);
+    SPSCQueueDestroy(args.queue);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1e3 +
+        (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static void *ThreadedQueueProducer(void *data)
+{
+    for (size_t i = 0; i < N_ITEMS; i++)
+    {
+        ThreadedQueuePush(data, (void *) i);
+    }
+    return NULL;
+}
+
+static double TransferThreadedQueue(void)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    ThreadedQueue *queue = ThreadedQueueNew(1024, NULL);
+    pthread_t producer;
+    pthread_create(&producer, NULL, ThreadedQueueProducer, queue);
+    for (size_t i = 0; i < N_ITEMS; i++)
+    {
+        void *item;
+        ThreadedQueuePop(queue, &item, THREAD_BLOCK_INDEFINITELY);
+    }
+    pthread_join(producer, NULL);
+    ThreadedQueueDestroy(queue);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1e3 +
+        (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+static void BenchmarkTransfer(void)
+{
+    double single_ms = TransferSPSC(false);
+    double batch_ms = TransferSPSC(true);
+    double threaded_ms = TransferThreadedQueue();
+
+    printf("%d items: SPSCQueue %.1f M/s, batches of %d %.1f M/s, "
+           "ThreadedQueue %.1f M/s\n", N_ITEMS,
+           N_ITEMS / single_ms / 1e3, BATCH, N_ITEMS / batch_ms / 1e3,
+           N_ITEMS / threaded_ms / 1e3);
+}
+
+int main()
+{
+    BenchmarkContention();
+    BenchmarkTransfer();
+    return 0;
+}
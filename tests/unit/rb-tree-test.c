@@ -223,6 +223,225 @@ static void test_copy(void)
 }
 
 
+static bool IsEven_(const void *key, ARG_UNUSED const void *value,
+                    ARG_UNUSED void *user_data)
+{
+    return (*(const int *) key % 2) == 0;
+}
+
+static void test_lower_upper_bound(void)
+{
+    RBTree *t = IntTreeNew_();
+    for (int i = 0; i < 100; i += 10)
+    {
+        RBTreePut(t, &i, &i);
+    }
+
+    int k = 20;
+    int *found_key = NULL, *found_value = NULL;
+    assert_true(RBTreeLowerBound(t, &k, (void **)&found_key, (void **)&found_value));
+    assert_int_equal(20, *found_key);
+    assert_int_equal(20, *found_value);
+    assert_true(RBTreeUpperBound(t, &k, (void **)&found_key, NULL));
+    assert_int_equal(30, *found_key);
+
+    k = 25;
+    assert_true(RBTreeLowerBound(t, &k, (void **)&found_key, NULL));
+    assert_int_equal(30, *found_key);
+    assert_true(RBTreeUpperBound(t, &k, (void **)&found_key, NULL));
+    assert_int_equal(30, *found_key);
+
+    k = -5;
+    assert_true(RBTreeLowerBound(t, &k, (void **)&found_key, NULL));
+    assert_int_equal(0, *found_key);
+
+    k = 90;
+    assert_true(RBTreeLowerBound(t, &k, NULL, NULL));
+    assert_false(RBTreeUpperBound(t, &k, NULL, NULL));
+    k = 91;
+    assert_false(RBTreeLowerBound(t, &k, NULL, NULL));
+
+    RBTreeDestroy(t);
+}
+
+static void AssertRange_(const RBTree *t, int from, int to, int first, int last)
+{
+    RBTreeIterator *it = RBTreeIteratorNewRange(t, &from, &to);
+    int *k = NULL;
+    for (int expected = first; expected <= last; expected += 2)
+    {
+        assert_true(RBTreeIteratorNext(it, (void **)&k, NULL));
+        assert_int_equal(expected, *k);
+    }
+    assert_false(RBTreeIteratorNext(it, (void **)&k, NULL));
+    RBTreeIteratorDestroy(it);
+}
+
+static void test_iterate_range(void)
+{
+    RBTree *t = IntTreeNew_();
+
+    /* Even numbers 0..198 */
+    for (int i = 0; i < 200; i += 2)
+    {
+        RBTreePut(t, &i, &i);
+    }
+
+    AssertRange_(t, 10, 20, 10, 18);
+    AssertRange_(t, 11, 21, 12, 20);
+    AssertRange_(t, -100, 4, 0, 2);
+    AssertRange_(t, 190, 1000, 190, 198);
+    AssertRange_(t, 11, 12, 1, 0);      /* empty */
+    AssertRange_(t, 20, 20, 1, 0);      /* empty */
+    AssertRange_(t, 30, 20, 1, 0);      /* empty */
+    AssertRange_(t, 500, 600, 1, 0);    /* empty */
+
+    int to = 6;
+    RBTreeIterator *it = RBTreeIteratorNewTo(t, &to);
+    size_t count = 0;
+    while (RBTreeIteratorNext(it, NULL, NULL))
+    {
+        count++;
+    }
+    assert_int_equal(3, count);
+    RBTreeIteratorDestroy(it);
+
+    int from = 194;
+    it = RBTreeIteratorNewFrom(t, &from);
+    count = 0;
+    while (RBTreeIteratorNext(it, NULL, NULL))
+    {
+        count++;
+    }
+    assert_int_equal(3, count);
+    RBTreeIteratorDestroy(it);
+
+    RBTreeDestroy(t);
+}
+
+static void test_iterate_range_pointer_keys(void)
+{
+    /* Default comparator, keys are the pointers themselves */
+    RBTree *t = RBTreeNew(NULL, NULL, NULL, NULL, NULL, NULL);
+    for (uintptr_t i = 0; i < 10; i++)
+    {
+        RBTreePut(t, (void *) i, (void *) i);
+    }
+
+    /* A range starting at key 0, i.e. NULL */
+    RBTreeIterator *it = RBTreeIteratorNewRange(t, (void *) 0, (void *) 3);
+    void *k;
+    for (uintptr_t expected = 0; expected < 3; expected++)
+    {
+        assert_true(RBTreeIteratorNext(it, &k, NULL));
+        assert_true(k == (void *) expected);
+    }
+    assert_false(RBTreeIteratorNext(it, &k, NULL));
+    RBTreeIteratorDestroy(it);
+
+    /* Ending at NULL is empty */
+    it = RBTreeIteratorNewTo(t, (void *) 0);
+    assert_false(RBTreeIteratorNext(it, &k, NULL));
+    RBTreeIteratorDestroy(it);
+
+    it = RBTreeIteratorNewFrom(t, (void *) 0);
+    size_t count = 0;
+    while (RBTreeIteratorNext(it, NULL, NULL))
+    {
+        count++;
+    }
+    assert_int_equal(10, count);
+    RBTreeIteratorDestroy(it);
+
+    RBTreeDestroy(t);
+}
+
+static void test_bulk_load(void)
+{
+    int data[5000];
+    const void *keys[5000];
+    for (int i = 0; i < 5000; i++)
+    {
+        data[i] = i * 3;
+        keys[i] = &data[i];
+    }
+
+    /* All sizes up to 70 cover every shape of the bottom level */
+    for (size_t count = 0; count <= 70; count++)
+    {
+        RBTree *loaded = IntTreeNew_();
+        assert_true(RBTreeBulkLoad(loaded, keys, keys, count));
+
+        RBTree *put = IntTreeNew_();
+        for (size_t i = 0; i < count; i++)
+        {
+            RBTreePut(put, keys[i], keys[i]);
+        }
+        assert_true(RBTreeEqual(loaded, put));
+
+        RBTreeDestroy(loaded);
+        RBTreeDestroy(put);
+    }
+
+    RBTree *t = IntTreeNew_();
+    assert_true(RBTreeBulkLoad(t, keys, keys, 5000));
+    assert_int_equal(5000, RBTreeSize(t));
+    for (int i = 0; i < 5000; i++)
+    {
+        int *r = RBTreeGet(t, &data[i]);
+        assert_int_equal(data[i], *r);
+    }
+
+    /* The tree stays usable for normal modifications */
+    for (int i = 0; i < 15000; i++)
+    {
+        if (i % 3 == 0)
+        {
+            assert_true(RBTreeRemove(t, &i));
+        }
+        else
+        {
+            assert_false(RBTreePut(t, &i, &i));
+        }
+    }
+    assert_int_equal(10000, RBTreeSize(t));
+    RBTreeDestroy(t);
+
+    /* Unsorted and duplicate keys are rejected */
+    t = IntTreeNew_();
+    const void *unsorted[] = { &data[0], &data[2], &data[1] };
+    assert_false(RBTreeBulkLoad(t, unsorted, unsorted, 3));
+    const void *duplicate[] = { &data[0], &data[1], &data[1] };
+    assert_false(RBTreeBulkLoad(t, duplicate, duplicate, 3));
+    assert_int_equal(0, RBTreeSize(t));
+    RBTreeDestroy(t);
+}
+
+static void test_copy_filter(void)
+{
+    RBTree *a = IntTreeNew_();
+    for (int i = 0; i < 1000; i++)
+    {
+        RBTreePut(a, &i, &i);
+    }
+
+    RBTree *b = RBTreeCopy(a, IsEven_, NULL);
+    assert_int_equal(500, RBTreeSize(b));
+    for (int i = 0; i < 1000; i++)
+    {
+        assert_true((RBTreeGet(b, &i) != NULL) == (i % 2 == 0));
+    }
+
+    RBTree *empty = IntTreeNew_();
+    RBTree *c = RBTreeCopy(empty, NULL, NULL);
+    assert_int_equal(0, RBTreeSize(c));
+
+    RBTreeDestroy(a);
+    RBTreeDestroy(b);
+    RBTreeDestroy(empty);
+    RBTreeDestroy(c);
+}
+
 int main()
 {
     const UnitTest tests[] =
@@ -237,6 +456,11 @@ int main()
         unit_test(test_clear),
         unit_test(test_equal),
         unit_test(test_copy),
+        unit_test(test_lower_upper_bound),
+        unit_test(test_iterate_range),
+        unit_test(test_iterate_range_pointer_keys),
+        unit_test(test_bulk_load),
+        unit_test(test_copy_filter),
     };
 
     PRINT_TEST_BANNER();
@@ -2,14 +2,17 @@
 
 #include <refcount.h>
 
+/* The list of owners is only kept in debug builds */
+#define assert_owners(x) assert_true(!RefCountTracksOwners() || (x))
+
 // Simple initialization test
 static void test_init_destroy_RefCount(void)
 {
     RefCount *refCount = NULL;
     RefCountNew(&refCount);
     assert_int_equal(0, refCount->user_count);
-    assert_true(refCount->last == NULL);
-    assert_true(refCount->users == NULL);
+    assert_owners(refCount->last == NULL);
+    assert_owners(refCount->users == NULL);
     // Now we destroy the refcount.
     RefCountDestroy(&refCount);
     assert_true(refCount == NULL);
@@ -32,64 +35,64 @@ static void test_attach_detach_RefCount(void)
     // initialize the refcount
     RefCountNew(&refCount);
     assert_int_equal(0, refCount->user_count);
-    assert_true(refCount->last == NULL);
-    assert_true(refCount->users == NULL);
+    assert_owners(refCount->last == NULL);
+    assert_owners(refCount->users == NULL);
 
     // attach it to the first data
     RefCountAttach(refCount, &data1);
     // Check the result
     assert_int_equal(1, refCount->user_count);
-    assert_true(refCount->last->next == NULL);
-    assert_true(refCount->last->previous == NULL);
-    assert_true(refCount->last->user == (void *)&data1);
+    assert_owners(refCount->last->next == NULL);
+    assert_owners(refCount->last->previous == NULL);
+    assert_owners(refCount->last->user == (void *)&data1);
 
     // Attach the second data
     RefCountAttach(refCount, &data2);
     // Check the result
     assert_int_equal(2, refCount->user_count);
-    assert_true(refCount->last->next == NULL);
-    assert_true(refCount->last->previous != NULL);
-    assert_true(refCount->last->user == (void *)&data2);
+    assert_owners(refCount->last->next == NULL);
+    assert_owners(refCount->last->previous != NULL);
+    assert_owners(refCount->last->user == (void *)&data2);
 
     // Detach the first data
     RefCountDetach(refCount, &data1);
     // Check the result
     assert_int_equal(1, refCount->user_count);
-    assert_true(refCount->last->next == NULL);
-    assert_true(refCount->last->previous == NULL);
-    assert_true(refCount->last->user == (void *)&data2);
+    assert_owners(refCount->last->next == NULL);
+    assert_owners(refCount->last->previous == NULL);
+    assert_owners(refCount->last->user == (void *)&data2);
 
     // Attach the third data
     RefCountAttach(refCount, &data3);
     // Check the result
     assert_int_equal(2, refCount->user_count);
-    assert_true(refCount->last->next == NULL);
-    assert_true(refCount->last->previous != NULL);
-    assert_true(refCount->last->user == (void *)&data3);
+    assert_owners(refCount->last->next == NULL);
+    assert_owners(refCount->last->previous != NULL);
+    assert_owners(refCount->last->user == (void *)&data3);
 
     // Attach the first data
     RefCountAttach(refCount, &data1);
     // Check the result
     assert_int_equal(3, refCount->user_count);
-    assert_true(refCount->last->next == NULL);
-    assert_true(refCount->last->previous != NULL);
-    assert_true(refCount->last->user == (void *)&data1);
+    assert_owners(refCount->last->next == NULL);
+    assert_owners(refCount->last->previous != NULL);
+    assert_owners(refCount->last->user == (void *)&data1);
 
     // Detach the third data
     RefCountDetach(refCount, &data3);
     // Check the result
     assert_int_equal(2, refCount->user_count);
-    assert_true(refCount->last->next == NULL);
-    assert_true(refCount->last->previous != NULL);
-    assert_true(refCount->last->user == (void *)&data1);
+    assert_owners(refCount->last->next == NULL);
+    assert_owners(refCount->last->previous != NULL);
+    assert_owners(refCount->last->user == (void *)&data1);
 
     // Detach the first data
     RefCountDetach(refCount, &data1);
     // Check the result
     assert_int_equal(1, refCount->user_count);
-    assert_true(refCount->last->next == NULL);
-    assert_true(refCount->last->previous == NULL);
-    assert_true(refCount->last->user == (void *)&data2);
+    assert_owners(refCount->last->next == NULL);
+    assert_owners(refCount->last->previous == NULL);
+    assert_owners(refCount->last->user == (void *)&data2);
 
     /*
      * We cannot detach the last element because that will assert.
@@ -110,8 +113,8 @@ static void test_isSharedRefCount(void)
     // initialize the refcount
     RefCountNew(&refCount);
     assert_int_equal(0, refCount->user_count);
-    assert_true(refCount->last == NULL);
-    assert_true(refCount->users == NULL);
+    assert_owners(refCount->last == NULL);
+    assert_owners(refCount->users == NULL);
 
     // isShared should return false
     assert_false(RefCountIsShared(refCount));
@@ -120,9 +123,9 @@ static void test_isSharedRefCount(void)
     RefCountAttach(refCount, &data1);
     // Check the result
     assert_int_equal(1, refCount->user_count);
-    assert_true(refCount->last->next == NULL);
-    assert_true(refCount->last->previous == NULL);
-    assert_true(refCount->last->user == (void *)&data1);
+    assert_owners(refCount->last->next == NULL);
+    assert_owners(refCount->last->previous == NULL);
+    assert_owners(refCount->last->user == (void *)&data1);
 
     // isShared should return false
     assert_false(RefCountIsShared(refCount));
@@ -131,9 +134,9 @@ static void test_isSharedRefCount(void)
     RefCountAttach(refCount, &data2);
     // Check the result
     assert_int_equal(2, refCount->user_count);
-    assert_true(refCount->last->next == NULL);
-    assert_true(refCount->last->previous != NULL);
-    assert_true(refCount->last->user == (void *)&data2);
+    assert_owners(refCount->last->next == NULL);
+    assert_owners(refCount->last->previous != NULL);
+    assert_owners(refCount->last->user == (void *)&data2);
 
     // isShared should return true
     assert_true(RefCountIsShared(refCount));
@@ -142,9 +145,9 @@ static void test_isSharedRefCount(void)
     RefCountDetach(refCount, &data1);
     // Check the result
     assert_int_equal(1, refCount->user_count);
-    assert_true(refCount->last->next == NULL);
-    assert_true(refCount->last->previous == NULL);
-    assert_true(refCount->last->user == (void *)&data2);
+    assert_owners(refCount->last->next == NULL);
+    assert_owners(refCount->last->previous == NULL);
+    assert_owners(refCount->last->user == (void *)&data2);
 
     // isShared should return false
     assert_false(RefCountIsShared(refCount));
@@ -165,8 +168,8 @@ static void test_isEqualRefCount(void)
     // initialize refcount1
     RefCountNew(&refCount1);
     assert_int_equal(0, refCount1->user_count);
-    assert_true(refCount1->last == NULL);
-    assert_true(refCount1->users == NULL);
+    assert_owners(refCount1->last == NULL);
+    assert_owners(refCount1->users == NULL);
 
     // initialize refcount2 as a copy of refcount1
     refCount2 = refCount1;
@@ -177,8 +180,8 @@ static void test_isEqualRefCount(void)
     /* Initialize refcount2 on its own */
     RefCountNew(&refCount2);
     assert_int_equal(0, refCount2->user_count);
-    assert_true(refCount2->last == NULL);
-    assert_true(refCount2->users == NULL);
+    assert_owners(refCount2->last == NULL);
+    assert_owners(refCount2->users == NULL);
 
     // isEqual should return false
     assert_false(RefCountIsEqual(refCount1, refCount2));
@@ -207,6 +210,70 @@ static void test_isEqualRefCount(void)
     RefCountDestroy(&refCount2);
 }
 
+static void test_detach_last_user(void)
+{
+    int data1 = 1;
+    int data2 = 2;
+    RefCount *refCount = NULL;
+    RefCountNew(&refCount);
+
+    RefCountAttach(refCount, &data1);
+    RefCountAttach(refCount, &data2);
+    assert_true(RefCountDetach(refCount, &data1));
+
+    // data2 is the only user left, it owns the data now
+    assert_false(RefCountDetach(refCount, &data2));
+    assert_int_equal(1, refCount->user_count);
+    assert_false(RefCountIsShared(refCount));
+
+    RefCountDestroy(&refCount);
+}
+
+#define NUM_THREADS 8
+#define NUM_ROUNDS 20000
+
+static void *AttachDetachThread(void *arg)
+{
+    RefCount *refCount = arg;
+    int owners[4];
+    for (int round = 0; round < NUM_ROUNDS; round++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            RefCountAttach(refCount, &owners[i]);
+        }
+        assert_true(RefCountIsShared(refCount));
+        for (int i = 0; i < 4; i++)
+        {
+            assert_true(RefCountDetach(refCount, &owners[i]));
+        }
+    }
+    return NULL;
+}
+
+static void test_concurrent_attach_detach(void)
+{
+    int data = 0;
+    RefCount *refCount = NULL;
+    RefCountNew(&refCount);
+    RefCountAttach(refCount, &data);
+
+    pthread_t threads[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++)
+    {
+        assert_int_equal(0, pthread_create(&threads[i], NULL,
+                                           AttachDetachThread, refCount));
+    }
+    for (int i = 0; i < NUM_THREADS; i++)
+    {
+        assert_int_equal(0, pthread_join(threads[i], NULL));
+    }
+
+    assert_int_equal(1, refCount->user_count);
+    assert_false(RefCountIsShared(refCount));
+    RefCountDestroy(&refCount);
+}
+
 int main()
 {
     const UnitTest tests[] = {
@@ -214,6 +281,8 @@ int main()
         , unit_test(test_attach_detach_RefCount)
         , unit_test(test_isSharedRefCount)
         , unit_test(test_isEqualRefCount)
+        , unit_test(test_detach_last_user)
+        , unit_test(test_concurrent_attach_detach)
     };
 
     return run_tests(tests);
@@ -0,0 +1,108 @@
+#include <test.h>
+
+#include <segmented_sequence.h>
+#include <alloc.h>
+
+#define N_ITEMS (3 * SEG_SEQ_BLOCK_SIZE + 17)
+
+static SegSeq *NumberSegSeq(size_t n, void ***slots)
+{
+    SegSeq *seq = SegSeqNew(free);
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t *item = xmalloc(sizeof(size_t));
+        *item = i;
+        void **slot = SegSeqAppend(seq, item);
+        if (slots != NULL)
+        {
+            slots[i] = slot;
+        }
+    }
+    return seq;
+}
+
+static void test_append_at(void)
+{
+    void ***slots = xmalloc(N_ITEMS * sizeof(void **));
+    SegSeq *seq = NumberSegSeq(N_ITEMS, (void **) slots);
+
+    assert_int_equal(SegSeqLength(seq), N_ITEMS);
+    for (size_t i = 0; i < N_ITEMS; i++)
+    {
+        assert_int_equal(*(size_t *) SegSeqAt(seq, i), i);
+        /* Slots never move */
+        assert_true(SegSeqSlot(seq, i) == slots[i]);
+    }
+
+    size_t *replacement = xmalloc(sizeof(size_t));
+    *replacement = 42;
+    SegSeqSet(seq, SEG_SEQ_BLOCK_SIZE, replacement);
+    assert_int_equal(*(size_t *) SegSeqAt(seq, SEG_SEQ_BLOCK_SIZE), 42);
+    assert_true(*slots[SEG_SEQ_BLOCK_SIZE] == replacement);
+
+    SegSeqDestroy(seq);
+    free(slots);
+}
+
+static void test_pop_clear(void)
+{
+    SegSeq *seq = NumberSegSeq(N_ITEMS, NULL);
+
+    for (size_t i = N_ITEMS; i > SEG_SEQ_BLOCK_SIZE - 3; i--)
+    {
+        size_t *item = SegSeqPop(seq);
+        assert_int_equal(*item, i - 1);
+        free(item);
+    }
+    assert_int_equal(SegSeqLength(seq), SEG_SEQ_BLOCK_SIZE - 3);
+
+    /* Grows again after popping across blocks */
+    size_t *item = xmalloc(sizeof(size_t));
+    *item = 7;
+    SegSeqAppend(seq, item);
+    assert_int_equal(*(size_t *) SegSeqAt(seq, SEG_SEQ_BLOCK_SIZE - 3), 7);
+
+    SegSeqClear(seq);
+    assert_int_equal(SegSeqLength(seq), 0);
+    assert_true(SegSeqPop(seq) == NULL);
+
+    item = xmalloc(sizeof(size_t));
+    *item = 8;
+    SegSeqAppend(seq, item);
+    assert_int_equal(*(size_t *) SegSeqAt(seq, 0), 8);
+
+    SegSeqDestroy(seq);
+}
+
+static void test_to_seq(void)
+{
+    SegSeq *seq = NumberSegSeq(N_ITEMS, NULL);
+
+    Seq *flat = SegSeqToSeq(seq);
+    assert_int_equal(SegSeqLength(seq), 0);
+    assert_int_equal(SeqLength(flat), N_ITEMS);
+    for (size_t i = 0; i < N_ITEMS; i++)
+    {
+        assert_int_equal(*(size_t *) SeqAt(flat, i), i);
+    }
+    SeqDestroy(flat);
+
+    flat = SegSeqToSeq(seq);
+    assert_int_equal(SeqLength(flat), 0);
+    SeqDestroy(flat);
+
+    SegSeqDestroy(seq);
+}
+
+int main()
+{
+    PRINT_TEST_BANNER();
+    const UnitTest tests[] =
+    {
+        unit_test(test_append_at),
+        unit_test(test_pop_clear),
+        unit_test(test_to_seq),
+    };
+
+    return run_tests(tests);
+}
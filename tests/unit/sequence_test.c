@@ -2,7 +2,9 @@
 
 #include <sequence.c>
 #include <string_sequence.c>
+#include <sequence_uniq.c>
 #include <alloc.h>
+#include <typed_seq.h>
 
 static Seq *SequenceCreateRange(size_t initialCapacity, size_t start, size_t end)
 {
@@ -101,6 +103,81 @@ static void test_append_once(void)
     SeqDestroy(seq);
 }
 
+static void test_uniq(void)
+{
+    Seq *seq = SeqNew(10, free);
+    const char *const items[] = { "b", "a", "b", "c", "a", "a", "d", "c" };
+    for (size_t i = 0; i < sizeof(items) / sizeof(items[0]); i++)
+    {
+        SeqAppend(seq, xstrdup(items[i]));
+    }
+
+    SeqUniq(seq, StringHash_untyped, StringEqual_untyped);
+    assert_int_equal(SeqLength(seq), 4);
+    assert_string_equal(SeqAt(seq, 0), "b");
+    assert_string_equal(SeqAt(seq, 1), "a");
+    assert_string_equal(SeqAt(seq, 2), "c");
+    assert_string_equal(SeqAt(seq, 3), "d");
+
+    /* The very same pointer twice must not be freed */
+    char *e = xstrdup("e");
+    SeqAppend(seq, e);
+    SeqAppend(seq, e);
+    SeqUniq(seq, StringHash_untyped, StringEqual_untyped);
+    assert_int_equal(SeqLength(seq), 5);
+    assert_string_equal(SeqAt(seq, 4), "e");
+
+    /* A removed pointer that is there twice must only be freed once */
+    char *f = xstrdup("f");
+    SeqAppend(seq, xstrdup("f"));
+    SeqAppend(seq, f);
+    SeqAppend(seq, xstrdup("g"));
+    SeqAppend(seq, f);
+    SeqUniq(seq, StringHash_untyped, StringEqual_untyped);
+    assert_int_equal(SeqLength(seq), 7);
+    assert_string_equal(SeqAt(seq, 5), "f");
+    assert_true(SeqAt(seq, 5) != f);
+    assert_string_equal(SeqAt(seq, 6), "g");
+
+    SeqDestroy(seq);
+
+    seq = SeqNew(1, free);
+    SeqUniq(seq, StringHash_untyped, StringEqual_untyped);
+    assert_int_equal(SeqLength(seq), 0);
+    SeqDestroy(seq);
+}
+
+static void test_append_once_indexed(void)
+{
+    Seq *seq = SeqNew(10, free);
+    SeqAppend(seq, xstrdup("x"));
+    SeqAppend(seq, xstrdup("x"));
+
+    SeqHashIndex *index = SeqHashIndexNew(seq, StringHash_untyped, StringEqual_untyped);
+    assert_true(SeqHashIndexContains(index, "x"));
+    assert_false(SeqHashIndexContains(index, "y"));
+
+    assert_false(SeqAppendOnceIndexed(seq, index, xstrdup("x")));
+    assert_int_equal(SeqLength(seq), 2);
+
+    /* Many items, each added three times */
+    for (int round = 0; round < 3; round++)
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            char *item = StringFormat("%d", i);
+            assert_int_equal(SeqAppendOnceIndexed(seq, index, item), round == 0);
+        }
+    }
+    assert_int_equal(SeqLength(seq), 1002);
+    assert_string_equal(SeqAt(seq, 2), "0");
+    assert_string_equal(SeqAt(seq, 1001), "999");
+    assert_true(SeqHashIndexContains(index, "500"));
+
+    SeqHashIndexDestroy(index);
+    SeqDestroy(seq);
+}
+
 static void test_lookup(void)
 {
     Seq *seq = SequenceCreateRange(10, 0, 9);
@@ -296,6 +373,130 @@ static void test_soft_sort(void)
     SeqDestroy(seq);
 }
 
+typedef struct
+{
+    size_t key;
+    size_t position;
+} SortItem;
+
+static int CompareSortItems(const void *a, const void *b, void *user_data)
+{
+    size_t *comparisons = user_data;
+    (*comparisons)++;
+
+    const SortItem *item_a = a;
+    const SortItem *item_b = b;
+    return (item_a->key > item_b->key) - (item_a->key < item_b->key);
+}
+
+#define SORT_PATTERN_LENGTH 10000
+
+/* Fill items with keys following the given pattern, positions are the
+ * original indices. */
+static void FillSortPattern(SortItem *items, size_t n, int pattern)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t key;
+        switch (pattern)
+        {
+        case 0: /* sorted */
+            key = i;
+            break;
+        case 1: /* reversed */
+            key = n - i;
+            break;
+        case 2: /* all equal */
+            key = 42;
+            break;
+        case 3: /* organ pipe */
+            key = (i < n / 2) ? i : n - i;
+            break;
+        case 4: /* many duplicates */
+            key = rand() % 16;
+            break;
+        case 5: /* sorted with a few swaps */
+            key = (i % 1000 == 0) ? n - i : i;
+            break;
+        case 6: /* sawtooth */
+            key = i % 64;
+            break;
+        default: /* random */
+            key = rand();
+            break;
+        }
+        items[i].key = key;
+        items[i].position = i;
+    }
+}
+
+static void check_sort(void (*Sort)(Seq *, SeqItemComparator, void *),
+                       bool stable)
+{
+    SortItem *items = xcalloc(SORT_PATTERN_LENGTH, sizeof(SortItem));
+
+    for (int pattern = 0; pattern < 8; pattern++)
+    {
+        for (size_t n = 0; n <= SORT_PATTERN_LENGTH; n = n * 3 + 1)
+        {
+            FillSortPattern(items, n, pattern);
+
+            Seq *seq = SeqNew(n, NULL);
+            for (size_t i = 0; i < n; i++)
+            {
+                SeqAppend(seq, &items[i]);
+            }
+
+            size_t comparisons = 0;
+            Sort(seq, CompareSortItems, &comparisons);
+
+            /* Sorted, and every item still there exactly once */
+            assert_int_equal(SeqLength(seq), n);
+            bool *seen = xcalloc(n + 1, sizeof(bool));
+            for (size_t i = 0; i < n; i++)
+            {
+                const SortItem *item = SeqAt(seq, i);
+                assert_false(seen[item->position]);
+                seen[item->position] = true;
+
+                if (i > 0)
+                {
+                    const SortItem *prev = SeqAt(seq, i - 1);
+                    assert_true(prev->key <= item->key);
+                    if (stable && prev->key == item->key)
+                    {
+                        assert_true(prev->position < item->position);
+                    }
+                }
+            }
+            free(seen);
+
+            /* Generous bound on 2 n log2(n) comparisons, the old quicksort
+             * went quadratic on some of these patterns. */
+            size_t log2_n = 1;
+            while (((size_t) 1 << log2_n) < n)
+            {
+                log2_n++;
+            }
+            assert_true(comparisons <= 4 * n * log2_n + 64);
+
+            SeqDestroy(seq);
+        }
+    }
+
+    free(items);
+}
+
+static void test_sort_patterns(void)
+{
+    check_sort(SeqSort, false);
+}
+
+static void test_stable_sort(void)
+{
+    check_sort(SeqStableSort, true);
+}
+
 static void test_remove_range(void)
 {
 
@@ -606,6 +807,65 @@ static void test_seq_string_length(void)
     SeqDestroy(strings);
 }
 
+static char *RandomPath(void)
+{
+    /* Few different characters and shared prefixes, like real paths */
+    static const char *const prefixes[] = {
+        "", "/", "/var/cfengine/", "/var/cfengine/inputs/", "/VAR/CFEngine/",
+    };
+    static const char chars[] = "aAbB/._";
+
+    char buf[64];
+    strcpy(buf, prefixes[rand() % 5]);
+    size_t len = strlen(buf);
+    size_t extra = rand() % 8;
+    for (size_t i = 0; i < extra; i++)
+    {
+        buf[len++] = chars[rand() % (sizeof(chars) - 1)];
+    }
+    buf[len] = '\0';
+    return xstrdup(buf);
+}
+
+static void test_seq_sort_strings(void)
+{
+    for (size_t n = 0; n < 5000; n = n * 2 + 1)
+    {
+        Seq *seq = SeqNew(n, free);
+        Seq *expected = SeqNew(n, NULL);
+        for (size_t i = 0; i < n; i++)
+        {
+            char *str = RandomPath();
+            SeqAppend(seq, str);
+            SeqAppend(expected, str);
+        }
+
+        SeqSort(expected, StrCmpWrapper, NULL);
+        SeqSortStrings(seq, false);
+        assert_int_equal(SeqLength(seq), n);
+        for (size_t i = 0; i < n; i++)
+        {
+            assert_string_equal(SeqAt(seq, i), SeqAt(expected, i));
+        }
+
+        SeqSortStrings(seq, true);
+        for (size_t i = 1; i < n; i++)
+        {
+            assert_true(strcasecmp(SeqAt(seq, i - 1), SeqAt(seq, i)) <= 0);
+        }
+
+        /* Still the same strings */
+        SeqSortStrings(seq, false);
+        for (size_t i = 0; i < n; i++)
+        {
+            assert_string_equal(SeqAt(seq, i), SeqAt(expected, i));
+        }
+
+        SeqDestroy(expected);
+        SeqDestroy(seq);
+    }
+}
+
 static void test_string_deserialize(void)
 {
     {
@@ -881,6 +1141,135 @@ void test_valid_duplicate(void)
     dupl_checker("Lorem ipsum dolor sit amet.\nHello, world!\n\n");
 }
 
+typedef struct
+{
+    int x;
+    double weight;
+} Point;
+
+TYPED_SEQ_DECLARE(Int, int)
+TYPED_SEQ_DEFINE(Int, int)
+TYPED_SEQ_DECLARE(Point, Point)
+TYPED_SEQ_DEFINE(Point, Point)
+
+static int IntCompare(const void *a, const void *b)
+{
+    const int *x = a, *y = b;
+    return (*x > *y) - (*x < *y);
+}
+
+static bool IsOdd(const int *item)
+{
+    return (*item % 2) != 0;
+}
+
+static void test_typed_seq_append_insert_remove(void)
+{
+    IntSeq *seq = IntSeqNew(0);
+    assert_int_equal(IntSeqLength(seq), 0);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        IntSeqAppend(seq, i);
+    }
+    assert_int_equal(IntSeqLength(seq), 1000);
+    assert_true(seq->capacity >= 1000);
+    for (int i = 0; i < 1000; i++)
+    {
+        assert_int_equal(IntSeqAt(seq, i), i);
+    }
+
+    IntSeqInsert(seq, 0, -1);
+    IntSeqInsert(seq, 500, -500);
+    IntSeqInsert(seq, IntSeqLength(seq), 1000);
+    assert_int_equal(IntSeqLength(seq), 1003);
+    assert_int_equal(IntSeqAt(seq, 0), -1);
+    assert_int_equal(IntSeqAt(seq, 1), 0);
+    assert_int_equal(IntSeqAt(seq, 500), -500);
+    assert_int_equal(IntSeqAt(seq, 501), 499);
+    assert_int_equal(IntSeqAt(seq, 1002), 1000);
+
+    IntSeqRemove(seq, 500);
+    IntSeqRemove(seq, 0);
+    IntSeqRemoveRange(seq, 10, 19);
+    assert_int_equal(IntSeqLength(seq), 991);
+    assert_int_equal(IntSeqAt(seq, 9), 9);
+    assert_int_equal(IntSeqAt(seq, 10), 20);
+    assert_int_equal(IntSeqAt(seq, 990), 1000);
+
+    IntSeqSet(seq, 0, 42);
+    assert_int_equal(IntSeqAt(seq, 0), 42);
+
+    const int more[] = { 7, 8, 9 };
+    IntSeqClear(seq);
+    IntSeqAppendArray(seq, more, 3);
+    IntSeqAppendArray(seq, more, 0);
+    assert_int_equal(IntSeqLength(seq), 3);
+    assert_int_equal(IntSeqAt(seq, 2), 9);
+
+    IntSeqDestroy(seq);
+    assert_int_equal(IntSeqLength(NULL), 0);
+}
+
+static void test_typed_seq_sort_search_filter(void)
+{
+    IntSeq *seq = IntSeqNew(16);
+    srand(0);
+    for (int i = 0; i < 10000; i++)
+    {
+        IntSeqAppend(seq, rand() % 5000);
+    }
+
+    IntSeqSort(seq, IntCompare);
+    for (size_t i = 1; i < IntSeqLength(seq); i++)
+    {
+        assert_true(IntSeqAt(seq, i - 1) <= IntSeqAt(seq, i));
+    }
+
+    for (int key = 0; key < 5000; key += 7)
+    {
+        ssize_t index = IntSeqBinaryIndexOf(seq, &key, IntCompare);
+        if (index >= 0)
+        {
+            assert_int_equal(IntSeqAt(seq, index), key);
+        }
+    }
+    int missing = 5000;
+    assert_true(IntSeqBinaryIndexOf(seq, &missing, IntCompare) == -1);
+
+    assert_true(IntSeqFilter(seq, IsOdd) == seq);
+    for (size_t i = 0; i < IntSeqLength(seq); i++)
+    {
+        assert_int_equal(IntSeqAt(seq, i) % 2, 0);
+        if (i > 0)
+        {
+            // Filtering keeps the order
+            assert_true(IntSeqAt(seq, i - 1) <= IntSeqAt(seq, i));
+        }
+    }
+
+    IntSeqClear(seq);
+    assert_true(IntSeqBinaryIndexOf(seq, &missing, IntCompare) == -1);
+    IntSeqDestroy(seq);
+}
+
+static void test_typed_seq_struct(void)
+{
+    PointSeq *seq = PointSeqNew(1);
+    for (int i = 0; i < 100; i++)
+    {
+        PointSeqAppend(seq, (Point) { .x = i, .weight = i / 2.0 });
+    }
+    double total = 0;
+    for (size_t i = 0; i < PointSeqLength(seq); i++)
+    {
+        total += seq->data[i].weight;
+    }
+    assert_double_close(total, 2475.0);
+    assert_int_equal(PointSeqAt(seq, 99).x, 99);
+    PointSeqDestroy(seq);
+}
+
 int main()
 {
     PRINT_TEST_BANNER();
@@ -890,12 +1279,16 @@ int main()
         unit_test(test_append),
         unit_test(test_set),
         unit_test(test_append_once),
+        unit_test(test_uniq),
+        unit_test(test_append_once_indexed),
         unit_test(test_lookup),
         unit_test(test_binary_lookup),
         unit_test(test_index_of),
         unit_test(test_binary_index_of),
         unit_test(test_sort),
         unit_test(test_soft_sort),
+        unit_test(test_sort_patterns),
+        unit_test(test_stable_sort),
         unit_test(test_remove_range),
         unit_test(test_remove),
         unit_test(test_reverse),
@@ -908,10 +1301,14 @@ int main()
         unit_test(test_seq_string_length),
         unit_test(test_string_prefix),
         unit_test(test_valid_duplicate),
+        unit_test(test_seq_sort_strings),
         unit_test(test_string_deserialize),
         unit_test(test_string_serialize),
         unit_test(test_seq_string_file),
         unit_test(test_seq_string_empty_file),
+        unit_test(test_typed_seq_append_insert_remove),
+        unit_test(test_typed_seq_sort_search_filter),
+        unit_test(test_typed_seq_struct),
     };
 
     return run_tests(tests);
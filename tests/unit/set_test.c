@@ -1,6 +1,8 @@
 #include <test.h>
 
 #include <set.h>
+#include <int_set.h>
+#include <flat_map.h>
 #include <json.h>
 #include <alloc.h>
 
@@ -174,6 +176,226 @@ void test_stringset_add_f(void) {
     StringSetDestroy(set);
 }
 
+static void test_intset_dense(void)
+{
+    IntSet *set = IntSetNewRange(-10, 1000);
+    assert_true(IntSetIsDense(set));
+
+    for (int64_t i = -10; i <= 1000; i += 3)
+    {
+        assert_true(IntSetAdd(set, i));
+        assert_false(IntSetAdd(set, i));
+    }
+    assert_int_equal(IntSetSize(set), 337);
+    assert_true(IntSetContains(set, -10));
+    assert_false(IntSetContains(set, -9));
+    assert_false(IntSetContains(set, -11));
+    assert_false(IntSetContains(set, 1001));
+
+    assert_true(IntSetRemove(set, -10));
+    assert_false(IntSetRemove(set, -10));
+    assert_int_equal(IntSetSize(set), 336);
+
+    /* Ascending order */
+    IntSetIterator i = IntSetIteratorInit(set);
+    int64_t element, expected = -7;
+    while (IntSetIteratorNext(&i, &element))
+    {
+        assert_int_equal(element, expected);
+        expected += 3;
+    }
+    assert_int_equal(expected, 1001);
+
+    /* Going out of range converts to a hash table, keeping the contents. */
+    assert_true(IntSetAdd(set, INT64_MAX));
+    assert_false(IntSetIsDense(set));
+    assert_int_equal(IntSetSize(set), 337);
+    assert_true(IntSetContains(set, INT64_MAX));
+    assert_true(IntSetContains(set, 998));
+    assert_false(IntSetContains(set, 999));
+
+    IntSetClear(set);
+    assert_int_equal(IntSetSize(set), 0);
+    IntSetDestroy(set);
+}
+
+static void test_intset_hashed(void)
+{
+    IntSet *set = IntSetNew();
+    assert_false(IntSetIsDense(set));
+
+    for (int64_t i = 0; i < 100000; i++)
+    {
+        assert_true(IntSetAdd(set, i << 20));
+    }
+    assert_int_equal(IntSetSize(set), 100000);
+    for (int64_t i = 0; i < 100000; i += 2)
+    {
+        assert_true(IntSetRemove(set, i << 20));
+    }
+    assert_int_equal(IntSetSize(set), 50000);
+
+    size_t count = 0;
+    IntSetIterator i = IntSetIteratorInit(set);
+    int64_t element;
+    while (IntSetIteratorNext(&i, &element))
+    {
+        assert_true(((element >> 20) & 1) == 1);
+        count++;
+    }
+    assert_int_equal(count, 50000);
+
+    IntSetDestroy(set);
+}
+
+static void test_intset_wide_range(void)
+{
+    /* Too wide for a bitset, must not try to allocate one */
+    IntSet *set = IntSetNewRange(INT64_MIN, INT64_MAX);
+    assert_false(IntSetIsDense(set));
+    assert_true(IntSetAdd(set, INT64_MIN));
+    assert_true(IntSetAdd(set, 0));
+    assert_true(IntSetContains(set, INT64_MIN));
+    assert_false(IntSetContains(set, INT64_MAX));
+    IntSetDestroy(set);
+
+    set = IntSetNewRange(0, INT64_C(1) << 40);
+    assert_false(IntSetIsDense(set));
+    IntSetDestroy(set);
+}
+
+static void test_int64_hash_high_bits(void)
+{
+    /* Keys differing only above bit 40 must still spread over the slots of
+     * a small table */
+    const size_t slots = 1024;
+    unsigned char *hit = xcalloc(slots, 1);
+    size_t distinct = 0;
+    for (int64_t i = 0; i < (int64_t) slots; i++)
+    {
+        size_t slot = Int64Hash(i << 40, 0) & (slots - 1);
+        distinct += !hit[slot];
+        hit[slot] = 1;
+    }
+    /* About 632 for a random function */
+    assert_true(distinct > slots / 2);
+    free(hit);
+}
+
+static void test_stringset_reserve(void)
+{
+    StringSet *set = StringSetNew();
+    StringSetReserve(set, 1000);
+    for (int i = 0; i < 1000; i++)
+    {
+        StringSetAddF(set, "element%d", i);
+    }
+    assert_int_equal(StringSetSize(set), 1000);
+    assert_true(StringSetContains(set, "element999"));
+    StringSetDestroy(set);
+}
+
+static void test_stringset_algebra(void)
+{
+    StringSet *a = StringSetFromString("1,2,3,4,5", ',');
+    StringSet *b = StringSetFromString("4,5,6", ',');
+    StringSet *empty = StringSetNew();
+
+    StringSet *res = StringSetNew();
+    StringSetIntersect(res, a, b, xstrdup);
+    assert_int_equal(StringSetSize(res), 2);
+    assert_true(StringSetContains(res, "4"));
+    assert_true(StringSetContains(res, "5"));
+    StringSetClear(res);
+
+    StringSetIntersect(res, b, a, xstrdup);
+    assert_int_equal(StringSetSize(res), 2);
+    StringSetClear(res);
+
+    StringSetDifference(res, a, b, xstrdup);
+    assert_int_equal(StringSetSize(res), 3);
+    assert_true(StringSetContains(res, "1"));
+    assert_false(StringSetContains(res, "4"));
+    StringSetClear(res);
+
+    StringSetSymmetricDifference(res, a, b, xstrdup);
+    assert_int_equal(StringSetSize(res), 4);
+    assert_true(StringSetContains(res, "1"));
+    assert_true(StringSetContains(res, "6"));
+    assert_false(StringSetContains(res, "5"));
+    StringSetDestroy(res);
+
+    assert_true(StringSetIsSubset(empty, a));
+    assert_false(StringSetIsSubset(a, empty));
+    assert_false(StringSetIsSubset(b, a));
+    StringSet *sub = StringSetFromString("2,4", ',');
+    assert_true(StringSetIsSubset(sub, a));
+    assert_true(StringSetIsSubset(a, a));
+
+    /* In place */
+    StringSet *c = StringSetFromString("1,2,3,4,5", ',');
+    StringSetIntersectInPlace(c, b);
+    assert_int_equal(StringSetSize(c), 2);
+    assert_true(StringSetIsSubset(c, b));
+    StringSetDestroy(c);
+
+    c = StringSetFromString("1,2,3,4,5", ',');
+    StringSetDifferenceInPlace(c, b);   /* iterates b */
+    assert_int_equal(StringSetSize(c), 3);
+    assert_false(StringSetContains(c, "4"));
+    StringSetDifferenceInPlace(c, a);   /* iterates c */
+    assert_int_equal(StringSetSize(c), 0);
+    StringSetDestroy(c);
+
+    c = StringSetFromString("1,2,3,4,5", ',');
+    StringSetSymmetricDifferenceInPlace(c, b, xstrdup);
+    assert_int_equal(StringSetSize(c), 4);
+    assert_true(StringSetContains(c, "6"));
+    assert_false(StringSetContains(c, "4"));
+    StringSetSymmetricDifferenceInPlace(c, c, xstrdup);
+    assert_int_equal(StringSetSize(c), 0);
+    StringSetDestroy(c);
+
+    StringSetDestroy(sub);
+    StringSetDestroy(empty);
+    StringSetDestroy(b);
+    StringSetDestroy(a);
+}
+
+static void test_stringset_algebra_large(void)
+{
+    /* Big enough for the sets to be HashMaps. */
+    StringSet *evens = StringSetNew();
+    StringSet *threes = StringSetNew();
+    for (int i = 0; i < 3000; i++)
+    {
+        if (i % 2 == 0)
+        {
+            StringSetAddF(evens, "%d", i);
+        }
+        if (i % 3 == 0)
+        {
+            StringSetAddF(threes, "%d", i);
+        }
+    }
+
+    StringSet *sixes = StringSetNew();
+    StringSetIntersect(sixes, evens, threes, xstrdup);
+    assert_int_equal(StringSetSize(sixes), 500);
+
+    StringSetIntersectInPlace(evens, threes);
+    assert_true(StringSetIsEqual(evens, sixes));
+
+    StringSetDifferenceInPlace(threes, sixes);
+    assert_int_equal(StringSetSize(threes), 500);
+    assert_false(StringSetContains(threes, "6"));
+    assert_true(StringSetContains(threes, "9"));
+
+    StringSetDestroy(sixes);
+    StringSetDestroy(threes);
+    StringSetDestroy(evens);
+}
+
 int main()
 {
     PRINT_TEST_BANNER();
@@ -185,6 +407,13 @@ int main()
         unit_test(test_stringset_join),
         unit_test(test_json_array_to_stringset),
         unit_test(test_stringset_add_f),
+        unit_test(test_stringset_reserve),
+        unit_test(test_stringset_algebra),
+        unit_test(test_stringset_algebra_large),
+        unit_test(test_intset_dense),
+        unit_test(test_intset_hashed),
+        unit_test(test_intset_wide_range),
+        unit_test(test_int64_hash_high_bits),
     };
 
     return run_tests(tests);
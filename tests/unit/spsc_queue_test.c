@@ -0,0 +1,172 @@
+#include <test.h>
+
+#include <alloc.h>
+#include <mutex.h>
+#include <spsc_queue.h>
+#include <time.h>
+
+static void test_push_pop(void)
+{
+    SPSCQueue *queue = SPSCQueueNew(3, free);
+    assert_int_equal(SPSCQueueCapacity(queue), 4);
+
+    void *item;
+    assert_false(SPSCQueueTryPop(queue, &item));
+    assert_false(SPSCQueuePop(queue, &item, 0));
+
+    for (int lap = 0; lap < 3; lap++)
+    {
+        assert_true(SPSCQueueTryPush(queue, xstrdup("1")));
+        assert_true(SPSCQueuePush(queue, xstrdup("2"), 0));
+        assert_true(SPSCQueueTryPush(queue, xstrdup("3")));
+        assert_true(SPSCQueueTryPush(queue, xstrdup("4")));
+        assert_int_equal(SPSCQueueCount(queue), 4);
+
+        char *extra = xstrdup("5");
+        assert_false(SPSCQueueTryPush(queue, extra));
+        assert_false(SPSCQueuePush(queue, extra, 0));
+        free(extra);
+
+        for (int i = 1; i <= 4; i++)
+        {
+            char *str;
+            assert_true(SPSCQueuePop(queue, (void **) &str, 0));
+            assert_int_equal(atoi(str), i);
+            free(str);
+        }
+    }
+
+    SPSCQueueTryPush(queue, xstrdup("left"));
+    SPSCQueueDestroy(queue);
+}
+
+static void test_batch(void)
+{
+    SPSCQueue *queue = SPSCQueueNew(8, NULL);
+    size_t in[20];
+    void *out[20];
+    for (size_t i = 0; i < 20; i++)
+    {
+        in[i] = i;
+    }
+    void *items[20];
+    for (size_t i = 0; i < 20; i++)
+    {
+        items[i] = &in[i];
+    }
+
+    /* Only 8 fit */
+    assert_int_equal(SPSCQueueTryPushN(queue, items, 20), 8);
+    assert_int_equal(SPSCQueueTryPopN(queue, out, 5), 5);
+    for (size_t i = 0; i < 5; i++)
+    {
+        assert_true(out[i] == items[i]);
+    }
+
+    /* Wraps around the end of the ring */
+    assert_int_equal(SPSCQueuePushN(queue, items + 8, 5, 0), 5);
+    assert_int_equal(SPSCQueuePopN(queue, out, 20, 0), 8);
+    for (size_t i = 0; i < 8; i++)
+    {
+        assert_true(out[i] == items[i + 5]);
+    }
+
+    assert_int_equal(SPSCQueuePopN(queue, out, 20, 0), 0);
+    assert_int_equal(SPSCQueueTryPushN(queue, items, 0), 0);
+
+    SPSCQueueDestroy(queue);
+}
+
+static void test_timeout(void)
+{
+    SPSCQueue *queue = SPSCQueueNew(2, NULL);
+
+    void *item;
+    time_t start = time(NULL);
+    assert_false(SPSCQueuePop(queue, &item, 1));
+    assert_true(time(NULL) - start >= 1);
+
+    void *items[3] = { queue, queue, queue };
+    assert_int_equal(SPSCQueuePushN(queue, items, 3, 1), 2);
+
+    SPSCQueueDestroy(queue);
+}
+
+#define N_ITEMS 2000000
+#define BATCH 64
+
+typedef struct
+{
+    SPSCQueue *queue;
+    bool batch;
+} TransferArgs;
+
+static void *Producer(void *data)
+{
+    TransferArgs *args = data;
+    if (args->batch)
+    {
+        void *items[BATCH];
+        for (size_t i = 0; i < N_ITEMS; i += BATCH)
+        {
+            for (size_t j = 0; j < BATCH; j++)
+            {
+                items[j] = (void *) (i + j);
+            }
+            SPSCQueuePushN(args->queue, items, BATCH, THREAD_BLOCK_INDEFINITELY);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < N_ITEMS; i++)
+        {
+            SPSCQueuePush(args->queue, (void *) i, THREAD_BLOCK_INDEFINITELY);
+        }
+    }
+    return NULL;
+}
+
+static void Transfer(bool batch)
+{
+    TransferArgs args = { SPSCQueueNew(1024, NULL), batch };
+    pthread_t producer;
+    assert_int_equal(pthread_create(&producer, NULL, Producer, &args), 0);
+
+    /* Items must come out in order */
+    size_t expected = 0;
+    while (expected < N_ITEMS)
+    {
+        void *items[BATCH];
+        size_t n = SPSCQueuePopN(args.queue, items,
+                                 batch ? BATCH : 1, THREAD_BLOCK_INDEFINITELY);
+        for (size_t i = 0; i < n; i++)
+        {
+            assert_int_equal((size_t) items[i], expected);
+            expected++;
+        }
+    }
+
+    pthread_join(producer, NULL);
+    assert_int_equal(SPSCQueueCount(args.queue), 0);
+    SPSCQueueDestroy(args.queue);
+}
+
+static void test_transfer(void)
+{
+    Transfer(false);
+    Transfer(true);
+}
+
+int main()
+{
+    PRINT_TEST_BANNER();
+    const UnitTest tests[] =
+    {
+        unit_test(test_push_pop),
+        unit_test(test_batch),
+        unit_test(test_timeout),
+        unit_test(test_transfer),
+    };
+
+    return run_tests(tests);
+}
@@ -0,0 +1,80 @@
+#include <platform.h>
+
+#include <alloc.h>
+#include <string_lib.h>
+
+/*
+ * Compares StringHash() with the Jenkins one-at-a-time hash it replaced.
+ * Not part of "make check", run with "make benchmarks".
+ */
+
+static unsigned int OneAtATimeHash(const char *str, unsigned int seed)
+{
+    const unsigned char *p = (const unsigned char *) str;
+    unsigned int h = seed;
+    size_t len = strlen(str);
+    for (size_t i = 0; i < len; i++)
+    {
+        h += p[i];
+        h += (h << 10);
+        h ^= (h >> 6);
+    }
+    h += (h << 3);
+    h ^= (h >> 11);
+    h += (h << 15);
+    return h;
+}
+
+static double BenchmarkHash(unsigned int (*hash)(const char *, unsigned int),
+                            char **keys, size_t n_keys, size_t rounds,
+                            volatile unsigned int *sink)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < n_keys; i++)
+        {
+            *sink += hash(keys[i], 0);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1e3 +
+        (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+int main()
+{
+    const size_t lengths[] = { 8, 32, 128, 1024 };
+    const size_t total = 8 * 1024 * 1024; /* bytes hashed per length */
+    volatile unsigned int sink = 0; /* keeps the loops from being elided */
+
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+    {
+        const size_t n_keys = 1024;
+        char **keys = xmalloc(n_keys * sizeof(char *));
+        for (size_t i = 0; i < n_keys; i++)
+        {
+            keys[i] = xmalloc(lengths[l] + 1);
+            for (size_t j = 0; j < lengths[l]; j++)
+            {
+                keys[i][j] = 'a' + ((i + j * 7) % 26);
+            }
+            keys[i][lengths[l]] = '\0';
+        }
+
+        const size_t rounds = total / (n_keys * lengths[l]);
+        double old_ms = BenchmarkHash(OneAtATimeHash, keys, n_keys, rounds, &sink);
+        double new_ms = BenchmarkHash(StringHash, keys, n_keys, rounds, &sink);
+        printf("StringHash %4zu byte keys: one-at-a-time %7.2f ms, "
+               "StringHash %7.2f ms\n", lengths[l], old_ms, new_ms);
+
+        for (size_t i = 0; i < n_keys; i++)
+        {
+            free(keys[i]);
+        }
+        free(keys);
+    }
+
+    return 0;
+}
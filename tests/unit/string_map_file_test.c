@@ -0,0 +1,214 @@
+#include <test.h>
+
+#include <string_map_file.h>
+#include <alloc.h>
+#include <file_lib.h>
+#include <string_lib.h>
+
+static char path[] = "/tmp/string_map_file_test.XXXXXX";
+
+static void test_write_and_lookup(void)
+{
+    StringMap *map = StringMapNew();
+    for (int i = 0; i < 10000; i++)
+    {
+        char *key, *value;
+        xasprintf(&key, "key%d", i);
+        xasprintf(&value, "value%d", i);
+        StringMapInsert(map, key, value);
+    }
+    StringMapInsert(map, xstrdup(""), xstrdup("empty key"));
+
+    assert_true(StringMapFileWrite(map, path));
+
+    StringMapFile *file = StringMapFileOpen(path);
+    assert_true(file != NULL);
+    assert_int_equal(StringMapFileSize(file), 10001);
+
+    char key[32], value[32];
+    for (int i = 0; i < 10000; i++)
+    {
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(value, sizeof(value), "value%d", i);
+        assert_string_equal(StringMapFileGet(file, key), value);
+    }
+    assert_true(StringMapFileHasKey(file, "key0"));
+    assert_string_equal(StringMapFileGet(file, ""), "empty key");
+
+    assert_false(StringMapFileHasKey(file, "key10000"));
+    assert_false(StringMapFileHasKey(file, "key"));
+    assert_true(StringMapFileGet(file, "value1") == NULL);
+
+    StringMapFileClose(file);
+    StringMapDestroy(map);
+}
+
+static void test_empty_map(void)
+{
+    StringMap *map = StringMapNew();
+    assert_true(StringMapFileWrite(map, path));
+
+    StringMapFile *file = StringMapFileOpen(path);
+    assert_true(file != NULL);
+    assert_int_equal(StringMapFileSize(file), 0);
+    assert_false(StringMapFileHasKey(file, "a"));
+    assert_true(StringMapFileGet(file, "") == NULL);
+
+    StringMapFileClose(file);
+    StringMapDestroy(map);
+}
+
+static void test_replace_while_open(void)
+{
+    StringMap *map = StringMapNew();
+    StringMapInsert(map, xstrdup("a"), xstrdup("old"));
+    assert_true(StringMapFileWrite(map, path));
+    StringMapFile *old_file = StringMapFileOpen(path);
+    assert_true(old_file != NULL);
+
+    StringMapInsert(map, xstrdup("a"), xstrdup("new"));
+    assert_true(StringMapFileWrite(map, path));
+    StringMapFile *new_file = StringMapFileOpen(path);
+    assert_true(new_file != NULL);
+
+    assert_string_equal(StringMapFileGet(old_file, "a"), "old");
+    assert_string_equal(StringMapFileGet(new_file, "a"), "new");
+
+    StringMapFileClose(old_file);
+    StringMapFileClose(new_file);
+    StringMapDestroy(map);
+}
+
+static void test_null_value(void)
+{
+    StringMap *map = StringMapNew();
+    StringMapInsert(map, xstrdup("a"), xstrdup("kept"));
+    assert_true(StringMapFileWrite(map, path));
+
+    /* MapInsert() asserts on NULL values, but only in debug builds */
+    StringMapInsert(map, xstrdup("b"), xstrdup("null"));
+    StringMapIterator iter = StringMapIteratorInit(map);
+    MapKeyValue *item;
+    while ((item = StringMapIteratorNext(&iter)) != NULL)
+    {
+        if (StringEqual(item->key, "b"))
+        {
+            free(item->value);
+            item->value = NULL;
+        }
+    }
+
+    /* Rejected, and the existing file is left alone */
+    assert_false(StringMapFileWrite(map, path));
+
+    StringMapFile *file = StringMapFileOpen(path);
+    assert_true(file != NULL);
+    assert_int_equal(StringMapFileSize(file), 1);
+    assert_string_equal(StringMapFileGet(file, "a"), "kept");
+
+    StringMapFileClose(file);
+    StringMapDestroy(map);
+}
+
+static void test_invalid_files(void)
+{
+    assert_true(StringMapFileOpen("/nonexistent/string_map_file") == NULL);
+
+    StringMap *map = StringMapNew();
+    StringMapInsert(map, xstrdup("key"), xstrdup("value"));
+    assert_true(StringMapFileWrite(map, path));
+    StringMapDestroy(map);
+
+    /* Truncated */
+    struct stat sb;
+    assert_int_equal(stat(path, &sb), 0);
+    assert_int_equal(truncate(path, sb.st_size - 1), 0);
+    assert_true(StringMapFileOpen(path) == NULL);
+
+    assert_int_equal(truncate(path, 4), 0);
+    assert_true(StringMapFileOpen(path) == NULL);
+
+    /* Not a string map file at all */
+    int fd = safe_open(path, O_WRONLY | O_TRUNC);
+    assert_true(fd >= 0);
+    const char garbage[128] = "this is not a string map file";
+    assert_int_equal(FullWrite(fd, garbage, sizeof(garbage)), sizeof(garbage));
+    close(fd);
+    assert_true(StringMapFileOpen(path) == NULL);
+}
+
+#define N_WRITERS 4
+
+static void *WriteMap(void *data)
+{
+    const int writer = (int) (intptr_t) data;
+    StringMap *map = StringMapNew();
+    for (int i = 0; i < 1000; i++)
+    {
+        char *key, *value;
+        xasprintf(&key, "key%d", i);
+        xasprintf(&value, "writer%d", writer);
+        StringMapInsert(map, key, value);
+    }
+
+    bool ok = true;
+    for (int round = 0; round < 10; round++)
+    {
+        ok = StringMapFileWrite(map, path) && ok;
+    }
+
+    StringMapDestroy(map);
+    return ok ? data : NULL;
+}
+
+static void test_concurrent_writers(void)
+{
+    pthread_t writers[N_WRITERS];
+    for (intptr_t i = 0; i < N_WRITERS; i++)
+    {
+        assert_int_equal(pthread_create(&writers[i], NULL, WriteMap,
+                                        (void *) (i + 1)), 0);
+    }
+    for (int i = 0; i < N_WRITERS; i++)
+    {
+        void *ret;
+        pthread_join(writers[i], &ret);
+        assert_true(ret != NULL);
+    }
+
+    /* The last rename wins, the file is entirely one writer's */
+    StringMapFile *file = StringMapFileOpen(path);
+    assert_true(file != NULL);
+    assert_int_equal(StringMapFileSize(file), 1000);
+    const char *value = StringMapFileGet(file, "key0");
+    assert_true(value != NULL);
+    for (int i = 0; i < 1000; i++)
+    {
+        char key[32];
+        snprintf(key, sizeof(key), "key%d", i);
+        assert_string_equal(StringMapFileGet(file, key), value);
+    }
+    StringMapFileClose(file);
+}
+
+int main()
+{
+    int fd = mkstemp(path);
+    assert_true(fd >= 0);
+    close(fd);
+
+    PRINT_TEST_BANNER();
+    const UnitTest tests[] =
+    {
+        unit_test(test_write_and_lookup),
+        unit_test(test_empty_map),
+        unit_test(test_replace_while_open),
+        unit_test(test_null_value),
+        unit_test(test_invalid_files),
+        unit_test(test_concurrent_writers),
+    };
+
+    int ret = run_tests(tests);
+    unlink(path);
+    return ret;
+}
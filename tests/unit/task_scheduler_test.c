@@ -0,0 +1,143 @@
+#include <test.h>
+
+#include <alloc.h>
+#include <task_scheduler.h>
+
+static TaskScheduler *SCHEDULER;
+
+typedef struct
+{
+    int n;
+    long result;
+} Fibonacci;
+
+/* Deliberately naive recursion, lots of small nested tasks */
+static void FibonacciTask(void *data)
+{
+    Fibonacci *fib = data;
+    if (fib->n < 2)
+    {
+        fib->result = fib->n;
+        return;
+    }
+
+    Fibonacci a = { fib->n - 1, 0 };
+    Fibonacci b = { fib->n - 2, 0 };
+    TaskGroup group = { 0 };
+    TaskSpawn(SCHEDULER, &group, FibonacciTask, &a);
+    TaskSpawn(SCHEDULER, &group, FibonacciTask, &b);
+    TaskGroupWait(SCHEDULER, &group);
+
+    fib->result = a.result + b.result;
+}
+
+static void test_fork_join(void)
+{
+    Fibonacci fib = { 20, 0 };
+    TaskGroup group = { 0 };
+    TaskSpawn(SCHEDULER, &group, FibonacciTask, &fib);
+    TaskGroupWait(SCHEDULER, &group);
+    assert_int_equal(fib.result, 6765);
+
+    /* Run directly from the waiting thread too */
+    fib = (Fibonacci) { 15, 0 };
+    FibonacciTask(&fib);
+    assert_int_equal(fib.result, 610);
+}
+
+static void CountTask(void *data)
+{
+    __atomic_fetch_add((size_t *) data, 1, __ATOMIC_RELAXED);
+}
+
+static void test_many_tasks(void)
+{
+    size_t count = 0;
+    TaskGroup group = { 0 };
+    for (int i = 0; i < 10000; i++)
+    {
+        TaskSpawn(SCHEDULER, &group, CountTask, &count);
+    }
+    TaskGroupWait(SCHEDULER, &group);
+    assert_int_equal(count, 10000);
+
+    /* Waiting for an empty group returns right away */
+    TaskGroupWait(SCHEDULER, &group);
+}
+
+typedef struct
+{
+    size_t *count;
+    int depth;
+} TreeNode;
+
+/* Unbalanced tree, most of the work is under the first child */
+static void TreeTask(void *data)
+{
+    TreeNode *node = data;
+    CountTask(node->count);
+    if (node->depth == 0)
+    {
+        return;
+    }
+
+    TreeNode children[3] = {
+        { node->count, node->depth - 1 },
+        { node->count, node->depth / 2 },
+        { node->count, 0 },
+    };
+    TaskGroup group = { 0 };
+    for (int i = 0; i < 3; i++)
+    {
+        TaskSpawn(SCHEDULER, &group, TreeTask, &children[i]);
+    }
+    TaskGroupWait(SCHEDULER, &group);
+}
+
+static size_t TreeSize(int depth)
+{
+    return (depth == 0) ? 1 : 2 + TreeSize(depth - 1) + TreeSize(depth / 2);
+}
+
+static void test_unbalanced(void)
+{
+    size_t count = 0;
+    TreeNode root = { &count, 12 };
+    TaskGroup group = { 0 };
+    TaskSpawn(SCHEDULER, &group, TreeTask, &root);
+    TaskGroupWait(SCHEDULER, &group);
+    assert_int_equal(count, TreeSize(12));
+}
+
+static void test_default_workers(void)
+{
+    TaskScheduler *scheduler = TaskSchedulerNew(0);
+    assert_true(TaskSchedulerWorkerCount(scheduler) >= 1);
+
+    size_t count = 0;
+    TaskGroup group = { 0 };
+    TaskSpawn(scheduler, &group, CountTask, &count);
+    TaskGroupWait(scheduler, &group);
+    assert_int_equal(count, 1);
+
+    TaskSchedulerDestroy(scheduler);
+}
+
+int main()
+{
+    /* Several workers even on a single CPU machine */
+    SCHEDULER = TaskSchedulerNew(4);
+
+    PRINT_TEST_BANNER();
+    const UnitTest tests[] =
+    {
+        unit_test(test_fork_join),
+        unit_test(test_many_tasks),
+        unit_test(test_unbalanced),
+        unit_test(test_default_workers),
+    };
+
+    int ret = run_tests(tests);
+    TaskSchedulerDestroy(SCHEDULER);
+    return ret;
+}
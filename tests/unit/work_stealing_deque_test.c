@@ -0,0 +1,131 @@
+#include <test.h>
+
+#include <alloc.h>
+#include <work_stealing_deque.h>
+
+static void test_push_pop_steal(void)
+{
+    WSDeque *deque = WSDequeNew(0);
+    size_t items[100];
+
+    void *item;
+    assert_false(WSDequePop(deque, &item));
+    assert_false(WSDequeSteal(deque, &item));
+
+    /* More than the initial capacity */
+    for (size_t i = 0; i < 100; i++)
+    {
+        items[i] = i;
+        WSDequePush(deque, &items[i]);
+    }
+    assert_int_equal(WSDequeCount(deque), 100);
+
+    /* Owner gets the newest, thieves the oldest */
+    assert_true(WSDequePop(deque, &item));
+    assert_true(item == &items[99]);
+    assert_true(WSDequeSteal(deque, &item));
+    assert_true(item == &items[0]);
+
+    for (size_t i = 98; i >= 50; i--)
+    {
+        assert_true(WSDequePop(deque, &item));
+        assert_true(item == &items[i]);
+    }
+    for (size_t i = 1; i < 50; i++)
+    {
+        assert_true(WSDequeSteal(deque, &item));
+        assert_true(item == &items[i]);
+    }
+    assert_int_equal(WSDequeCount(deque), 0);
+    assert_false(WSDequePop(deque, &item));
+    assert_false(WSDequeSteal(deque, &item));
+
+    /* Still usable once empty */
+    WSDequePush(deque, &items[7]);
+    assert_true(WSDequePop(deque, &item));
+    assert_true(item == &items[7]);
+
+    WSDequeDestroy(deque);
+}
+
+#define N_THIEVES 3
+#define N_ITEMS 200000
+
+typedef struct
+{
+    WSDeque *deque;
+    unsigned char *seen;
+    bool *done;
+} ThiefArgs;
+
+static void *Thief(void *data)
+{
+    ThiefArgs *args = data;
+    while (!__atomic_load_n(args->done, __ATOMIC_ACQUIRE))
+    {
+        void *item;
+        if (WSDequeSteal(args->deque, &item))
+        {
+            __atomic_fetch_add(&args->seen[(size_t) item], 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+static void test_concurrent_steal(void)
+{
+    WSDeque *deque = WSDequeNew(0);
+    unsigned char *seen = xcalloc(N_ITEMS, 1);
+    bool done = false;
+
+    pthread_t thieves[N_THIEVES];
+    ThiefArgs args = { deque, seen, &done };
+    for (int i = 0; i < N_THIEVES; i++)
+    {
+        assert_int_equal(pthread_create(&thieves[i], NULL, Thief, &args), 0);
+    }
+
+    /* Owner pushes everything, popping some items on the way */
+    for (size_t i = 0; i < N_ITEMS; i++)
+    {
+        WSDequePush(deque, (void *) i);
+        void *item;
+        if (i % 3 == 0 && WSDequePop(deque, &item))
+        {
+            __atomic_fetch_add(&seen[(size_t) item], 1, __ATOMIC_RELAXED);
+        }
+    }
+    void *item;
+    while (WSDequePop(deque, &item))
+    {
+        __atomic_fetch_add(&seen[(size_t) item], 1, __ATOMIC_RELAXED);
+    }
+
+    /* Thieves may still be in the middle of a steal, wait for them before
+     * checking. Nothing is left to steal, the deque was seen empty. */
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+    for (int i = 0; i < N_THIEVES; i++)
+    {
+        pthread_join(thieves[i], NULL);
+    }
+
+    for (size_t i = 0; i < N_ITEMS; i++)
+    {
+        assert_int_equal(seen[i], 1);
+    }
+
+    free(seen);
+    WSDequeDestroy(deque);
+}
+
+int main()
+{
+    PRINT_TEST_BANNER();
+    const UnitTest tests[] =
+    {
+        unit_test(test_push_pop_steal),
+        unit_test(test_concurrent_steal),
+    };
+
+    return run_tests(tests);
+}